@@ -7,6 +7,7 @@
 #include "sbRunAction.hh"
 #include "sbEventAction.hh"
 #include "sbSteppingAction.hh"
+#include "sbStackingAction.hh"
 
 class ActionInitialization : public G4VUserActionInitialization {
 public:
@@ -0,0 +1,90 @@
+#ifndef SB_ASYNC_FILE_WRITER_H
+#define SB_ASYNC_FILE_WRITER_H 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "globals.hh"
+
+#include "sbBoundedQueue.hh"
+#include "sbWaveformFormat.hh"
+
+// Event record serialized by a worker, appended by the writer thread.
+struct sbWriteRequest {
+    G4int eventID;
+    std::string record;
+};
+
+// Dedicated writer thread of the waveform container (see sbWaveformFormat.hh).
+// Workers hand over pre-serialized event records through a bounded lock-free queue and
+// go on simulating; the writer is the only one appending to the container, it drains
+// the queue in batches through a large stdio buffer and keeps the index, written as
+// the footer when it stops. A full queue is the backpressure: the worker waits until
+// the writer has made room, so memory stays bounded when the disk is slower than the
+// simulation. The writer sleeps on an empty queue and stalled workers on a full one,
+// woken by the other side only when someone sleeps: the sleepers announce themselves in
+// atomics, so a write to a busy writer neither locks nor notifies (the queue itself stays
+// lock-free).
+//
+// Started and stopped by the master run action, queue depth, stalls and write
+// throughput are printed when it stops.
+class sbAsyncFileWriter {
+public:
+    static sbAsyncFileWriter& GetInstance();
+    sbAsyncFileWriter(const sbAsyncFileWriter&) = delete;
+    sbAsyncFileWriter& operator=(const sbAsyncFileWriter&) = delete;
+
+private:
+    sbAsyncFileWriter();
+    ~sbAsyncFileWriter();
+
+    sbBoundedQueue<sbWriteRequest> fQueue;
+    std::thread fWriterThread;
+    std::atomic<G4bool> fRunning;
+    // Sleeping writer and stalled workers only, pushes and pops do not lock.
+    std::mutex fWaitMutex;
+    std::condition_variable fQueueNotEmpty;
+    std::condition_variable fQueueNotFull;
+    // Set before the sleepers check the queue, read after the other side changed it.
+    std::atomic<G4bool> fWriterSleeping;
+    std::atomic<G4int> fNumOfStalledWorkers;
+
+    // Writer thread only while running.
+    G4String fFileName;
+    std::FILE* fFile;
+    std::vector<char> fFileBuffer;
+    uint64_t fFileOffset;
+    std::vector<sbWaveformIndexEntry> fIndex;
+
+    // Statistics of a run.
+    std::chrono::steady_clock::time_point fStartTime;
+    std::atomic<size_t> fMaxQueueDepth;
+    std::atomic<size_t> fNumOfStalls;
+    // Writer thread only, read after it is joined.
+    size_t fNumOfBytes;
+    size_t fNumOfFailures;
+    size_t fNumOfBatches;
+    G4double fWriteSeconds;
+
+public:
+    // Master, the container is overwritten.
+    void Start(const G4String& fileName);
+    void Stop();
+
+    // Any thread, blocks while the queue is full.
+    void Write(G4int eventID, std::string record);
+
+private:
+    void WriterLoop();
+    void WakeUp(std::condition_variable& condition);
+    G4bool Append(const void* data, size_t size);
+    void PrintStatistics(G4double elapsedSeconds) const;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SB_BIASING_MESSENGER_H
+#define SB_BIASING_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/biasing/, master only.
+class sbBiasingMessenger : public G4UImessenger {
+public:
+    sbBiasingMessenger();
+    virtual ~sbBiasingMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fBiasingDirectory;
+    G4UIcmdWithADouble* fEnergyIndexCmd;
+    G4UIcmdWithADouble* fZenithIndexCmd;
+};
+
+#endif
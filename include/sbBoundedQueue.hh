@@ -0,0 +1,92 @@
+#ifndef SB_BOUNDED_QUEUE_H
+#define SB_BOUNDED_QUEUE_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's ring buffer).
+// Every cell carries a sequence number telling whether it is free for the producer of
+// that turn or full for the consumer of that turn, so producers and consumers only
+// contend on their own position counter. Capacity must be a power of 2.
+//
+// TryPush and TryPop never block, a full or empty queue returns false.
+// No Geant4, also used by the tests of tools/waveformReader.
+template<typename T>
+class sbBoundedQueue {
+public:
+    explicit sbBoundedQueue(size_t capacity) :
+        fCells(capacity),
+        fMask(capacity - 1),
+        fPushPosition(0),
+        fPopPosition(0) {
+        for (size_t i = 0; i < capacity; ++i) {
+            fCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    sbBoundedQueue(const sbBoundedQueue&) = delete;
+    sbBoundedQueue& operator=(const sbBoundedQueue&) = delete;
+
+    bool TryPush(T&& value) {
+        size_t position = fPushPosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = fCells[position & fMask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position);
+            if (difference == 0) {
+                if (fPushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;   // Full.
+            } else {
+                position = fPushPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& value) {
+        size_t position = fPopPosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = fCells[position & fMask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position + 1);
+            if (difference == 0) {
+                if (fPopPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + fMask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;   // Empty.
+            } else {
+                position = fPopPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate, for statistics.
+    size_t Size() const {
+        const size_t pushPosition = fPushPosition.load(std::memory_order_relaxed);
+        const size_t popPosition = fPopPosition.load(std::memory_order_relaxed);
+        return pushPosition > popPosition ? pushPosition - popPosition : 0;
+    }
+    size_t Capacity() const { return fMask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::vector<Cell> fCells;
+    const size_t fMask;
+    // On their own cache lines, producers and consumers do not share them.
+    alignas(64) std::atomic<size_t> fPushPosition;
+    alignas(64) std::atomic<size_t> fPopPosition;
+};
+
+#endif
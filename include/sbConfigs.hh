@@ -8,10 +8,65 @@
 // Using time for random seed if enabled.
 #define SB_USING_TIME_RANDOM_SEED                false
 //
+// Use xoshiro256** (sbXoshiroEngine) instead of the Geant4 default engine (MixMax).
+// Changes every random sequence, results are not comparable event by event with MixMax runs.
+// The SB_RANDOM_ENGINE environment variable overrides it at start-up.
+#define SB_USING_XOSHIRO_ENGINE                  false
+//
+// Sample cosmic muon energy and zenith angle from a precomputed inverse-CDF table.
+// If disabled, the (slow) rejection sampler is used.
+#define SB_USING_MUON_SPECTRUM_TABLE             true
+//
+// Compare the spectrum table with the rejection sampler when the table is built.
+// Slow, only for validating the table.
+#define SB_CHECK_MUON_SPECTRUM_TABLE             false
+//
+// Only generate muons whose trajectories cross a scintillator.
+// The geometric acceptance is reported at the end of run for rate normalization.
+#define SB_ACCEPTANCE_AWARE_MUON_GENERATION      false
+//
+// Sample muons in per-thread batches with bulk random numbers and vectorized loops.
+// A batch spans several events, so an event can not be reproduced from its own seeds and
+// the results depend on the thread scheduling. Requires SB_USING_MUON_SPECTRUM_TABLE.
+#define SB_BATCHED_MUON_GENERATION               false
+//
+// Sample muons from the spectrum times a biasing function in energy and zenith angle
+// (see /smallbox/biasing/), every muon carries the importance weight.
+// Histograms and ntuples are filled with the weights. Requires SB_USING_MUON_SPECTRUM_TABLE.
+#define SB_ENABLE_MUON_SPECTRUM_BIASING          false
+//
 // Enable optical physics. (Scintillation process, reflection, etc.)
 // If only care about hit, this can be disabled.
 #define SB_ENABLE_OPTICAL_PHYSICS                false
 //
+// Replace the scintillation photons in scintillators by sbOpticalPhotonFastModel, which
+// samples SiPM hits per energy deposit from the response map gOpticalResponseMapFileName
+// without making photon tracks. Requires SB_ENABLE_OPTICAL_PHYSICS, SB_PROCESS_SIPM_HIT
+// and SB_PROCESS_SCINTILLATOR_HIT.
+#define SB_ENABLE_OPTICAL_FAST_SIMULATION        false
+//
+// Track optical photons only if the muon hits satisfy the trigger condition
+// (see /smallbox/stacking/trigger), otherwise kill them. Events failing it get no SiPM
+// output, unlike the baseline. Requires SB_PROCESS_SCINTILLATOR_HIT.
+#define SB_DEFER_OPTICAL_PHOTONS                 false
+//
+// Generate 1/gScintillationYieldReduction of the scintillation photons, every one of them
+// stands for gScintillationYieldReduction photons (the weight of its SiPM hit).
+// Optical tracking is faster by this factor, weighted sums stay unbiased.
+#define SB_REDUCE_SCINTILLATION_YIELD            false
+//
+// With SB_REDUCE_SCINTILLATION_YIELD, round the weight of every SiPM hit to an integer
+// number of photons before the ntuple, up with the probability of the fraction, so that
+// the photoelectron count is an integer with the mean of the full yield. It does not get
+// the fluctuation of the full yield back: for mu photons at a reduction N the variance
+// stays N * mu (N times the full yield's), which no resampling of the reduced hits undoes.
+#define SB_ROUND_PHOTON_HIT_WEIGHTS              false
+//
+// Detect optical photons on the SiPM surface (dielectric_metal, EFFICIENCY = PDE) instead of
+// absorbing them in the SiPM bulk. Detected photons are recorded by the boundary process and
+// killed there, without a step in the silicon.
+#define SB_SIPM_SURFACE_DETECTION                true
+//
 // Enable reflection on aluminum foil's surface.
 #define SB_ENABLE_AL_FOIL_REFLECTION             true
 //
@@ -22,8 +77,28 @@
 // Process and save SiPM optical photon hit if enabled.
 #define SB_PROCESS_SIPM_HIT                      false
 //
+// Record the SiPM photons of an event straight into per-thread float arrays
+// (sbSiPMPhotonBuffer), radix-sorted by time at the end of the event, instead of one
+// sbSiPMHit per photon; the SiPM hits collections stay empty (nothing to draw).
+#define SB_BUFFER_SIPM_PHOTONS                   true
+//
+// Digitize the SiPM hits microcell by microcell (sbSiPMDigitizer): PDE, optical crosstalk,
+// afterpulsing, dark counts and pixel recovery. The waveforms are built from the digitized
+// avalanches instead of the photon hits. Only with SB_PROCESS_SIPM_HIT.
+#define SB_DIGITIZE_SIPM_HITS                    true
+//
 // Process and save scintillator muon hit if enabled.
 #define SB_PROCESS_SCINTILLATOR_HIT              true
 
+#if SB_ENABLE_OPTICAL_PHYSICS && SB_DEFER_OPTICAL_PHOTONS && !SB_PROCESS_SCINTILLATOR_HIT
+#error "SB_DEFER_OPTICAL_PHOTONS requires SB_PROCESS_SCINTILLATOR_HIT."
+#endif
+#if SB_ROUND_PHOTON_HIT_WEIGHTS && !SB_REDUCE_SCINTILLATION_YIELD
+#error "SB_ROUND_PHOTON_HIT_WEIGHTS requires SB_REDUCE_SCINTILLATION_YIELD."
+#endif
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION && !(SB_ENABLE_OPTICAL_PHYSICS && SB_PROCESS_SIPM_HIT && SB_PROCESS_SCINTILLATOR_HIT)
+#error "SB_ENABLE_OPTICAL_FAST_SIMULATION requires SB_ENABLE_OPTICAL_PHYSICS, SB_PROCESS_SIPM_HIT and SB_PROCESS_SCINTILLATOR_HIT."
+#endif
+
 #endif
 
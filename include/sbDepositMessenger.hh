@@ -0,0 +1,24 @@
+#ifndef SB_DEPOSIT_MESSENGER_H
+#define SB_DEPOSIT_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAString.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/deposits/, master only.
+class sbDepositMessenger : public G4UImessenger {
+public:
+    sbDepositMessenger();
+    virtual ~sbDepositMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fDepositsDirectory;
+    G4UIcmdWithABool* fRecordCmd;
+    G4UIcmdWithAString* fFileCmd;
+};
+
+#endif
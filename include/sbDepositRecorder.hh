@@ -0,0 +1,99 @@
+#ifndef SB_DEPOSIT_RECORDER_H
+#define SB_DEPOSIT_RECORDER_H 1
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "globals.hh"
+
+class G4Event;
+class G4Step;
+
+// Binary deposit file, the energy deposition steps in the scintillators of every event.
+// All numbers are little-endian, the file is used in place (memory-mapped) by
+// sbDepositReplaySource, so the layout must not be changed without changing the version.
+//
+// [sbDepositFileHeader]
+// [uint64_t firstStep[numOfEvents + 1]]     : Event i owns steps [firstStep[i], firstStep[i + 1]).
+// [sbDepositFileEvent event[numOfEvents]]
+// [sbDepositFileStep step[numOfSteps]]
+struct sbDepositFileHeader {
+    char     magic[8];        // "SBDEPOST"
+    uint32_t version;         // 1
+    uint32_t reserved;
+    uint64_t numOfEvents;
+    uint64_t numOfSteps;
+};
+
+struct sbDepositFileEvent {
+    float    weight;          // Importance weight of the event.
+    uint32_t muonHitMask;     // Bit 0: upper scintillator hit by a muon, bit 1: lower.
+    uint32_t numOfSteps;
+    uint32_t reserved;
+};
+
+// Everything G4Scintillation uses, the visible energy (Birks) included.
+struct sbDepositFileStep {
+    int32_t pdgCode;
+    float   energyDeposit;              // MeV
+    float   nonIonizingEnergyDeposit;   // MeV
+    float   stepLength;                 // mm
+    float   preTime;                    // ns
+    float   postTime;                   // ns
+    float   prePosition[3];             // mm
+    float   postPosition[3];            // mm
+};
+
+static_assert(sizeof(sbDepositFileHeader) == 32, "sbDepositFileHeader must be packed.");
+static_assert(sizeof(sbDepositFileEvent) == 16, "sbDepositFileEvent must be packed.");
+static_assert(sizeof(sbDepositFileStep) == 48, "sbDepositFileStep must be packed.");
+
+// Record mode of the two-pass simulation: the muon and its showers are simulated once and
+// the scintillator deposits are written to a deposit file, the optical stage is replayed
+// from it as often as needed (/smallbox/gun/source replay).
+//
+// Every thread writes its events to gDepositFileName + ".t<thread>" and the master
+// concatenates them at the end of run. Events without deposits are not written. With
+// SB_DEFER_OPTICAL_PHOTONS neither are the events failing the trigger condition, decided
+// once the charged particles are tracked. The optical photons are killed instead of
+// tracked in any case (sbStackingAction).
+//
+// Enabled by /smallbox/deposits/record (master), shared by all threads.
+class sbDepositRecorder {
+public:
+    static sbDepositRecorder& GetInstance();
+    sbDepositRecorder(const sbDepositRecorder&) = delete;
+    sbDepositRecorder& operator=(const sbDepositRecorder&) = delete;
+
+private:
+    sbDepositRecorder();
+    ~sbDepositRecorder() {}
+
+    std::atomic<G4bool> fEnabled;
+    G4String fFileName;
+
+    // Per thread.
+    static G4ThreadLocal std::ofstream* fThreadFile;
+    static G4ThreadLocal std::vector<sbDepositFileStep>* fEventSteps;
+
+public:
+    G4bool IsEnabled() const { return fEnabled.load(std::memory_order_relaxed); }
+    void SetEnabled(G4bool enabled) { fEnabled = enabled; }
+    void SetFileName(const G4String& fileName) { fFileName = fileName; }
+
+    // Threads running events.
+    void BeginOfRun() const;
+    void RecordStep(const G4Step* step) const;
+    void DiscardEvent() const;
+    void EndOfEvent(const G4Event* event) const;
+    void EndOfRun() const;
+    // Master, after the workers.
+    void Merge() const;
+
+private:
+    G4String ThreadFileName(G4int threadID) const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SB_DEPOSIT_REPLAY_SOURCE_H
+#define SB_DEPOSIT_REPLAY_SOURCE_H 1
+
+#include <cstdint>
+#include <memory>
+
+#include "globals.hh"
+
+#include "sbMappedFile.hh"
+#include "sbDepositRecorder.hh"
+#include "sbScintillationSpectrum.hh"
+
+class G4Event;
+class G4EmSaturation;
+class G4MaterialCutsCouple;
+
+// Replay mode of the two-pass simulation: every event is the scintillation photons of
+// one recorded event (see sbDepositRecorder), generated from its deposition steps as
+// G4Scintillation does it with the present optical properties: Birks-corrected visible
+// energy, yield and resolution scale, fast/slow components, uniform along the step.
+// Only the optical stage is simulated, and with the same seeds the photons of two
+// replays differ only where the optical properties differ.
+//
+// Per-thread reader, the file is mapped once and shared. As in sbPrimaryFileSource, event i
+// of a run replays record i, whichever thread processes it, so a replay is correlated
+// with the record reproducibly. A run of more events than the file holds is refused at
+// its start (CheckNumOfEvents).
+class sbDepositReplaySource {
+public:
+    sbDepositReplaySource(const G4String& fileName);
+    ~sbDepositReplaySource() {}
+
+    void GeneratePrimaries(G4Event* event);
+    //
+    // Fatal if numOfEvents (the events of the run) exceed the records of the file.
+    void CheckNumOfEvents(G4int numOfEvents) const;
+    //
+    // Muon hit mask of the last generated event, the trigger condition of the stacking.
+    G4int GetMuonHitMask() const { return fMuonHitMask; }
+
+private:
+    std::shared_ptr<const sbMappedFile> fMappedFile;
+    uint64_t fNumOfEvents;
+    const uint64_t* fFirstStep;
+    const sbDepositFileEvent* fEvents;
+    const sbDepositFileStep* fSteps;
+    G4int fMuonHitMask;
+
+    // Set at the first event, after the physics tables are built.
+    G4bool fInitialized;
+    sbScintillationSpectrum fSpectrum;
+    const G4EmSaturation* fEmSaturation;
+    const G4MaterialCutsCouple* fScintillatorCouple;
+
+    void Initialize();
+};
+
+#endif
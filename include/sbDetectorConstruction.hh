@@ -14,12 +14,18 @@
 #include "G4LogicalSkinSurface.hh"
 #include "G4OpticalSurface.hh"
 #include "G4SDManager.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4DigiManager.hh"
+
+#include <mutex>
 
 #include "sbGlobal.hh"
 #include "sbConfigs.hh"
 #include "CreateMapFromCSV.hh"
 #include "sbScintillatorSD.hh"
 #include "sbSiPMSD.hh"
+#include "sbSiPMDigitizer.hh"
 
 typedef std::pair<G4VPhysicalVolume*, G4VPhysicalVolume*> G4VPhysicalVolumePair;
 
@@ -54,12 +60,26 @@ private:
     // SiPMs physical volume
     // Note: use for identifying SiPM in sbSiPMHit.
     G4VPhysicalVolumePair fPhysicalSiPMs;
+#if SB_ENABLE_OPTICAL_PHYSICS && SB_SIPM_SURFACE_DETECTION
+    //
+    // SiPM surface properties and the two EFFICIENCY vectors swapped by SetSiPMSurfacePDE().
+    G4MaterialPropertiesTable* fSiPMSurfacePropertiesTable;
+    G4MaterialPropertyVector* fSiPMSurfacePDE;
+    G4MaterialPropertyVector* fSiPMSurfaceUnitEfficiency;
+    G4bool fSiPMSurfaceAppliesPDE;
+#endif
 
 public:
     virtual G4VPhysicalVolume* Construct();
 
     const G4VPhysicalVolumePair& GetPhysicalScintillators() const { return fPhysicalScintillators; }
     const G4VPhysicalVolumePair& GetPhysicalSiPMs() const { return fPhysicalSiPMs; }
+#if SB_ENABLE_OPTICAL_PHYSICS && SB_SIPM_SURFACE_DETECTION
+    //
+    // EFFICIENCY of the SiPM surface, the PDE, or 1 if the photons already passed the PDE
+    // (PDE filter of sbSteppingAction). Shared by all threads, set before their event loops.
+    void SetSiPMSurfacePDE(G4bool applyPDE);
+#endif
 
 private:
     virtual void ConstructSDandField();
@@ -96,10 +116,17 @@ private:
     // 
     // SiPM material optical properties setting.
     // -> Refraction index
-    // -> Absorption length
+    // -> Absorption length (unless SB_SIPM_SURFACE_DETECTION)
     // Note: For optical photon hit.
     //       Refraction index should always syncronize with light guide!
     void SetSiPMMaterialProperties(G4Material* SiPMMaterial) const;
+#if SB_SIPM_SURFACE_DETECTION
+    // 
+    // SiPM surface optical properties setting.
+    // -> Reflectivity
+    // -> Efficiency (PDE)
+    void SetSiPMSurfaceProperties(G4OpticalSurface* SiPMOpticalSurface);
+#endif
     // 
     // Light guide material optical properties setting.
     // -> Refraction index
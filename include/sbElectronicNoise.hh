@@ -0,0 +1,97 @@
+#ifndef SB_ELECTRONIC_NOISE_H
+#define SB_ELECTRONIC_NOISE_H 1
+
+#include <vector>
+
+#include "globals.hh"
+
+#include "sbWaveformFormat.hh"
+
+// Readout noise added to the synthesized SiPM waveforms:
+//
+// -> Electronic noise: Gaussian noise with a measured one-sided power spectrum
+//    (NOISE_frequency in MHz, NOISE_PSD in SPE peak^2 / MHz in the spectrum file), made
+//    once per thread by an inverse FFT of random Fourier coefficients into a ring of
+//    ringLength samples at timeStep. The ring is periodic, so every waveform adds the slice
+//    from a random offset with wrap-around, a strided add instead of filtering new noise.
+//    The ring is seeded by its own seed, identical in all threads, so the noise of an
+//    event depends only on the event's random numbers.
+// -> Baseline: a Gaussian offset per SiPM and event and a sinusoidal wander of random phase.
+//
+// The random numbers of one SiPM in one event (ring offset, baseline, wander phase) are
+// drawn once into a realization, a function of the time. Every waveform of that SiPM made
+// with it, e.g. the discriminator input and the readout gates, sees the same noise at the
+// same time.
+// -> ADC: samples rounded to the LSB above a pedestal, clipped to the ADC range.
+//
+// Off by default. Configured by /smallbox/noise/ (master), shared by all threads.
+class sbElectronicNoise {
+public:
+    // Noise of one SiPM in one event.
+    struct sbNoiseRealization {
+        G4double ringOffset;    // Ring position at time 0, whole ring samples.
+        G4double baseline;
+        G4double wanderPhase;   // At time 0.
+    };
+
+public:
+    static sbElectronicNoise& GetInstance();
+    sbElectronicNoise(const sbElectronicNoise&) = delete;
+    sbElectronicNoise& operator=(const sbElectronicNoise&) = delete;
+
+private:
+    sbElectronicNoise();
+    ~sbElectronicNoise() {}
+
+    G4bool fEnabled;
+    G4String fSpectrumFileName;
+    std::vector<G4double> fFrequencies;
+    std::vector<G4double> fPowerSpectrum;
+    G4double fRMS;
+    G4double fTimeStep;
+    G4int fRingLength;
+    G4long fSeed;
+    G4int fRingVersion;
+    G4double fBaselineSigma;
+    G4double fWanderAmplitude;
+    G4double fWanderFrequency;
+    G4double fADCLSB;
+    G4int fADCBits;
+    G4int fADCPedestal;
+
+    // Per thread, rebuilt when the ring settings change.
+    struct sbNoiseRing {
+        G4int version;
+        std::vector<float> samples;
+    };
+    static G4ThreadLocal sbNoiseRing* fRing;
+
+public:
+    void SetEnabled(G4bool enabled);
+    void SetSpectrumFileName(const G4String& fileName);
+    void SetRMS(G4double rms) { fRMS = rms; ++fRingVersion; }
+    void SetTimeStep(G4double timeStep) { fTimeStep = timeStep; ++fRingVersion; }
+    void SetRingLength(G4int ringLength);
+    void SetSeed(G4long seed) { fSeed = seed; ++fRingVersion; }
+    void SetBaselineSigma(G4double sigma) { fBaselineSigma = sigma; }
+    void SetWanderAmplitude(G4double amplitude) { fWanderAmplitude = amplitude; }
+    void SetWanderFrequency(G4double frequency) { fWanderFrequency = frequency; }
+    void SetADCLSB(G4double LSB) { fADCLSB = LSB; }
+    void SetADCBits(G4int bits) { fADCBits = bits; }
+    void SetADCPedestal(G4int pedestal) { fADCPedestal = pedestal; }
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    // Random numbers of one SiPM in one event, drawn once per event and SiPM.
+    sbNoiseRealization DrawRealization() const;
+    // Noise of the realization, baseline and ADC of one SiPM waveform on its regions.
+    void AddNoise(const sbNoiseRealization& realization, const std::vector<sbWaveformRegion>& regions,
+        std::vector<float>& waveform) const;
+
+private:
+    const std::vector<float>& Ring() const;
+    G4double PowerSpectrum(G4double frequency) const;
+    G4bool LoadSpectrumFile();
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SB_FEATURE_EXTRACTOR_H
+#define SB_FEATURE_EXTRACTOR_H 1
+
+#include <vector>
+
+#include "globals.hh"
+
+#include "sbSiPMPhotonBuffer.hh"
+#include "sbWaveformFormat.hh"
+#include "sbWaveformSynthesizer.hh"
+
+// Features of the waveform of one SiPM in an event, times in ns. Times are NaN without photons.
+struct sbPulseFeatures {
+    G4double firstPhotonTime;       // The earliest photon.
+    G4double CFDTime;               // Leading edge crossing the CFD fraction of the amplitude.
+    G4double amplitude;             // Peak of the waveform, single photoelectron peaks.
+    G4double charge;                // Waveform integral, single photoelectron peaks * ns.
+    G4double numOfPhotoelectrons;   // Sum of the pulse amplitudes.
+};
+
+// Online pulse features for production, one ntuple row per event instead of the hits and
+// waveform samples. The full record (hits, waveform samples, container record) is kept for
+// 1 in the prescale events, by event ID so runs with any number of threads agree, and for
+// the events selected by photoelectrons in both SiPMs.
+//
+// Configured by /smallbox/features/ (master), shared by all threads.
+class sbFeatureExtractor {
+public:
+    static sbFeatureExtractor& GetInstance();
+    sbFeatureExtractor(const sbFeatureExtractor&) = delete;
+    sbFeatureExtractor& operator=(const sbFeatureExtractor&) = delete;
+
+private:
+    sbFeatureExtractor();
+    ~sbFeatureExtractor() {}
+
+    G4double fCFDFraction;
+    G4int fPrescale;
+    G4double fSelectedPhotoelectrons;
+
+public:
+    void SetCFDFraction(G4double fraction) { fCFDFraction = fraction; }
+    void SetPrescale(G4int prescale) { fPrescale = prescale; }
+    void SetSelectedPhotoelectrons(G4double numOfPhotoelectrons) { fSelectedPhotoelectrons = numOfPhotoelectrons; }
+
+    // Photons sorted by time, the pulses and waveform of sbWaveformSynthesizer on the regions.
+    void Extract(const sbSiPMPhotonBuffer& photons, const std::vector<sbPulse>& pulses,
+        const std::vector<sbWaveformRegion>& regions, const std::vector<float>& waveform,
+        sbPulseFeatures& features) const;
+
+    // Prescaled or selected event.
+    G4bool KeepFullRecord(G4int eventID, const sbPulseFeatures& upperFeatures, const sbPulseFeatures& lowerFeatures) const;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef SB_FEATURE_MESSENGER_H
+#define SB_FEATURE_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/features/, master only.
+class sbFeatureMessenger : public G4UImessenger {
+public:
+    sbFeatureMessenger();
+    virtual ~sbFeatureMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fFeatureDirectory;
+    G4UIcmdWithADouble* fCFDFractionCmd;
+    G4UIcmdWithAnInteger* fPrescaleCmd;
+    G4UIcmdWithADouble* fSelectCmd;
+};
+
+#endif
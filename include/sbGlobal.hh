@@ -16,6 +16,14 @@ extern G4bool gRunningInBatch;
 // Cosmic muon source
 
 constexpr G4double gMaxE_GeV = 2000;
+constexpr G4double gMinE_GeV = 0.01;  // Spectrum is below 1e-7 of its peak under this.
+constexpr G4int gMuonSpectrumTableCheckSamples = 100000;
+constexpr G4int gMuonBatchSize = 4096;
+// Biasing function (E/GeV)^gEnergyBiasIndex * cos(theta)^gZenithBiasIndex, defaults of
+// /smallbox/biasing/. e.g. a positive energy index enhances the TeV tail, a negative one
+// stopping muons.
+constexpr G4double gEnergyBiasIndex = 1.0;
+constexpr G4double gZenithBiasIndex = -1.0;
 constexpr G4double gEffectiveRange = 0.25 * m;
 constexpr G4double gSphereRadius = 2.828427 * gEffectiveRange;
 
@@ -44,6 +52,9 @@ static const G4String gScintillatorGeneralName("scintillator");
 static const G4StringPair gScintillatorsName("upper_scintillator", "lower_scintillator");
 static const G4String gScintillatorSDName("scintillator");
 static const G4String gScintillatorMaterialName("plastic_scintillator");
+static const G4String gScintillatorPropertiesFileName("./datafiles/scintillatorProperties.csv");
+// Scintillation yield divided by this if SB_REDUCE_SCINTILLATION_YIELD, the photon weight.
+constexpr G4double gScintillationYieldReduction = 20.0;
 
 // Aluminum foil
 
@@ -65,7 +76,49 @@ static const G4ThreeVectorPair gSiPMsPosition(G4ThreeVector(0.0, 0.0, gUpperSiPM
 static const G4String gSiPMGeneralName("SiPM");
 static const G4StringPair gSiPMsName("upper_SiPM", "lower_SiPM");
 static const G4String gSiPMSDName("SiPM");
+static const G4StringPair gSiPMHCsName("upper_optical_photon_hits_collection", "lower_optical_photon_hits_collection");
 static const G4String gSiPMMaterialName("G4_Si");
+static const G4String gSiPMPropertiesFileName("./datafiles/SiPMProperties.csv");
+// Default single photoelectron pulse, see sbWaveformSynthesizer.
+constexpr G4double gSiPMPulseRiseTime = 0.0 * ns;
+constexpr G4double gSiPMPulseFallTime = 1.0 * ns;
+// Sparse waveforms: samples kept above the threshold in magnitude (single photoelectron peaks), fine
+// steps for a window from the pre-trigger before every leading edge, coarse steps elsewhere.
+constexpr G4double gWaveformSparseThreshold = 0.01;
+constexpr G4double gWaveformPreTrigger = 1.0 * ns;
+constexpr G4double gWaveformFineStep = 0.1 * ns;
+constexpr G4double gWaveformFineWindow = 20.0 * ns;
+constexpr G4double gWaveformCoarseStep = 2.0 * ns;
+// Pulse features of every event, full records (hits and waveforms) of 1 in the prescale
+// events, see sbFeatureExtractor.
+constexpr G4double gFeatureCFDFraction = 0.2;
+constexpr G4int gFullRecordPrescale = 1;
+// Electronic noise ring per thread (a power of two samples), baseline and ADC, see sbElectronicNoise.
+constexpr G4int gNoiseRingLength = 1 << 20;
+constexpr G4double gNoiseTimeStep = 0.1 * ns;
+constexpr G4double gNoiseWanderFrequency = 1 * megahertz;
+constexpr G4int gADCBits = 12;
+constexpr G4int gADCPedestal = 100;
+// Trigger and readout gates, see sbTriggerEmulator.
+constexpr G4double gTriggerThreshold = 1.5;
+constexpr G4double gTriggerCFDFraction = 0.3;
+constexpr G4double gDiscriminatorStep = 0.5 * ns;
+constexpr G4double gDiscriminatorTail = 20.0 * ns;
+constexpr G4double gCoincidenceWindow = 20.0 * ns;
+constexpr G4double gTriggerDeadTime = 100.0 * ns;
+constexpr G4double gReadoutPreTrigger = 20.0 * ns;
+constexpr G4double gReadoutGateLength = 200.0 * ns;
+constexpr G4double gReadoutGateStep = 0.5 * ns;
+// Microcells and noise of the digitizer, see sbSiPMDigitizer.
+static const G4String gSiPMDigitizerName("SiPMDigitizer");
+static const G4String gSiPMDigitsCollectionName("SiPM_digits_collection");
+constexpr G4double gSiPMPixelPitch = 50 * um;
+constexpr G4double gSiPMCrosstalkProbability = 0.1;
+constexpr G4double gSiPMAfterpulseProbability = 0.05;
+constexpr G4double gSiPMAfterpulseTimeConstant = 50 * ns;
+constexpr G4double gSiPMRecoveryTime = 40 * ns;
+constexpr G4double gSiPMDarkCountRate = 1 * megahertz;
+constexpr G4double gSiPMReadoutWindow = 1 * us;
 
 // Light guide
 
@@ -88,11 +141,26 @@ static const G4String gPCBGeneralName("PCB");
 static const G4StringPair gPCBsName("upper_PCB", "lower_PCB");
 static const G4String gPCBMaterialName("G4_POLYCARBONATE");
 
+// Optical fast simulation
+
+static const G4String gScintillatorRegionName("scintillator_region");
+static const G4String gOpticalResponseMapFileName("./datafiles/opticalResponseMap.bin");
+// Map binning over the scintillator and number of arrival delay quantiles.
+constexpr G4int gOpticalMapBins[3] = { 10, 10, 4 };
+constexpr G4int gOpticalMapQuantiles = 32;
+constexpr G4int gOpticalMapPhotonsPerVoxel = 100000;
+
 //
 // Analysis & file io
 
 static const G4String gRootFileName("smallbox");
-static const G4String gSiPMResultCSVDestDir("SiPMresponse");
+// SiPM waveforms and hits of a run, see sbWaveformFormat.hh and tools/waveformReader.
+static const G4String gWaveformFileName("SiPMresponse.sbwf");
+// Event records queued to the writer thread at most, see sbAsyncFileWriter. Power of 2.
+constexpr size_t gAsyncWriterQueueCapacity = 256;
+constexpr size_t gAsyncWriterBufferSize = 4 * 1024 * 1024;
+// Scintillator deposits of the record mode, see sbDepositRecorder.
+static const G4String gDepositFileName("deposits.bin");
 
 #endif
 
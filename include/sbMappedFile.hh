@@ -0,0 +1,41 @@
+#ifndef SB_MAPPED_FILE_H
+#define SB_MAPPED_FILE_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "globals.hh"
+
+// Read-only memory mapping of a whole file.
+// Note: the mapping is shared by threads, it is never written.
+class sbMappedFile {
+public:
+    sbMappedFile(const G4String& fileName);
+    ~sbMappedFile();
+    sbMappedFile(const sbMappedFile&) = delete;
+    sbMappedFile& operator=(const sbMappedFile&) = delete;
+    //
+    // One mapping per file name for all threads, unmapped when the last user releases it.
+    static std::shared_ptr<const sbMappedFile> MapShared(const G4String& fileName);
+    //
+    // Checks an indexed layout from offset on: an index of numOfRecords + 1 uint64_t,
+    // recordSize bytes per record, then itemSize bytes per item. Record i owns the items
+    // [index[i], index[i + 1]), the index must be ascending and end at numOfItems.
+    // The counts are compared before they are multiplied, so a corrupt header can not
+    // overflow.
+    G4bool HasIndexedRecords(size_t offset, uint64_t numOfRecords, size_t recordSize,
+        uint64_t numOfItems, size_t itemSize) const;
+
+private:
+    G4String fFileName;
+    const char* fData;
+    size_t fSize;
+
+public:
+    const G4String& GetFileName() const { return fFileName; }
+    const char* GetData() const { return fData; }
+    size_t GetSize() const { return fSize; }
+};
+
+#endif
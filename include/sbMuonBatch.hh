@@ -0,0 +1,64 @@
+#ifndef SB_MUON_BATCH_H
+#define SB_MUON_BATCH_H 1
+
+#include <vector>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include "sbConfigs.hh"
+
+#if SB_BATCHED_MUON_GENERATION && !SB_USING_MUON_SPECTRUM_TABLE
+#error "SB_BATCHED_MUON_GENERATION requires SB_USING_MUON_SPECTRUM_TABLE."
+#endif
+
+class sbRunAction;
+
+// Per-thread structure-of-arrays buffer of cosmic muons.
+//
+// Refill() samples a whole batch of candidates at once: random numbers are drawn in
+// bulk with flatArray(), trigonometry and the acceptance cut are plain loops over the
+// arrays that the compiler vectorizes. sbPrimaryGeneratorAction just pops the next entry.
+// Note: a muon is not sampled from the random seeds of the event it is used in,
+//       so single events can not be reproduced from their seeds in this mode.
+class sbMuonBatch {
+public:
+    sbMuonBatch(sbRunAction* runAction);
+    ~sbMuonBatch() {}
+
+    // Next muon in the batch, refill if the batch is used up.
+    // weight is the importance weight of the spectrum biasing, 1 if disabled.
+    void Pop(G4double& energy, G4ThreeVector& position, G4ThreeVector& direction, G4bool& isMuonPlus,
+        G4double& weight);
+
+private:
+    void Refill();
+
+    sbRunAction* fRunAction;
+
+    // Muons ready to use.
+    size_t fSize;
+    size_t fNext;
+    std::vector<G4double> fEnergy;
+    std::vector<G4double> fPositionX;
+    std::vector<G4double> fPositionY;
+    std::vector<G4double> fPositionZ;
+    std::vector<G4double> fDirectionX;
+    std::vector<G4double> fDirectionY;
+    std::vector<G4double> fDirectionZ;
+    std::vector<char> fIsMuonPlus;
+    std::vector<G4double> fWeight;
+
+    // Candidate scratch arrays.
+    std::vector<G4double> fRandom;
+    std::vector<G4int> fThetaBin;
+    std::vector<G4double> fTheta;
+    std::vector<G4double> fSinTheta;
+    std::vector<G4double> fCosTheta;
+    std::vector<G4double> fPhi;
+    std::vector<G4double> fSinPhi;
+    std::vector<G4double> fCosPhi;
+    std::vector<char> fAccepted;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SB_MUON_SPECTRUM_TABLE_H
+#define SB_MUON_SPECTRUM_TABLE_H 1
+
+#include <vector>
+
+#include "globals.hh"
+#include "Randomize.hh"
+
+// Precomputed 2D inverse-CDF table of the cosmic muon (energy, zenith) spectrum.
+//
+// The table holds the marginal CDF in theta and, for every theta bin, the conditional
+// CDF in energy of sbPrimaryGeneratorAction::EnergySpectrum. Inside a cell the
+// spectrum is interpolated linearly in energy, so a sample costs two random numbers,
+// two binary searches and one sqrt, whatever the shape of the spectrum.
+//
+// With SB_ENABLE_MUON_SPECTRUM_BIASING the table samples the spectrum times
+// sbPrimaryGeneratorAction::BiasingFunction, and Weight() gives the importance weight
+// that restores the physical spectrum.
+//
+// It is built once (on the master in MT mode, see ActionInitialization::BuildForMaster)
+// and only read afterwards, so all worker threads share the same instance.
+class sbMuonSpectrumTable {
+public:
+    static const sbMuonSpectrumTable& GetInstance();
+    sbMuonSpectrumTable(const sbMuonSpectrumTable&) = delete;
+    sbMuonSpectrumTable& operator=(const sbMuonSpectrumTable&) = delete;
+private:
+    sbMuonSpectrumTable();
+    ~sbMuonSpectrumTable() {}
+
+public:
+    static constexpr G4int fNumOfThetaBins = 128;
+    static constexpr G4int fNumOfEnergyBins = 512;
+
+private:
+    // Marginal CDF in theta, size fNumOfThetaBins + 1, normalized to 1.
+    std::vector<G4double> fThetaCDF;
+    // Log-spaced energy bin edges in GeV, size fNumOfEnergyBins + 1.
+    std::vector<G4double> fEnergyEdges;
+    // Spectrum at the energy bin edges, fNumOfEnergyBins + 1 per theta bin.
+    std::vector<G4double> fSpectrumAtEdges;
+    // Conditional CDF in energy, fNumOfEnergyBins + 1 per theta bin, normalized to 1.
+    std::vector<G4double> fEnergyCDF;
+    // Integral of the (biased) spectrum over the table range.
+    G4double fIntegral;
+    // Integral of the biased over the unbiased spectrum.
+    G4double fWeightNormalization;
+
+public:
+    // Sample energy (with Geant4 units) and zenith angle.
+    void Sample(G4double& energy, G4double& theta) const {
+        G4int thetaBin = SampleTheta(G4UniformRand(), theta);
+        energy = SampleEnergy(thetaBin, G4UniformRand());
+    }
+    // Sample zenith angle from an uniform random number u, return the theta bin.
+    G4int SampleTheta(G4double u, G4double& theta) const;
+    // Sample energy (with Geant4 units) in theta bin from an uniform random number u.
+    G4double SampleEnergy(G4int thetaBin, G4double u) const;
+
+    // Importance weight of a sample, 1 without biasing.
+    G4double Weight(G4double energy, G4double theta) const;
+
+    G4double GetIntegral() const { return fIntegral; }
+
+private:
+    // Two-sample chi-square comparison with the rejection sampler.
+    void CheckAgainstRejectionSampling(G4int numOfSamples) const;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SB_NOISE_MESSENGER_H
+#define SB_NOISE_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithABool.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/noise/, master only.
+class sbNoiseMessenger : public G4UImessenger {
+public:
+    sbNoiseMessenger();
+    virtual ~sbNoiseMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fNoiseDirectory;
+    G4UIcmdWithABool* fEnableCmd;
+    G4UIcmdWithAString* fSpectrumFileCmd;
+    G4UIcmdWithADouble* fRMSCmd;
+    G4UIcmdWithADoubleAndUnit* fTimeStepCmd;
+    G4UIcmdWithAnInteger* fRingLengthCmd;
+    G4UIcmdWithAnInteger* fSeedCmd;
+    G4UIcmdWithADouble* fBaselineSigmaCmd;
+    G4UIcmdWithADouble* fWanderAmplitudeCmd;
+    G4UIcmdWithADoubleAndUnit* fWanderFrequencyCmd;
+    G4UIcmdWithADouble* fADCLSBCmd;
+    G4UIcmdWithAnInteger* fADCBitsCmd;
+    G4UIcmdWithAnInteger* fADCPedestalCmd;
+};
+
+#endif
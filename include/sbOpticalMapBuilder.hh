@@ -0,0 +1,68 @@
+#ifndef SB_OPTICAL_MAP_BUILDER_H
+#define SB_OPTICAL_MAP_BUILDER_H 1
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "globals.hh"
+
+#include "sbScintillationSpectrum.hh"
+
+class G4Event;
+
+// Run mode that builds the optical response map read by sbOpticalResponseMap.
+//
+// Every event is one voxel of one scintillator: gOpticalMapPhotonsPerVoxel photons are
+// emitted isotropically at uniform positions inside the voxel at t = 0, with energies
+// from the FASTCOMPONENT/SLOWCOMPONENT spectra, and tracked in full. The SiPM hits give
+// the detection probability and the arrival delay quantiles of both SiPMs.
+//
+// Events are distributed over workers as usual. Every finished voxel is written at
+// once to gOpticalResponseMapFileName + ".partial", so an interrupted or short run
+// is resumed by the next run. When all voxels are done the partial file becomes the map.
+// The map is keyed by a hash of the geometry constants, the map binning and the bytes of
+// scintillatorProperties.csv, so it is only rebuilt when one of them changes.
+//
+// Enabled by /smallbox/opticalMap/build (master), shared by all threads.
+class sbOpticalMapBuilder {
+public:
+    static sbOpticalMapBuilder& GetInstance();
+    sbOpticalMapBuilder(const sbOpticalMapBuilder&) = delete;
+    sbOpticalMapBuilder& operator=(const sbOpticalMapBuilder&) = delete;
+
+private:
+    sbOpticalMapBuilder();
+    ~sbOpticalMapBuilder();
+
+    std::atomic<G4bool> fEnabled;
+    G4int fPhotonsPerVoxel;
+
+    // Set on master at the beginning of run, read-only in the event loop.
+    G4int fPartialFile;
+    uint64_t fKey;
+    std::vector<G4int> fPendingVoxels;  // Global voxel index, scintillator * numOfVoxels + voxel.
+    // Photon energies of the fast and slow components.
+    sbScintillationSpectrum fSpectrum;
+
+public:
+    G4bool IsEnabled() const { return fEnabled.load(std::memory_order_relaxed); }
+    void SetEnabled(G4bool enabled);
+    void SetPhotonsPerVoxel(G4int photonsPerVoxel) { fPhotonsPerVoxel = photonsPerVoxel; }
+
+    // Master, around the event loop.
+    void BeginOfRun();
+    void EndOfRun();
+    // Workers.
+    void GeneratePrimaries(G4Event* event) const;
+    void RecordEvent(const G4Event* event) const;
+
+    // Key of the map for the present geometry and optical properties.
+    static uint64_t ComputeKey();
+
+private:
+    static G4int NumOfVoxels();
+    void Finalize();
+};
+
+#endif
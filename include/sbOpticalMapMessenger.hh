@@ -0,0 +1,24 @@
+#ifndef SB_OPTICAL_MAP_MESSENGER_H
+#define SB_OPTICAL_MAP_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/opticalMap/, master only.
+class sbOpticalMapMessenger : public G4UImessenger {
+public:
+    sbOpticalMapMessenger();
+    virtual ~sbOpticalMapMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fOpticalMapDirectory;
+    G4UIcmdWithABool* fBuildCmd;
+    G4UIcmdWithAnInteger* fPhotonsPerVoxelCmd;
+};
+
+#endif
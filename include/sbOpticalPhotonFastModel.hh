@@ -0,0 +1,57 @@
+#ifndef SB_OPTICAL_PHOTON_FAST_MODEL_H
+#define SB_OPTICAL_PHOTON_FAST_MODEL_H 1
+
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+
+#include "sbOpticalResponseMap.hh"
+#include "sbScintillationSpectrum.hh"
+
+class G4Region;
+class G4Step;
+class G4EmSaturation;
+class G4VPhysicalVolume;
+class sbSiPMSD;
+
+// Fast simulation of the optical photons in the scintillators.
+//
+// Scintillation light is sampled per energy deposit: sbScintillatorSD hands every step in
+// a scintillator to SampleDeposit, which draws the number of photons as G4Scintillation
+// does (Birks-corrected visible energy, yield and resolution scale, fast/slow components,
+// uniform along the step) and detects each by one of the SiPMs with the probability of
+// the response map at its emission point, with an arrival time sampled from the map.
+// No photon track is made, G4Scintillation is not registered in this mode (sbPhysicsList).
+// Detected photons are added to sbSiPMSD, so everything downstream is unchanged.
+//
+// Attached to the scintillator region, the model also kills the remaining optical photons
+// (Cerenkov, replayed or entering from outside) at their first step and detects them the
+// same way, treated as emitted there.
+// Note: without the response map, no scintillation light is simulated except while the map
+//       is built (/smallbox/opticalMap/build).
+class sbOpticalPhotonFastModel : public G4VFastSimulationModel {
+public:
+    sbOpticalPhotonFastModel(G4Region* envelope);
+    virtual ~sbOpticalPhotonFastModel() {}
+
+    virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+    virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+    virtual void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+    void SampleDeposit(const G4Step* step);
+
+private:
+    void Initialize();
+    G4int ScintillatorID(const G4VPhysicalVolume* volume) const;
+    // SiPM detecting a photon emitted in the voxel and its arrival delay, false if none does.
+    G4bool SampleDetection(G4int scintillatorID, G4int voxel, G4int& SiPMID, G4double& delay) const;
+
+    const sbOpticalResponseMap& fResponseMap;
+    // Found at the first photon or deposit, after the physics and SDs of this thread are built.
+    G4bool fInitialized;
+    sbSiPMSD* fSiPMSD;
+    sbScintillationSpectrum fSpectrum;
+    G4bool fSpectrumBuilt;
+    G4EmSaturation* fEmSaturation;
+};
+
+#endif
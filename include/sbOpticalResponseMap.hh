@@ -0,0 +1,71 @@
+#ifndef SB_OPTICAL_RESPONSE_MAP_H
+#define SB_OPTICAL_RESPONSE_MAP_H 1
+
+#include <cstdint>
+#include <memory>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include "sbMappedFile.hh"
+
+// Binary light-collection map, used in place (memory-mapped).
+// All numbers are little-endian.
+//
+// [sbOpticalResponseMapHeader]
+// [float entry[2][numOfVoxels][2][1 + numOfQuantiles]]
+//
+// entry[scintillator][voxel][SiPM] is the probability that a photon emitted isotropically
+// in the voxel of the scintillator is detected by the SiPM, followed by the quantiles of
+// the arrival delay (ns) at cumulative probabilities k / (numOfQuantiles - 1).
+// Voxels are an x-fastest grid over the scintillator in its local frame.
+struct sbOpticalResponseMapHeader {
+    char     magic[8];        // "SBOPTMAP"
+    uint32_t version;         // 1
+    uint32_t numOfQuantiles;
+    uint32_t numOfBins[3];
+    uint32_t reserved;
+    uint64_t key;             // Hash of the geometry and optical properties the map is made for.
+};
+
+static_assert(sizeof(sbOpticalResponseMapHeader) == 40, "sbOpticalResponseMapHeader must be packed.");
+
+// Read-only response map shared by all threads, loaded from gOpticalResponseMapFileName
+// at the first call of GetInstance(). If the file is missing or invalid, IsLoaded()
+// is false, the remaining optical photons are tracked as usual and no scintillation light
+// is sampled.
+class sbOpticalResponseMap {
+public:
+    static const sbOpticalResponseMap& GetInstance();
+    sbOpticalResponseMap(const sbOpticalResponseMap&) = delete;
+    sbOpticalResponseMap& operator=(const sbOpticalResponseMap&) = delete;
+
+private:
+    sbOpticalResponseMap();
+    ~sbOpticalResponseMap() {}
+
+    std::unique_ptr<const sbMappedFile> fMappedFile;
+    const sbOpticalResponseMapHeader* fHeader;
+    const float* fEntries;
+    G4int fNumOfVoxels;
+    G4int fEntrySize;
+
+public:
+    G4bool IsLoaded() const { return fEntries != nullptr; }
+    uint64_t GetKey() const { return fHeader->key; }
+
+    // Voxel of a position in the local frame of a scintillator.
+    G4int Voxel(const G4ThreeVector& localPosition) const;
+    G4double GetDetectionProbability(G4int scintillatorID, G4int voxel, G4int SiPMID) const {
+        return Entry(scintillatorID, voxel, SiPMID)[0];
+    }
+    // Arrival delay from an uniform random number u.
+    G4double SampleDelay(G4int scintillatorID, G4int voxel, G4int SiPMID, G4double u) const;
+
+private:
+    const float* Entry(G4int scintillatorID, G4int voxel, G4int SiPMID) const {
+        return fEntries + ((scintillatorID * fNumOfVoxels + voxel) * 2 + SiPMID) * fEntrySize;
+    }
+};
+
+#endif
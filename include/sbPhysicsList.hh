@@ -11,6 +11,7 @@
 #include "G4HadronElasticPhysics.hh"
 #include "G4IonPhysics.hh"
 #include "G4StepLimiterPhysics.hh"
+#include "G4FastSimulationPhysics.hh"
 
 #include "G4MuonPlus.hh"
 #include "G4MuonMinus.hh"
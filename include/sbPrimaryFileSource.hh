@@ -0,0 +1,63 @@
+#ifndef SB_PRIMARY_FILE_SOURCE_H
+#define SB_PRIMARY_FILE_SOURCE_H 1
+
+#include <cstdint>
+#include <memory>
+
+#include "globals.hh"
+
+#include "sbMappedFile.hh"
+
+class G4Event;
+
+// Binary primary file, e.g. converted from a cosmic shower library.
+// All numbers are little-endian, the file is used in place (memory-mapped), so the
+// layout must not be changed without changing the version.
+//
+// [sbPrimaryFileHeader]
+// [uint64_t firstParticle[numOfEvents + 1]]     : Event i owns particles [firstParticle[i], firstParticle[i + 1]).
+// [sbPrimaryFileParticle particle[numOfParticles]]
+//
+// An event may hold any number of particles, e.g. a multi-muon bundle.
+struct sbPrimaryFileHeader {
+    char     magic[8];        // "SBPRIMRY"
+    uint32_t version;         // 1
+    uint32_t reserved;
+    uint64_t numOfEvents;
+    uint64_t numOfParticles;
+};
+
+struct sbPrimaryFileParticle {
+    int32_t pdgCode;
+    float   weight;
+    float   kineticEnergy;    // MeV
+    float   time;             // ns
+    float   position[3];      // mm
+    float   direction[3];     // Need not be normalized.
+};
+
+static_assert(sizeof(sbPrimaryFileHeader) == 32, "sbPrimaryFileHeader must be packed.");
+static_assert(sizeof(sbPrimaryFileParticle) == 40, "sbPrimaryFileParticle must be packed.");
+
+// Per-thread reader of a primary file.
+// The file is mapped once and shared. Event i of a run is record i of the file, whichever
+// thread processes it, so a run is reproducible with any number of threads. A run of more
+// events than the file holds is refused at its start (CheckNumOfEvents).
+class sbPrimaryFileSource {
+public:
+    sbPrimaryFileSource(const G4String& fileName);
+    ~sbPrimaryFileSource() {}
+
+    void GeneratePrimaries(G4Event* event);
+    //
+    // Fatal if numOfEvents (the events of the run) exceed the records of the file.
+    void CheckNumOfEvents(G4int numOfEvents) const;
+
+private:
+    std::shared_ptr<const sbMappedFile> fMappedFile;
+    uint64_t fNumOfEvents;
+    const uint64_t* fFirstParticle;
+    const sbPrimaryFileParticle* fParticles;
+};
+
+#endif
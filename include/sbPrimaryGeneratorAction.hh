@@ -17,27 +17,89 @@
 
 #include "sbDetectorConstruction.hh"
 #include "CreateMapFromCSV.hh"
+#include "sbMuonSpectrumTable.hh"
+#include "sbMuonBatch.hh"
+#include "sbPrimaryFileSource.hh"
+#include "sbDepositReplaySource.hh"
+#include "sbPrimaryGeneratorMessenger.hh"
+#include "sbConfigs.hh"
+
+#if SB_ENABLE_MUON_SPECTRUM_BIASING && !SB_USING_MUON_SPECTRUM_TABLE
+#error "SB_ENABLE_MUON_SPECTRUM_BIASING requires SB_USING_MUON_SPECTRUM_TABLE."
+#endif
 
 class sbDetectorConstruction;
+class sbRunAction;
 class G4ParticleGun;
 class G4Event;
 class G4Sphere;
 
 class sbPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
+public:
+    enum sbPrimarySource {
+        fAnalyticSource,
+        fFileSource,
+        fReplaySource
+    };
+
 private:
     G4ParticleGun* fParticleGun;
+    sbRunAction* fRunAction;
+    // Importance weight of the muon set to the particle gun.
+    G4double fMuonWeight;
+#if SB_BATCHED_MUON_GENERATION
+    sbMuonBatch* fMuonBatch;
+#endif
+    sbPrimaryGeneratorMessenger* fMessenger;
+
+    sbPrimarySource fSource;
+    G4String fInputFileName;
+    //
+    // Opened at the first event of the file source.
+    sbPrimaryFileSource* fPrimaryFileSource;
+    sbDepositReplaySource* fDepositReplaySource;
+    //
+    // Exponents of BiasingFunction, shared by all threads.
+    static G4double fEnergyBiasIndex;
+    static G4double fZenithBiasIndex;
 
 public:
-    sbPrimaryGeneratorAction();
+    sbPrimaryGeneratorAction(sbRunAction* runAction);
     virtual ~sbPrimaryGeneratorAction();
     virtual void GeneratePrimaries(G4Event*);
     inline const G4ParticleGun* GetParticleGun() const { return fParticleGun; }
 
-private:
-    G4double EnergySpectrum(G4double E_GeV, G4double theta) const;
-    void FindEnergyAndTheta(G4double& energy, G4double& theta) const;
+    void SetSource(sbPrimarySource source) { fSource = source; }
+    //
+    // Called by the run action of the thread: opens the file or replay source and refuses
+    // runs of more events than it holds.
+    void BeginOfRun(G4int numOfEvents);
+    void SetInputFileName(const G4String& fileName);
+    //
+    // Muon hit mask recorded with the current event, -1 unless the source is replay.
+    G4int GetReplayedMuonHitMask() const;
 
-    void SetMuonProperties() const;
+    static G4double EnergySpectrum(G4double E_GeV, G4double theta);
+    //
+    // Factor applied to EnergySpectrum when SB_ENABLE_MUON_SPECTRUM_BIASING, 1 otherwise.
+    static G4double BiasingFunction(G4double E_GeV, G4double theta);
+    // Master, before sbMuonSpectrumTable is built (see sbBiasingMessenger).
+    static void SetEnergyBiasIndex(G4double index) { fEnergyBiasIndex = index; }
+    static void SetZenithBiasIndex(G4double index) { fZenithBiasIndex = index; }
+    //
+    // Rejection sampling of EnergySpectrum.
+    // Note: slow, the acceptance is below 0.1%. Use sbMuonSpectrumTable instead.
+    static void FindEnergyAndTheta(G4double& energy, G4double& theta);
+
+private:
+    void SetMuonProperties();
+    //
+    // Muon start point on the generation sphere (relative to its centre) and the
+    // sphere centre, for a given zenith angle.
+    static void SampleTrajectory(G4double theta, G4ThreeVector& relativePositionVec, G4ThreeVector& sphereCentre);
+    //
+    // Ray test of a trajectory against the scintillators' bounding boxes.
+    static G4bool CrossScintillators(const G4ThreeVector& sphereCentre, const G4ThreeVector& direction);
 };
 
 #endif
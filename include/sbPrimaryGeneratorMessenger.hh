@@ -0,0 +1,28 @@
+#ifndef SB_PRIMARY_GENERATOR_MESSENGER_H
+#define SB_PRIMARY_GENERATOR_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "globals.hh"
+
+class sbPrimaryGeneratorAction;
+
+// Commands under /smallbox/gun/.
+class sbPrimaryGeneratorMessenger : public G4UImessenger {
+public:
+    sbPrimaryGeneratorMessenger(sbPrimaryGeneratorAction* primaryGenerator);
+    virtual ~sbPrimaryGeneratorMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    sbPrimaryGeneratorAction* fPrimaryGenerator;
+
+    G4UIdirectory* fSmallboxDirectory;
+    G4UIdirectory* fGunDirectory;
+    G4UIcmdWithAString* fSourceCmd;
+    G4UIcmdWithAString* fInputFileCmd;
+};
+
+#endif
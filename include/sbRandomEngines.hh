@@ -0,0 +1,30 @@
+#ifndef SB_RANDOM_ENGINES_H
+#define SB_RANDOM_ENGINES_H 1
+
+#include "CLHEP/Random/RandomEngine.h"
+#include "globals.hh"
+
+// Selectable random engines.
+//
+// The engine is selected in main() before the run manager is constructed, because
+// G4MTRunManager keeps the master engine to seed and clone the worker engines
+// (see sbWorkerThreadInitialization). Default is set by SB_USING_XOSHIRO_ENGINE,
+// the environment variable SB_RANDOM_ENGINE overrides it.
+//
+// Bulk draws: use G4Random::getTheEngine()->flatArray(), every engine implements it
+// and sbXoshiroEngine does it in a tight loop.
+class sbRandomEngines {
+public:
+    // Space-separated names of the selectable engines.
+    static const char* Candidates() { return "xoshiro mixmax james ranecu ranlux64"; }
+    // New engine by name, nullptr if unknown.
+    static CLHEP::HepRandomEngine* NewEngine(const G4String& engineName);
+    // Make the named engine the engine of this thread, the seed is kept.
+    static void SelectEngine(const G4String& engineName);
+    // Select the engine from SB_RANDOM_ENGINE or the compile-time default.
+    static void SelectEngineAtStartUp();
+    // Time flat() and flatArray() of all selectable engines.
+    static void Benchmark(G4int numOfNumbers);
+};
+
+#endif
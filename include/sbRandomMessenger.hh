@@ -0,0 +1,22 @@
+#ifndef SB_RANDOM_MESSENGER_H
+#define SB_RANDOM_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/random/, master only.
+class sbRandomMessenger : public G4UImessenger {
+public:
+    sbRandomMessenger();
+    virtual ~sbRandomMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fRandomDirectory;
+    G4UIcmdWithAnInteger* fBenchmarkCmd;
+};
+
+#endif
@@ -8,6 +8,8 @@
 #include "sbGlobal.hh"
 
 class G4Run;
+class sbSteppingAction;
+class sbPrimaryGeneratorAction;
 
 class sbRunAction : public G4UserRunAction {
 public:
@@ -20,8 +22,30 @@ public:
 
     G4ToolsAnalysisManager* fAnalysisManager;
 
+    //
+    // Called by the primary generator with the number of candidates thrown for
+    // numOfMuons generated muons and the sum of their importance weights.
+    // Used for the geometric acceptance.
+    void CountMuonCandidates(G4int numOfCandidates, G4int numOfMuons, G4double sumOfWeights) {
+        fNumOfMuonCandidates += numOfCandidates;
+        fNumOfGeneratedMuons += numOfMuons;
+        fSumOfMuonWeights += sumOfWeights;
+    }
+
+    // Worker stepping action, its photon kill counters are reset and printed per run.
+    void SetSteppingAction(sbSteppingAction* steppingAction) { fSteppingAction = steppingAction; }
+    // Worker primary generator, its file sources are checked against the run.
+    void SetPrimaryGeneratorAction(sbPrimaryGeneratorAction* primaryGenerator) { fPrimaryGenerator = primaryGenerator; }
+
 private:
-    void CreateTreeAndHistrogram(G4int numberOfEvent) const;
+    void CreateTreeAndHistrogram() const;
+
+    G4Accumulable<G4double> fNumOfMuonCandidates;
+    G4Accumulable<G4double> fNumOfGeneratedMuons;
+    G4Accumulable<G4double> fSumOfMuonWeights;
+
+    sbSteppingAction* fSteppingAction;
+    sbPrimaryGeneratorAction* fPrimaryGenerator;
 };
 
 #endif
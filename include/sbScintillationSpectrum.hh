@@ -0,0 +1,50 @@
+#ifndef SB_SCINTILLATION_SPECTRUM_H
+#define SB_SCINTILLATION_SPECTRUM_H 1
+
+#include <vector>
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4Material;
+
+// Scintillation properties of a material as G4Scintillation uses them: photon energy
+// CDFs of the fast and slow components (trapezoid rule), yield, resolution scale,
+// yield ratio and time constants.
+class sbScintillationSpectrum {
+public:
+    sbScintillationSpectrum();
+    ~sbScintillationSpectrum() {}
+
+    // False (and a warning) if the material has no scintillation properties.
+    G4bool Build(const G4Material* material);
+
+    // Number of photons for a mean number, Gaussian with the resolution scale above 10,
+    // Poisson below, as G4Scintillation.
+    G4int SampleNumOfPhotons(G4double meanNumOfPhotons) const;
+    // Fast component with probability YIELDRATIO.
+    G4bool SampleFastComponent() const;
+    G4double SamplePhotonEnergy(G4bool fastComponent) const;
+    G4double SamplePhotonEnergy() const { return SamplePhotonEnergy(SampleFastComponent()); }
+    // Isotropic direction and a random linear polarization perpendicular to it.
+    static void SamplePhotonDirection(G4ThreeVector& direction, G4ThreeVector& polarization);
+
+    G4double GetYield() const { return fYield; }
+    G4double GetResolutionScale() const { return fResolutionScale; }
+    G4double GetYieldRatio() const { return fYieldRatio; }
+    G4double GetFastTimeConstant() const { return fFastTimeConstant; }
+    G4double GetSlowTimeConstant() const { return fSlowTimeConstant; }
+
+private:
+    std::vector<G4double> fFastComponentEnergies;
+    std::vector<G4double> fFastComponentCDF;
+    std::vector<G4double> fSlowComponentEnergies;
+    std::vector<G4double> fSlowComponentCDF;
+    G4double fYield;
+    G4double fResolutionScale;
+    G4double fYieldRatio;
+    G4double fFastTimeConstant;
+    G4double fSlowTimeConstant;
+};
+
+#endif
@@ -18,6 +18,7 @@ private:
     G4ThreeVector               fMomentumDirection;
     G4double                    fKineticEnergy;
     G4double                    fEnergyDeposition;
+    G4double                    fWeight;
     const G4ParticleDefinition* fParticleDefinition;
 
 public:
@@ -43,6 +44,7 @@ public:
     const G4ThreeVector& GetMomentumDirection() const { return fMomentumDirection; }
     const G4double& GetKineticEnergy() const { return fKineticEnergy; }
     const G4double& GetEnergyDeposition() const { return fEnergyDeposition; }
+    const G4double& GetWeight() const { return fWeight; }
     const G4ParticleDefinition* GetParticleDefinition() const { return fParticleDefinition; }
 
     void SetScintillatorID(const G4int& scintillatorID) { fScintillatorID = scintillatorID; }
@@ -51,6 +53,7 @@ public:
     void SetMomentumDirection(const G4ThreeVector& position) { fPosition = position; }
     void SetKineticEnergy(const G4double& kineticEnergy) { fKineticEnergy = kineticEnergy; }
     void SetEnergyDeposition(const G4double& energyDeposition) { fEnergyDeposition = energyDeposition; }
+    void SetWeight(const G4double& weight) { fWeight = weight; }
     void SetParticleDefinition(const G4ParticleDefinition* particleDefinition) {
         fParticleDefinition = particleDefinition;
     }
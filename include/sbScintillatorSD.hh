@@ -6,12 +6,19 @@
 #include "g4analysis.hh"
 
 #include "sbScintillatorHit.hh"
+#include "sbConfigs.hh"
+
+class sbOpticalPhotonFastModel;
 
 class sbScintillatorSD : public G4VSensitiveDetector {
 private:
     sbScintillatorHitsCollection* fMuonHitsCollection;
 
     G4ToolsAnalysisManager* fAnalysisManager;
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    // Samples the scintillation light of every step, see sbOpticalPhotonFastModel.
+    sbOpticalPhotonFastModel* fOpticalFastModel;
+#endif
 
 public:
     sbScintillatorSD(const G4String& scintillatorSDName);
@@ -20,6 +27,9 @@ public:
     virtual void Initialize(G4HCofThisEvent* eventHitCollection);
     virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory*);
     virtual void EndOfEvent(G4HCofThisEvent*);
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    void SetOpticalFastModel(sbOpticalPhotonFastModel* model) { fOpticalFastModel = model; }
+#endif
 
 private:
     void FillHistrogram() const;
@@ -0,0 +1,64 @@
+#ifndef SB_SIPM_DIGI_H
+#define SB_SIPM_DIGI_H 1
+
+#include "G4VDigi.hh"
+#include "G4TDigiCollection.hh"
+#include "G4Allocator.hh"
+
+#include "sbGlobal.hh"
+
+// One avalanche of a SiPM microcell, made by sbSiPMDigitizer.
+class sbSiPMDigi : public G4VDigi {
+public:
+    enum sbAvalancheType {
+        fPhotoelectron,
+        fCrosstalk,
+        fAfterpulse,
+        fDarkCount
+    };
+
+private:
+    G4double        fTime;
+    G4int           fSiPMID;    // sbSiPMHit::sbSiPMSet
+    G4int           fPixel;
+    G4double        fCharge;    // In single photoelectrons, below 1 if the microcell is recovering.
+    sbAvalancheType fType;
+
+public:
+    sbSiPMDigi();
+    sbSiPMDigi(const sbSiPMDigi& rhs);
+    ~sbSiPMDigi();
+    const sbSiPMDigi& operator=(const sbSiPMDigi& rhs);
+    G4bool operator==(const sbSiPMDigi& rhs) const { return this == &rhs; }
+    inline void* operator new(size_t);
+    inline void operator delete(void* aDigi);
+
+    const G4double& GetTime() const { return fTime; }
+    G4int GetSiPMID() const { return fSiPMID; }
+    G4int GetPixel() const { return fPixel; }
+    const G4double& GetCharge() const { return fCharge; }
+    sbAvalancheType GetType() const { return fType; }
+
+    void SetTime(const G4double& time) { fTime = time; }
+    void SetSiPMID(G4int SiPMID) { fSiPMID = SiPMID; }
+    void SetPixel(G4int pixel) { fPixel = pixel; }
+    void SetCharge(const G4double& charge) { fCharge = charge; }
+    void SetType(sbAvalancheType type) { fType = type; }
+};
+
+typedef G4TDigiCollection<sbSiPMDigi> sbSiPMDigitsCollection;
+
+extern G4ThreadLocal G4Allocator<sbSiPMDigi>* sbSiPMDigiAllocator;
+
+inline void* sbSiPMDigi::operator new(size_t) {
+    if (!sbSiPMDigiAllocator) {
+        sbSiPMDigiAllocator = new G4Allocator<sbSiPMDigi>();
+    }
+    return (void*)sbSiPMDigiAllocator->MallocSingle();
+}
+
+inline void sbSiPMDigi::operator delete(void* aDigi) {
+    sbSiPMDigiAllocator->FreeSingle(static_cast<sbSiPMDigi*>(aDigi));
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SB_SIPM_DIGITIZER_H
+#define SB_SIPM_DIGITIZER_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "G4VDigitizerModule.hh"
+
+#include "sbSiPMDigi.hh"
+#include "sbSiPMPhotonBuffer.hh"
+
+class sbSiPMDigitizerMessenger;
+class sbSiPMSD;
+
+// Microcell-level SiPM digitizer, the photons of both SiPMs of an event (the photon
+// buffers of sbSiPMSD) to avalanches (sbSiPMDigitsCollection, in time order):
+//
+// -> Photoelectrons: a photon of weight w stands for floor(w) photons plus one with the
+//    probability of the fraction, each converted with the PDE at its energy if the PDE is
+//    applied here. The first photon fires the microcell at the hit position, the others
+//    and photons without a position (fast simulation) a uniformly random one.
+// -> Dark counts: Poisson number over the readout window after the event T0, uniform in
+//    time and microcell.
+// -> Optical crosstalk: every avalanche fires Poisson(-ln(1 - p)) prompt avalanches in
+//    nearest-neighbour microcells, p scaled by the avalanche charge.
+// -> Afterpulsing: with a probability scaled by the charge, the microcell fires again after
+//    an exponential delay.
+// -> Recovery and saturation: a microcell firing again dt after its last avalanche gives
+//    a charge of 1 - exp(-dt / recoveryTime), so a saturated SiPM stops growing.
+//
+// Avalanches are processed in time order from a heap, the fired microcells are a bitset
+// reset through the list of fired ones, so the cost is O(photoelectrons), not O(microcells).
+//
+// One per thread, registered to G4DigiManager by sbDetectorConstruction, configured by
+// /smallbox/digitizer/.
+class sbSiPMDigitizer : public G4VDigitizerModule {
+public:
+    sbSiPMDigitizer(const G4String& name);
+    virtual ~sbSiPMDigitizer();
+
+    virtual void Digitize();
+
+    void SetCrosstalkProbability(G4double probability) { fCrosstalkProbability = probability; }
+    void SetAfterpulseProbability(G4double probability) { fAfterpulseProbability = probability; }
+    void SetAfterpulseTimeConstant(G4double timeConstant) { fAfterpulseTimeConstant = timeConstant; }
+    void SetRecoveryTime(G4double recoveryTime) { fRecoveryTime = recoveryTime; }
+    void SetDarkCountRate(G4double rate) { fDarkCountRate = rate; }
+    void SetReadoutWindow(G4double window) { fReadoutWindow = window; }
+    G4double GetReadoutWindow() const { return fReadoutWindow; }
+    void SetApplyPDE(G4bool apply) { fApplyPDE = apply; }
+
+private:
+    struct sbAvalanche {
+        G4double time;
+        G4int SiPMID;
+        G4int pixel;
+        sbSiPMDigi::sbAvalancheType type;
+        G4bool operator>(const sbAvalanche& rhs) const { return time > rhs.time; }
+    };
+
+    void AddPhotoelectrons(const sbSiPMPhotonBuffer& photons, size_t index, G4int SiPMID);
+    void AddDarkCounts(G4int SiPMID, G4double T0);
+    void Fire(const sbAvalanche& avalanche, sbSiPMDigitsCollection* digits);
+    void ResetPixels();
+    G4int PixelAt(const G4ThreeVector& localPosition) const;
+    G4int RandomPixel() const;
+    G4double PDE(G4double photonEnergy) const;
+
+    sbSiPMDigitizerMessenger* fMessenger;
+    const sbSiPMSD* fSiPMSD;
+
+    G4double fCrosstalkProbability;
+    G4double fAfterpulseProbability;
+    G4double fAfterpulseTimeConstant;
+    G4double fRecoveryTime;
+    G4double fDarkCountRate;
+    G4double fReadoutWindow;
+    G4bool fApplyPDE;
+    std::vector<G4double> fPDEEnergies;
+    std::vector<G4double> fPDEValues;
+
+    const G4int fNumOfPixelsPerRow;
+    const G4int fNumOfPixels;
+    // Microcells of both SiPMs, SiPMID * fNumOfPixels + pixel.
+    std::vector<uint64_t> fFiredPixelBits;
+    std::vector<G4double> fLastFireTimes;   // Valid for fired microcells only.
+    std::vector<G4int> fFiredPixels;
+    // Min-heap on time, kept between events for its capacity.
+    std::vector<sbAvalanche> fAvalanches;
+};
+
+#endif
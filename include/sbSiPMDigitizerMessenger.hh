@@ -0,0 +1,34 @@
+#ifndef SB_SIPM_DIGITIZER_MESSENGER_H
+#define SB_SIPM_DIGITIZER_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithABool.hh"
+#include "globals.hh"
+
+class sbSiPMDigitizer;
+
+// Commands under /smallbox/digitizer/.
+class sbSiPMDigitizerMessenger : public G4UImessenger {
+public:
+    sbSiPMDigitizerMessenger(sbSiPMDigitizer* digitizer);
+    virtual ~sbSiPMDigitizerMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    sbSiPMDigitizer* fDigitizer;
+
+    G4UIdirectory* fDigitizerDirectory;
+    G4UIcmdWithADouble* fCrosstalkCmd;
+    G4UIcmdWithADouble* fAfterpulseCmd;
+    G4UIcmdWithADoubleAndUnit* fAfterpulseTimeCmd;
+    G4UIcmdWithADoubleAndUnit* fRecoveryTimeCmd;
+    G4UIcmdWithADoubleAndUnit* fDarkCountRateCmd;
+    G4UIcmdWithADoubleAndUnit* fReadoutWindowCmd;
+    G4UIcmdWithABool* fApplyPDECmd;
+};
+
+#endif
@@ -13,6 +13,9 @@ class sbSiPMHit : public G4VHit {
 private:
     G4double      fTime;
     G4double      fEnergy;
+    G4double      fWeight;    // Number of photons the hit stands for.
+    G4ThreeVector fLocalPosition;   // In the SiPM frame.
+    G4bool        fLocated;         // False if the position is unknown, e.g. fast simulation.
 
 public:
     static enum sbSiPMSet {
@@ -31,9 +34,17 @@ public:
 
     const G4double& GetTime() const { return fTime; }
     const G4double& GetEnergy() const { return fEnergy; }
+    const G4double& GetWeight() const { return fWeight; }
+    const G4ThreeVector& GetLocalPosition() const { return fLocalPosition; }
+    G4bool IsLocated() const { return fLocated; }
 
     void SetTime(const G4double& time) { fTime = time; }
     void SetEnergy(const G4double& energy) { fEnergy = energy; }
+    void SetWeight(const G4double& weight) { fWeight = weight; }
+    void SetLocalPosition(const G4ThreeVector& localPosition) {
+        fLocalPosition = localPosition;
+        fLocated = true;
+    }
 };
 
 typedef G4THitsCollection<sbSiPMHit> sbSiPMHitsCollection;
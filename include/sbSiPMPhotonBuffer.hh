@@ -0,0 +1,60 @@
+#ifndef SB_SIPM_PHOTON_BUFFER_H
+#define SB_SIPM_PHOTON_BUFFER_H 1
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+// Photons detected by one SiPM in an event as a structure of arrays of floats, owned
+// by the (per thread) sbSiPMSD and reused by every event, so a bright event costs no
+// allocation once the arrays have grown. Times are stored relative to the event T0
+// (primary vertex time), a float keeps sub-picosecond precision over microseconds.
+//
+// Sort orders the photons by time with an LSD radix sort of the float bits, 8 bits per
+// pass, O(photons) instead of sorting hit pointers.
+class sbSiPMPhotonBuffer {
+public:
+    sbSiPMPhotonBuffer();
+
+    void Clear(G4double T0);
+    void Add(G4double time, G4double energy, G4double weight, const G4ThreeVector* localPosition);
+    void Sort();
+
+    size_t Size() const { return fTimes.size(); }
+    G4bool Empty() const { return fTimes.empty(); }
+    G4double GetT0() const { return fT0; }
+
+    G4double GetTime(size_t i) const { return fT0 + fTimes[i] * ns; }
+    G4double GetEnergy(size_t i) const { return fEnergies[i] * eV; }
+    G4double GetWeight(size_t i) const { return fWeights[i]; }
+    G4bool IsLocated(size_t i) const { return !std::isnan(fLocalX[i]); }
+    G4ThreeVector GetLocalPosition(size_t i) const { return G4ThreeVector(fLocalX[i] * mm, fLocalY[i] * mm, 0.0); }
+    void SetWeight(size_t i, G4double weight) { fWeights[i] = weight; }
+
+    // Times in ns after T0, for loops over all photons.
+    const std::vector<float>& GetRelativeTimes() const { return fTimes; }
+    const std::vector<float>& GetWeights() const { return fWeights; }
+
+private:
+    void Gather(std::vector<float>& values);
+
+    G4double fT0;
+    std::vector<float> fTimes;      // ns after fT0
+    std::vector<float> fEnergies;   // eV
+    std::vector<float> fWeights;
+    std::vector<float> fLocalX;     // mm in the SiPM frame, NaN if not located
+    std::vector<float> fLocalY;
+
+    // Sort scratch, kept for its capacity.
+    std::vector<uint32_t> fKeys;
+    std::vector<uint32_t> fOrder;
+    std::vector<uint32_t> fScratchKeys;
+    std::vector<uint32_t> fScratchOrder;
+    std::vector<float> fScratchValues;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef SB_SIPM_RESPONSE_CORE_H
+#define SB_SIPM_RESPONSE_CORE_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sbWaveformFormat.hh"
+
+// Geant4-free core of the SiPM response, shared by smallbox (sbWaveformSynthesizer,
+// sbFeatureExtractor, sbSiPMDigitizer) and tools/waveformReader (sbWaveformResynthesizer),
+// so re-synthesized waveforms are made by the same code. Standard library only, times in
+// any one unit (Geant4 units are ns), amplitudes in single photoelectron peaks.
+
+// Single photoelectron pulse of a waveform, amplitude in photoelectrons.
+struct sbPulse {
+    double time;
+    double amplitude;
+};
+
+inline bool sbEarlierPulse(const sbPulse& lhs, const sbPulse& rhs) { return lhs.time < rhs.time; }
+
+// Sub-sample phases of the tabulated pulse kernel.
+constexpr int gWaveformKernelPhases = 8;
+// Time constants before the first sample past which an exponential pulse is below float
+// precision (exp(-50) ~ 2e-22) and is not added.
+constexpr double gExponentialPulseHorizon = 50.0;
+
+// Amplitude of (exp(-t/fall) - exp(-t/rise)) normalizing its peak to 1.
+inline double sbBiexponentialNorm(double riseTime, double fallTime) {
+    // Peak at riseTime * fallTime / (fallTime - riseTime) * ln(fallTime / riseTime).
+    const double peakTime = riseTime * fallTime / (fallTime - riseTime) * std::log(fallTime / riseTime);
+    return 1.0 / (std::exp(-peakTime / fallTime) - std::exp(-peakTime / riseTime));
+}
+
+// Adds amplitude * exp(-(t - t_pulse) / timeConstant) of the pulses (sorted by time) to the
+// uniform samples, O(samples + pulses near them):
+// state(k) = state(k - 1) * exp(-timeStep / timeConstant) + pulses in (t(k - 1), t(k)].
+inline void sbAddExponentialPulses(const std::vector<sbPulse>& pulses, double startTime, double timeStep,
+    double timeConstant, double amplitude, float* waveform, size_t numOfSamples) {
+    const double decay = std::exp(-timeStep / timeConstant);
+    double state = 0.0;
+    auto pulse = std::lower_bound(pulses.begin(), pulses.end(), startTime - gExponentialPulseHorizon * timeConstant,
+        [](const sbPulse& lhs, double time) { return lhs.time < time; });
+    for (size_t k = 0; k < numOfSamples; ++k) {
+        const double sampleTime = startTime + k * timeStep;
+        state *= decay;
+        for (; pulse != pulses.end() && pulse->time <= sampleTime; ++pulse) {
+            state += pulse->amplitude * std::exp((pulse->time - sampleTime) / timeConstant);
+        }
+        waveform[k] += amplitude * state;
+    }
+}
+
+// Measured single photoelectron pulse, linear between the points, 0 outside. Every table
+// made from points has its own ID, kernel caches tell the tables apart by it.
+class sbPulseTable {
+public:
+    sbPulseTable() : fTimes(), fAmplitudes(), fID(0) {}
+    // Ascending times, as many amplitudes.
+    sbPulseTable(const std::vector<double>& times, const std::vector<double>& amplitudes) :
+        fTimes(times),
+        fAmplitudes(amplitudes),
+        fID(NextID()) {}
+
+    bool Empty() const { return fTimes.size() < 2; }
+    double GetLength() const { return fTimes.back(); }
+    uint64_t GetID() const { return fID; }
+
+    double Amplitude(double time) const {
+        if (time < fTimes.front() || time > fTimes.back()) { return 0.0; }
+        const size_t i = std::upper_bound(fTimes.begin(), fTimes.end(), time) - fTimes.begin();
+        if (i == fTimes.size()) { return fAmplitudes.back(); }
+        const double fraction = (time - fTimes[i - 1]) / (fTimes[i] - fTimes[i - 1]);
+        return fAmplitudes[i - 1] + fraction * (fAmplitudes[i] - fAmplitudes[i - 1]);
+    }
+
+private:
+    static uint64_t NextID() {
+        static std::atomic<uint64_t> lastID(0);
+        return ++lastID;
+    }
+
+    std::vector<double> fTimes;
+    std::vector<double> fAmplitudes;
+    uint64_t fID;
+};
+
+// A pulse table resampled at one time step for gWaveformKernelPhases + 1 sub-sample
+// phases. Row p: the pulse at p / gWaveformKernelPhases + j time steps after its start.
+struct sbPulseKernel {
+    double timeStep;
+    uint64_t pulseID;
+    size_t length;
+    std::vector<float> table;
+};
+
+// Kernels of the recently used pulse tables and time steps, one cache per thread.
+class sbPulseKernelCache {
+public:
+    // A few steps, the fine and coarse ones of the sparse grid and the dense one.
+    explicit sbPulseKernelCache(size_t maxNumOfKernels = 4) : fMaxNumOfKernels(maxNumOfKernels), fKernels() {}
+
+    const sbPulseKernel& Get(const sbPulseTable& pulse, double timeStep) {
+        for (const auto& kernel : fKernels) {
+            if (kernel.timeStep == timeStep && kernel.pulseID == pulse.GetID()) { return kernel; }
+        }
+        if (fKernels.size() == fMaxNumOfKernels) { fKernels.erase(fKernels.begin()); }
+        const size_t length = std::ceil(pulse.GetLength() / timeStep) + 1;
+        fKernels.push_back(sbPulseKernel{ timeStep, pulse.GetID(), length,
+            std::vector<float>((gWaveformKernelPhases + 1) * length) });
+        auto& kernel = fKernels.back();
+        for (int phase = 0; phase <= gWaveformKernelPhases; ++phase) {
+            for (size_t j = 0; j < length; ++j) {
+                kernel.table[phase * length + j] = pulse.Amplitude((j + double(phase) / gWaveformKernelPhases) * timeStep);
+            }
+        }
+        return kernel;
+    }
+
+private:
+    size_t fMaxNumOfKernels;
+    std::vector<sbPulseKernel> fKernels;
+};
+
+// Contiguous multiply-add without aliasing, vectorized by the compiler at -O3.
+inline void sbMultiplyAdd(float* __restrict waveform, const float* __restrict kernel, float weight, size_t n) {
+    for (size_t i = 0; i < n; ++i) { waveform[i] += weight * kernel[i]; }
+}
+
+// Adds the kernel of every pulse (sorted by time) to the uniform samples at the phase of
+// its delay to the first sample at or after it, rounded.
+inline void sbAddTabulatedPulses(const std::vector<sbPulse>& pulses, double startTime, double timeStep,
+    const sbPulseKernel& kernel, float* waveform, size_t numOfSamples) {
+    const size_t length = kernel.length;
+    const float* kernels = kernel.table.data();
+    const long lastSample = numOfSamples;
+    for (const auto& pulse : pulses) {
+        const double offset = (pulse.time - startTime) / timeStep;
+        long first = std::ceil(offset);
+        if (first >= lastSample) { break; }
+        const int phase = int((first - offset) * gWaveformKernelPhases + 0.5);
+        size_t kernelBegin = 0;
+        if (first < 0) {
+            kernelBegin = -first;
+            first = 0;
+        }
+        if (kernelBegin >= length) { continue; }
+        const size_t n = std::min<size_t>(length - kernelBegin, lastSample - first);
+        sbMultiplyAdd(waveform + first, kernels + phase * length + kernelBegin, pulse.amplitude, n);
+    }
+}
+
+// Peak, integral and constant fraction time of a waveform on consecutive regions, times
+// in the unit of the regions (ns). CFD time is the first crossing of fraction * amplitude
+// before the peak, linear between the samples, NaN for a waveform without a positive peak.
+struct sbWaveformMeasures {
+    double amplitude;
+    double charge;
+    double CFDTime;
+};
+
+inline sbWaveformMeasures sbMeasureWaveform(const float* waveform, const std::vector<sbWaveformRegion>& regions,
+    double CFDFraction) {
+    sbWaveformMeasures measures{ 0.0, 0.0, std::nan("") };
+    // Peak and integral in one pass over the regions.
+    size_t peak = 0;
+    for (const auto& region : regions) {
+        for (size_t i = region.firstSample; i < region.firstSample + region.numOfSamples; ++i) {
+            measures.charge += waveform[i] * region.timeStep_ns;
+            if (waveform[i] > measures.amplitude) {
+                measures.amplitude = waveform[i];
+                peak = i;
+            }
+        }
+    }
+    if (measures.amplitude <= 0.0) { return measures; }
+    const double level = CFDFraction * measures.amplitude;
+    double previousTime = 0.0;
+    double previousSample = 0.0;
+    for (const auto& region : regions) {
+        const size_t end = std::min<size_t>(region.firstSample + region.numOfSamples, peak + 1);
+        for (size_t i = region.firstSample; i < end; ++i) {
+            const double time = region.startTime_ns + (i - region.firstSample) * region.timeStep_ns;
+            if (waveform[i] >= level) {
+                measures.CFDTime = i == 0 ? time :
+                    previousTime + (level - previousSample) / (waveform[i] - previousSample) * (time - previousTime);
+                return measures;
+            }
+            previousTime = time;
+            previousSample = waveform[i];
+        }
+    }
+    return measures;
+}
+
+// Avalanche model of sbSiPMDigitizer, u are uniform random numbers in (0, 1].
+//
+// Photons a hit of weight w stands for: floor(w) plus one with the probability of the fraction.
+inline int sbNumOfPhotons(double weight, double u) {
+    int numOfPhotons = int(weight);
+    if (u < weight - numOfPhotons) { ++numOfPhotons; }
+    return numOfPhotons;
+}
+
+// Mean number of prompt crosstalk avalanches of an avalanche, Poisson so that
+// P(at least one) = probability for a full avalanche.
+inline double sbCrosstalkMean(double probability, double charge) {
+    return -std::log(1.0 - probability) * charge;
+}
+
+// Afterpulse of an avalanche with the probability scaled by its charge, exponential delay.
+inline bool sbAfterpulses(double probability, double charge, double u) { return u < probability * charge; }
+inline double sbAfterpulseDelay(double timeConstant, double u) { return -timeConstant * std::log(u); }
+
+// Dark counts: Poisson number with this mean over the readout window, uniform in time.
+inline double sbDarkCountMean(double rate, double readoutWindow) { return rate * readoutWindow; }
+inline double sbDarkCountTime(double T0, double readoutWindow, double u) { return T0 + u * readoutWindow; }
+
+// Charge of a microcell firing dt after its last avalanche.
+inline double sbRecoveredCharge(double dt, double recoveryTime) {
+    return recoveryTime > 0.0 ? 1.0 - std::exp(-dt / recoveryTime) : 1.0;
+}
+
+#endif
@@ -4,16 +4,22 @@
 #include "G4VSensitiveDetector.hh"
 #include "G4SDManager.hh"
 #include "G4OpticalPhoton.hh"
+#include "G4Track.hh"
 #include "g4analysis.hh"
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 
 #include "sbGlobal.hh"
 #include "sbSiPMHit.hh"
+#include "sbSiPMPhotonBuffer.hh"
+#include "sbConfigs.hh"
+#include "sbWaveformSynthesizer.hh"
 
 class sbSiPMSD : public G4VSensitiveDetector {
 private:
     std::pair<sbSiPMHitsCollection*, sbSiPMHitsCollection*> fSiPMPhotonHC;
+    // Photons of the event, upper and lower, sorted by time at the end of the event.
+    std::pair<sbSiPMPhotonBuffer, sbSiPMPhotonBuffer> fPhotonBuffers;
 
     G4ToolsAnalysisManager* fAnalysisManager;
 
@@ -24,20 +30,66 @@ public:
     virtual void Initialize(G4HCofThisEvent* eventHitCollection);
     virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory*);
     virtual void EndOfEvent(G4HCofThisEvent*);
+    //
+    // Photon detected without tracking it into the SiPM, e.g. by sbOpticalPhotonFastModel.
+    // The position in the SiPM frame is optional, the digitizer picks a random microcell without.
+    void AddHit(G4int SiPMID, G4double time, G4double energy, G4double weight = 1.0,
+        const G4ThreeVector* localPosition = nullptr);
+    //
+    // Position of a step point on the SiPM in the SiPM frame.
+    static G4ThreeVector LocalPosition(const G4StepPoint* point);
+    //
+    // Number of photons an optical photon stands for, its track weight: set at creation by
+    // sbSteppingAction (gScintillationYieldReduction for scintillation photons with
+    // SB_REDUCE_SCINTILLATION_YIELD, otherwise 1), inherited by re-emitted (WLS) photons,
+    // the primary weight for primary photons (replay).
+    static G4double PhotonWeight(const G4Track* photon) { return photon->GetWeight(); }
+    //
+    // Importance weight of the current event, product of the weights of all primary vertices
+    // and non-photon primaries. Replayed events (sbDepositReplaySource) carry it on a leading
+    // vertex without particles.
+    static G4double GetEventWeight();
+    //
+    // Photons of the current event, upper and lower SiPM, valid from EndOfEvent to the next event.
+    const std::pair<sbSiPMPhotonBuffer, sbSiPMPhotonBuffer>& GetPhotonBuffers() const { return fPhotonBuffers; }
 
-    static std::mutex fMutex;
-    static G4int fHitEventCount;
+    // Event-keyed ntuples created by sbRunAction in this order, rows are streamed as
+    // events end. Hits and response samples of one event are found by their EventID,
+    // e.g. TTree::BuildIndex("EventID", "HitIndex"), the index ntuple has one row per
+    // event with the numbers of its rows. Only events with a full record (see
+    // sbFeatureExtractor) have hits, samples and an index row, all have features.
+    enum sbNtupleID {
+        fHitNtupleID,           // EventID, HitIndex, SiPMID, HitTime[ns], PhotonEnergy[eV], Weight
+        fResponseNtupleID,      // EventID, Sample, Time[ns], Upper/LowerPhotoelectricResponse[a.u.], Weight
+        fEventIndexNtupleID,    // EventID, NumOfUpperHits, NumOfLowerHits, NumOfSamples, Weight
+        fFeatureNtupleID        // EventID, Upper/Lower FirstPhotonTime[ns], CFDTime[ns], Amplitude[a.u.],
+                                // Charge[a.u.*ns], NumOfPhotoelectrons, TimeDifference[ns] (upper - lower CFD),
+                                // TriggerTime[ns] (first trigger of sbTriggerEmulator), FullRecord, Weight
+    };
 
 private:
-    inline G4double SiPMSinglePhotoelectricResponse(const G4double& elapsedTimeAfterHit) const;
     void FillNtuple() const;
-
-    inline static bool compareHit(sbSiPMHit* lhs, sbSiPMHit* rhs) { return lhs->GetTime() < rhs->GetTime(); }
+    //
+    // Pulses of the waveforms in time order, the digitized avalanches with
+    // SB_DIGITIZE_SIPM_HITS, otherwise the hits.
+    static void CollectPulses(const sbSiPMPhotonBuffer& upperPhotons, const sbSiPMPhotonBuffer& lowerPhotons,
+        std::vector<sbPulse>& upperPulses, std::vector<sbPulse>& lowerPulses);
+    //
+    // Event record of the waveform container of the hits and waveforms, see
+    // sbEncodeEventRecord in sbWaveformFormat.hh.
+    static std::string WaveformRecord(G4int eventID,
+        const sbSiPMPhotonBuffer& upperPhotons, const sbSiPMPhotonBuffer& lowerPhotons,
+        const std::vector<sbWaveformRegion>& regions,
+        const std::vector<float>& upperWaveform, const std::vector<float>& lowerWaveform,
+        G4double threshold, G4double eventWeight);
+#if !SB_BUFFER_SIPM_PHOTONS
+    void CopyHitsToPhotonBuffers();
+#endif
+#if SB_ROUND_PHOTON_HIT_WEIGHTS
+    // Replace the hit weights by unbiased integer numbers of photoelectrons.
+    void RoundHitWeights();
+#endif
 };
 
-inline G4double sbSiPMSD::SiPMSinglePhotoelectricResponse(const G4double& elapsedTimeAfterHit) const {
-    return exp(-elapsedTimeAfterHit);
-}
-
 #endif
 
@@ -0,0 +1,47 @@
+#ifndef SB_STACKING_ACTION_H
+#define SB_STACKING_ACTION_H 1
+
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+
+class sbStackingMessenger;
+class sbSteppingAction;
+
+// With SB_DEFER_OPTICAL_PHOTONS, two-stage stacking: optical photons wait until the muon
+// and all charged particles of the event are tracked. Then the scintillator muon hits
+// decide whether the photons are released (trigger condition holds) or killed. When
+// recording deposits (sbDepositRecorder), events failing the trigger are discarded and
+// the photons of the others are killed too, their optical stage is replayed later.
+// Without it, photons are only killed when recording deposits.
+// The PDE pre-filter of sbSteppingAction is rolled here once per new photon, rejected
+// photons are killed before tracking (and before waiting).
+class sbStackingAction : public G4UserStackingAction {
+public:
+    enum sbTriggerCondition {
+        fUpperAndLower,
+        fUpperOrLower
+    };
+
+public:
+    sbStackingAction(sbSteppingAction* steppingAction);
+    virtual ~sbStackingAction();
+
+    virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track);
+    virtual void NewStage();
+    virtual void PrepareNewEvent();
+
+    void SetTriggerCondition(sbTriggerCondition condition) { fTriggerCondition = condition; }
+
+private:
+    G4bool TriggerConditionHolds();
+
+    sbStackingMessenger* fMessenger;
+    sbSteppingAction* fSteppingAction;
+    sbTriggerCondition fTriggerCondition;
+    G4int fStage;
+    // Waiting photons are classified again when released, their PDE roll is done.
+    G4bool fReClassifying;
+    G4int fMuonHitsCollectionID;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SB_STACKING_MESSENGER_H
+#define SB_STACKING_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "globals.hh"
+
+class sbStackingAction;
+
+// Commands under /smallbox/stacking/.
+class sbStackingMessenger : public G4UImessenger {
+public:
+    sbStackingMessenger(sbStackingAction* stackingAction);
+    virtual ~sbStackingMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    sbStackingAction* fStackingAction;
+
+    G4UIdirectory* fStackingDirectory;
+    G4UIcmdWithAString* fTriggerCmd;
+};
+
+#endif
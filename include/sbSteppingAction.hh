@@ -1,25 +1,93 @@
 #ifndef SB_STEPPING_ACTION_H
 #define SB_STEPPING_ACTION_H 1
 
+#include <vector>
+
 #include "G4UserSteppingAction.hh"
 #include "globals.hh"
 
+#include "sbConfigs.hh"
+
 class sbEventAction;
+class sbSteppingMessenger;
 
 class G4LogicalVolume;
+class G4Track;
 
 /// Stepping action class
+///
+/// Optical photons made by other particles get their weight at creation, the number of
+/// photons they stand for (see sbSiPMSD::PhotonWeight), instead of the parent weight.
 /// 
+/// Optical photon kill policies, all disabled by default (see sbSteppingMessenger):
+/// -> Leaving the scintillator/light guide system into the world.
+/// -> Global time beyond a cut, e.g. the SiPM readout window. A cut shorter than the
+///    readout window (/smallbox/digitizer/readoutWindow) kills photons that would be
+///    recorded, so it is reported at the start of the run.
+/// -> More boundary interactions than a maximum.
+/// -> PDE pre-filter: a new photon is kept with the SiPM PDE at its energy when it is
+///    stacked (sbStackingAction), so photons that would not be detected are never tracked. Since the photon energy does
+///    not change on the way, this is the same as applying the PDE at detection.
+///    With SB_SIPM_SURFACE_DETECTION, the SiPM surface EFFICIENCY is set to 1 while the
+///    filter is on, so the PDE is applied once.
 
 class sbSteppingAction : public G4UserSteppingAction {
+public:
+    enum sbPhotonKillPolicy {
+        fLeaveSystemPolicy,
+        fTimeCutPolicy,
+        fBoundaryInteractionPolicy,
+        fPDEFilterPolicy,
+        fNumOfPhotonKillPolicies
+    };
+
 public:
     sbSteppingAction(sbEventAction* eventAction);
     virtual ~sbSteppingAction();
 
     virtual void UserSteppingAction(const G4Step*);
 
+    void SetKillOnLeavingSystem(G4bool kill) { fKillOnLeavingSystem = kill; }
+    void SetPhotonTimeCut(G4double timeCut) { fPhotonTimeCut = timeCut; }
+    void SetMaxBoundaryInteractions(G4int maxBoundaryInteractions) { fMaxBoundaryInteractions = maxBoundaryInteractions; }
+    void SetPDEFilter(G4bool filter);
+    G4bool GetPDEFilter() const { return fPDEFilter; }
+    // PDE pre-filter roll of a new photon, counted as killed if rejected.
+    G4bool RejectedByPDEFilter(const G4Track* track);
+
+    // Per thread, called by sbRunAction.
+    void BeginOfRun();
+    void PrintPhotonKillCounters() const;
+
 private:
+#if SB_ENABLE_OPTICAL_PHYSICS
+    void WeighNewPhotons(const G4Step* step);
+#endif
+    void ResetPhotonKillCounters();
+    void CheckPhotonTimeCut() const;
+    void KillPhoton(G4Track* track, sbPhotonKillPolicy policy);
+    G4double PDE(G4double photonEnergy) const;
+    static G4bool OutsideSystem(const G4ThreeVector& position);
+
     sbEventAction* fEventAction;
+    sbSteppingMessenger* fMessenger;
+
+    G4bool fKillOnLeavingSystem;
+    G4double fPhotonTimeCut;    // Disabled if <= 0.
+    G4int fMaxBoundaryInteractions;    // Disabled if <= 0.
+    G4bool fPDEFilter;
+    std::vector<G4double> fPDEEnergies;
+    std::vector<G4double> fPDEValues;
+
+    // Boundary interactions of the photon being tracked, photons are tracked one by one.
+    G4int fNumOfBoundaryInteractions;
+
+    // Killed photons and the sum of their step numbers at the kill, per policy.
+    G4double fNumOfKilledPhotons[fNumOfPhotonKillPolicies];
+    G4double fNumOfKilledPhotonSteps[fNumOfPhotonKillPolicies];
+    // Photons that ended by themselves (absorbed, detected, left the world) and their steps.
+    G4double fNumOfEndedPhotons;
+    G4double fNumOfEndedPhotonSteps;
 };
 
 #endif
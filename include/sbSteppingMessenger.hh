@@ -0,0 +1,31 @@
+#ifndef SB_STEPPING_MESSENGER_H
+#define SB_STEPPING_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "globals.hh"
+
+class sbSteppingAction;
+
+// Commands under /smallbox/photonKill/.
+class sbSteppingMessenger : public G4UImessenger {
+public:
+    sbSteppingMessenger(sbSteppingAction* steppingAction);
+    virtual ~sbSteppingMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    sbSteppingAction* fSteppingAction;
+
+    G4UIdirectory* fPhotonKillDirectory;
+    G4UIcmdWithABool* fLeaveSystemCmd;
+    G4UIcmdWithADoubleAndUnit* fTimeCutCmd;
+    G4UIcmdWithAnInteger* fMaxBoundaryInteractionsCmd;
+    G4UIcmdWithABool* fPDEFilterCmd;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SB_TRIGGER_EMULATOR_H
+#define SB_TRIGGER_EMULATOR_H 1
+
+#include <vector>
+
+#include "globals.hh"
+
+#include "sbWaveformFormat.hh"
+#include "sbWaveformSynthesizer.hh"
+#include "sbElectronicNoise.hh"
+
+// Trigger and DAQ of the real readout, between the SiPM pulses and the waveforms:
+//
+// -> Discriminator per SiPM on the waveform sampled at the discriminator step in windows
+//    from every pulse to the tail after it, overlapping windows merged, with the electronic
+//    noise if enabled (the realization the readout gates of the SiPM get). Late pulses
+//    (afterpulses, dark counts) add their own short windows instead of stretching one
+//    window over the whole readout. Noise alone far from any pulse does not fire it.
+//    Leading edge: fires at the threshold crossing. CFD: armed by the threshold, fires
+//    at the fraction of the following peak on the rising edge. Re-armed below the threshold.
+// -> Coincidence: an upper and a lower firing within the window trigger at the later one,
+//    triggers within the dead time after an accepted one are lost. Events are independent,
+//    so the dead time does not reach into the next event.
+// -> Readout gates from the pre-trigger before every trigger for the gate length, sampled
+//    at the gate step, overlapping gates merged. They replace the sample grid of the
+//    waveforms, /smallbox/waveform/sparse still zero-suppresses inside them.
+//
+// Events without a trigger have no output at all. Off by default, configured by
+// /smallbox/trigger/ (master), shared by all threads.
+class sbTriggerEmulator {
+public:
+    enum sbDiscriminator {
+        fLeadingEdge,
+        fConstantFraction
+    };
+
+public:
+    static sbTriggerEmulator& GetInstance();
+    sbTriggerEmulator(const sbTriggerEmulator&) = delete;
+    sbTriggerEmulator& operator=(const sbTriggerEmulator&) = delete;
+
+private:
+    sbTriggerEmulator();
+    ~sbTriggerEmulator() {}
+
+    G4bool fEnabled;
+    sbDiscriminator fDiscriminator;
+    G4double fThreshold;
+    G4double fCFDFraction;
+    G4double fDiscriminatorStep;
+    G4double fCoincidenceWindow;
+    G4double fDeadTime;
+    G4double fPreTrigger;
+    G4double fGateLength;
+    G4double fGateStep;
+
+public:
+    void SetEnabled(G4bool enabled) { fEnabled = enabled; }
+    void SetDiscriminator(sbDiscriminator discriminator) { fDiscriminator = discriminator; }
+    void SetThreshold(G4double threshold) { fThreshold = threshold; }
+    void SetCFDFraction(G4double fraction) { fCFDFraction = fraction; }
+    void SetDiscriminatorStep(G4double step) { fDiscriminatorStep = step; }
+    void SetCoincidenceWindow(G4double window) { fCoincidenceWindow = window; }
+    void SetDeadTime(G4double deadTime) { fDeadTime = deadTime; }
+    void SetPreTrigger(G4double preTrigger) { fPreTrigger = preTrigger; }
+    void SetGateLength(G4double gateLength) { fGateLength = gateLength; }
+    void SetGateStep(G4double gateStep) { fGateStep = gateStep; }
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    // Accepted trigger times and the readout gates of the pulses (sorted by time), false
+    // without a trigger. The noise realizations are used if the electronic noise is enabled.
+    G4bool Trigger(const std::vector<sbPulse>& upperPulses, const std::vector<sbPulse>& lowerPulses,
+        const sbElectronicNoise::sbNoiseRealization& upperNoise, const sbElectronicNoise::sbNoiseRealization& lowerNoise,
+        std::vector<G4double>& triggerTimes, std::vector<sbWaveformRegion>& gates) const;
+
+private:
+    // Times the discriminator of one SiPM fires, ascending.
+    void Discriminate(const std::vector<sbPulse>& pulses, const sbElectronicNoise::sbNoiseRealization& noise,
+        std::vector<G4double>& fireTimes) const;
+    // Sampling windows of the discriminator over the pulses (sorted by time).
+    void BuildWindows(const std::vector<sbPulse>& pulses, std::vector<sbWaveformRegion>& regions) const;
+};
+
+#endif
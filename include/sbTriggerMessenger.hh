@@ -0,0 +1,34 @@
+#ifndef SB_TRIGGER_MESSENGER_H
+#define SB_TRIGGER_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithABool.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/trigger/, master only.
+class sbTriggerMessenger : public G4UImessenger {
+public:
+    sbTriggerMessenger();
+    virtual ~sbTriggerMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fTriggerDirectory;
+    G4UIcmdWithABool* fEnableCmd;
+    G4UIcmdWithAString* fDiscriminatorCmd;
+    G4UIcmdWithADouble* fThresholdCmd;
+    G4UIcmdWithADouble* fCFDFractionCmd;
+    G4UIcmdWithADoubleAndUnit* fDiscriminatorStepCmd;
+    G4UIcmdWithADoubleAndUnit* fCoincidenceWindowCmd;
+    G4UIcmdWithADoubleAndUnit* fDeadTimeCmd;
+    G4UIcmdWithADoubleAndUnit* fPreTriggerCmd;
+    G4UIcmdWithADoubleAndUnit* fGateLengthCmd;
+    G4UIcmdWithADoubleAndUnit* fGateStepCmd;
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef SB_WAVEFORM_FORMAT_H
+#define SB_WAVEFORM_FORMAT_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Waveform container, the SiPM waveforms and photon hits of a run in one append-only file.
+// Written by sbAsyncFileWriter, read by tools/waveformReader without Geant4, so this
+// header depends on the standard library only. All numbers are little-endian, the file
+// is read in place (memory-mapped), the layout must not change without the version.
+//
+// [sbWaveformFileHeader]
+// [event record]...                    : In the order the events end, any thread.
+// [sbWaveformIndexEntry index[numOfEvents]]
+// [sbWaveformFileTrailer]              : Last 24 bytes, locates the index.
+//
+// Event record:
+// [sbWaveformEventHeader]
+// [float upper[numOfSamples]] [float lower[numOfSamples]]
+//   or with fSparseWaveforms (version 2), zero-suppressed on a piecewise uniform grid:
+//   [sbSparseWaveformHeader]
+//   [sbWaveformRegion region[numOfRegions]]    : Consecutive, numOfSamples in total, fine
+//                                                steps at leading edges, coarse in tails.
+//   [sbWaveformRun upperRun[numOfUpperRuns]] [sbWaveformRun lowerRun[numOfLowerRuns]]
+//   [float upper[upper run samples]] [float lower[lower run samples]]
+//                                              : The samples whose magnitude is above
+//                                                the threshold (undershoot and noise
+//                                                included), the others are 0 in the
+//                                                dense form.
+// [hit times, hitBytes bytes]          : Per SiPM (upper hits, then lower), ascending.
+//                                        Times quantized to gWaveformHitTimeQuantum_ns,
+//                                        the first relative to firstHitTime_ns, the
+//                                        others to the previous hit, as LEB128 varints.
+// [float hitWeight[numOfUpperHits + numOfLowerHits]]   : Only with fHitWeights.
+// [zero padding]                       : Records are multiples of 8 bytes, so all
+//                                        waveforms are aligned in the mapped file.
+struct sbWaveformFileHeader {
+    char     magic[8];            // "SBWAVEFM"
+    uint32_t version;             // 2, version 1 files have no fSparseWaveforms
+    uint32_t reserved;
+};
+
+struct sbWaveformEventHeader {
+    int32_t  eventID;
+    uint32_t flags;               // sbWaveformEventFlag
+    uint32_t numOfSamples;        // Per SiPM, of the dense form.
+    uint32_t numOfUpperHits;
+    uint32_t numOfLowerHits;
+    uint32_t hitBytes;
+    double   firstHitTime_ns;
+    double   startTime_ns;        // Time of sample 0.
+    double   timeStep_ns;         // The finest step with fSparseWaveforms.
+    double   weight;              // Importance weight of the event.
+};
+
+enum sbWaveformEventFlag : uint32_t {
+    fHitWeights = 1u << 0,        // Hit weights stored, otherwise all 1.
+    fSparseWaveforms = 1u << 1    // Zero-suppressed waveforms on regions.
+};
+
+struct sbSparseWaveformHeader {
+    uint32_t numOfRegions;
+    uint32_t numOfUpperRuns;
+    uint32_t numOfLowerRuns;
+    uint32_t reserved;
+};
+
+// Samples startTime_ns + k * timeStep_ns, k < numOfSamples, are the dense samples
+// firstSample + k.
+struct sbWaveformRegion {
+    double   startTime_ns;
+    double   timeStep_ns;
+    uint32_t firstSample;
+    uint32_t numOfSamples;
+};
+
+// Dense samples firstSample to firstSample + numOfSamples - 1 are stored.
+struct sbWaveformRun {
+    uint32_t firstSample;
+    uint32_t numOfSamples;
+};
+
+struct sbWaveformIndexEntry {
+    int32_t  eventID;
+    uint32_t reserved;
+    uint64_t offset;              // Of the event record from the file start.
+    uint64_t size;                // Of the event record.
+};
+
+struct sbWaveformFileTrailer {
+    uint64_t indexOffset;
+    uint64_t numOfEvents;
+    char     magic[8];            // "SBWFINDX"
+};
+
+static_assert(sizeof(sbWaveformFileHeader) == 16, "sbWaveformFileHeader must be packed.");
+static_assert(sizeof(sbWaveformEventHeader) == 56, "sbWaveformEventHeader must be packed.");
+static_assert(sizeof(sbSparseWaveformHeader) == 16, "sbSparseWaveformHeader must be packed.");
+static_assert(sizeof(sbWaveformRegion) == 24, "sbWaveformRegion must be packed.");
+static_assert(sizeof(sbWaveformRun) == 8, "sbWaveformRun must be packed.");
+static_assert(sizeof(sbWaveformIndexEntry) == 24, "sbWaveformIndexEntry must be packed.");
+static_assert(sizeof(sbWaveformFileTrailer) == 24, "sbWaveformFileTrailer must be packed.");
+
+constexpr uint32_t gWaveformFileVersion = 2;
+constexpr size_t gWaveformRecordAlignment = 8;
+
+// 1 ps, below any SiPM timing resolution.
+constexpr double gWaveformHitTimeQuantum_ns = 0.001;
+
+inline void sbAppendVarint(std::string& buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer += static_cast<char>(value);
+}
+
+// Advances data, returns false past end.
+inline bool sbReadVarint(const unsigned char*& data, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; data != end && shift < 64; shift += 7) {
+        const unsigned char byte = *data++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+    return false;
+}
+
+// Ascending hit times (ns), quantized and delta-encoded relative to firstHitTime_ns.
+inline void sbAppendHitTimes(std::string& buffer, const std::vector<double>& times, double firstHitTime_ns) {
+    const int64_t firstTick = std::llround(firstHitTime_ns / gWaveformHitTimeQuantum_ns);
+    int64_t previousTick = firstTick;
+    for (double time : times) {
+        const int64_t tick = std::llround(time / gWaveformHitTimeQuantum_ns);
+        sbAppendVarint(buffer, static_cast<uint64_t>(tick - previousTick));
+        previousTick = tick;
+    }
+}
+
+inline bool sbReadHitTimes(const unsigned char*& data, const unsigned char* end, size_t numOfHits,
+    double firstHitTime_ns, std::vector<double>& times) {
+    int64_t tick = std::llround(firstHitTime_ns / gWaveformHitTimeQuantum_ns);
+    times.resize(numOfHits);
+    for (size_t i = 0; i < numOfHits; ++i) {
+        uint64_t delta;
+        if (!sbReadVarint(data, end, delta)) { return false; }
+        tick += static_cast<int64_t>(delta);
+        times[i] = tick * gWaveformHitTimeQuantum_ns;
+    }
+    return true;
+}
+
+// Sample kept by zero suppression, negative ones (undershoot, noise) by their magnitude,
+// so a threshold of 0 drops exact zeros only.
+inline bool sbAboveThreshold(float sample, float threshold) {
+    return std::fabs(sample) > threshold;
+}
+
+// Runs of the samples above threshold, appended to runs (dense sample numbers) and stored.
+inline void sbSuppressZeros(const float* samples, size_t numOfSamples, float threshold,
+    std::vector<sbWaveformRun>& runs, std::vector<float>& stored) {
+    for (size_t i = 0; i < numOfSamples;) {
+        if (!sbAboveThreshold(samples[i], threshold)) {
+            ++i;
+            continue;
+        }
+        const size_t first = i;
+        while (i < numOfSamples && sbAboveThreshold(samples[i], threshold)) { ++i; }
+        runs.push_back(sbWaveformRun{ static_cast<uint32_t>(first), static_cast<uint32_t>(i - first) });
+        stored.insert(stored.end(), samples + first, samples + i);
+    }
+}
+
+// Dense form of zero-suppressed samples, false if a run is out of range.
+inline bool sbExpandRuns(const sbWaveformRun* runs, size_t numOfRuns, const float* stored,
+    size_t numOfSamples, std::vector<float>& samples) {
+    samples.assign(numOfSamples, 0.0f);
+    for (size_t r = 0; r < numOfRuns; ++r) {
+        if (size_t(runs[r].firstSample) + runs[r].numOfSamples > numOfSamples) { return false; }
+        std::copy(stored, stored + runs[r].numOfSamples, samples.begin() + runs[r].firstSample);
+        stored += runs[r].numOfSamples;
+    }
+    return true;
+}
+
+// Event record of the layout above. Hit times (ns) ascending per SiPM, hitWeights of the
+// upper hits then the lower ones, stored if any is not 1. The waveforms on the regions are
+// zero-suppressed above the threshold, dense if it is negative. Several regions (readout
+// gates) take the sparse layout, all samples kept if the threshold is negative.
+inline std::string sbEncodeEventRecord(int32_t eventID, double weight,
+    const std::vector<double>& upperHitTimes_ns, const std::vector<double>& lowerHitTimes_ns,
+    const std::vector<float>& hitWeights, const std::vector<sbWaveformRegion>& regions,
+    const std::vector<float>& upperWaveform, const std::vector<float>& lowerWaveform, double threshold) {
+    sbWaveformEventHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.eventID = eventID;
+    header.numOfSamples = upperWaveform.size();
+    header.numOfUpperHits = upperHitTimes_ns.size();
+    header.numOfLowerHits = lowerHitTimes_ns.size();
+    header.startTime_ns = regions.front().startTime_ns;
+    header.timeStep_ns = regions.front().timeStep_ns;
+    for (const auto& region : regions) { header.timeStep_ns = std::min(header.timeStep_ns, region.timeStep_ns); }
+    header.weight = weight;
+    if (threshold >= 0.0 || regions.size() > 1) { header.flags |= fSparseWaveforms; }
+    for (float hitWeight : hitWeights) {
+        if (hitWeight != 1.0f) { header.flags |= fHitWeights; }
+    }
+    const double noHit = std::numeric_limits<double>::max();
+    header.firstHitTime_ns = std::min(upperHitTimes_ns.empty() ? noHit : upperHitTimes_ns.front(),
+        lowerHitTimes_ns.empty() ? noHit : lowerHitTimes_ns.front());
+
+    std::string hitTimes;
+    sbAppendHitTimes(hitTimes, upperHitTimes_ns, header.firstHitTime_ns);
+    sbAppendHitTimes(hitTimes, lowerHitTimes_ns, header.firstHitTime_ns);
+    header.hitBytes = hitTimes.size();
+
+    std::string record;
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (header.flags & fSparseWaveforms) {
+        std::vector<sbWaveformRun> runs;
+        std::vector<float> stored;
+        const float runThreshold = threshold >= 0.0 ? threshold : -std::numeric_limits<float>::max();
+        sbSuppressZeros(upperWaveform.data(), upperWaveform.size(), runThreshold, runs, stored);
+        const size_t numOfUpperRuns = runs.size();
+        sbSuppressZeros(lowerWaveform.data(), lowerWaveform.size(), runThreshold, runs, stored);
+        const sbSparseWaveformHeader sparseHeader{ static_cast<uint32_t>(regions.size()),
+            static_cast<uint32_t>(numOfUpperRuns), static_cast<uint32_t>(runs.size() - numOfUpperRuns), 0 };
+        record.append(reinterpret_cast<const char*>(&sparseHeader), sizeof(sparseHeader));
+        record.append(reinterpret_cast<const char*>(regions.data()), regions.size() * sizeof(sbWaveformRegion));
+        record.append(reinterpret_cast<const char*>(runs.data()), runs.size() * sizeof(sbWaveformRun));
+        record.append(reinterpret_cast<const char*>(stored.data()), stored.size() * sizeof(float));
+    } else {
+        const size_t waveformBytes = header.numOfSamples * sizeof(float);
+        record.append(reinterpret_cast<const char*>(upperWaveform.data()), waveformBytes);
+        record.append(reinterpret_cast<const char*>(lowerWaveform.data()), waveformBytes);
+    }
+    record += hitTimes;
+    if (header.flags & fHitWeights) {
+        record.append(reinterpret_cast<const char*>(hitWeights.data()), hitWeights.size() * sizeof(float));
+    }
+    record.resize((record.size() + gWaveformRecordAlignment - 1) / gWaveformRecordAlignment * gWaveformRecordAlignment, '\0');
+    return record;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef SB_WAVEFORM_MESSENGER_H
+#define SB_WAVEFORM_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithABool.hh"
+#include "globals.hh"
+
+// Commands under /smallbox/waveform/, master only.
+class sbWaveformMessenger : public G4UImessenger {
+public:
+    sbWaveformMessenger();
+    virtual ~sbWaveformMessenger();
+
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+
+private:
+    G4UIdirectory* fWaveformDirectory;
+    G4UIcmdWithAString* fShapeCmd;
+    G4UIcmdWithADoubleAndUnit* fRiseTimeCmd;
+    G4UIcmdWithADoubleAndUnit* fFallTimeCmd;
+    G4UIcmdWithAString* fPulseFileCmd;
+    G4UIcmdWithABool* fSparseCmd;
+    G4UIcmdWithADouble* fThresholdCmd;
+    G4UIcmdWithADoubleAndUnit* fFineStepCmd;
+    G4UIcmdWithADoubleAndUnit* fFineWindowCmd;
+    G4UIcmdWithADoubleAndUnit* fCoarseStepCmd;
+};
+
+#endif
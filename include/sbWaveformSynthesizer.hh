@@ -0,0 +1,85 @@
+#ifndef SB_WAVEFORM_SYNTHESIZER_H
+#define SB_WAVEFORM_SYNTHESIZER_H 1
+
+#include <vector>
+
+#include "globals.hh"
+
+#include "sbWaveformFormat.hh"
+#include "sbSiPMResponseCore.hh"
+
+// SiPM waveform, the sum of scaled single photoelectron pulses, sampled on consecutive
+// uniform regions into a float buffer with the kernels of sbSiPMResponseCore.hh. The cost
+// is O(samples + pulses) per region:
+//
+//   exponential : (exp(-t/fall) - exp(-t/rise)) normalized to a peak of 1, exp(-t/fall)
+//                 without rise time. Every exponential is a first order recursion over
+//                 the samples, the pulses are added as the sample time passes them.
+//   tabulated   : measured pulse (SPE_time, SPE_amplitude in the pulse file), resampled
+//                 at the time step for gWaveformKernelPhases sub-sample phases, the
+//                 tables of the last few time steps are kept.
+//                 Every pulse adds the kernel of its phase to the buffer, a contiguous
+//                 multiply-add the compiler vectorizes.
+//
+// The sparse grid samples every leading edge (a pulse after a gap of the fine window in
+// its SiPM) at the fine step for the fine window and the rest at the coarse step, the
+// output keeps the samples above the threshold only (see sbWaveformFormat.hh).
+//
+// Configured by /smallbox/waveform/ (master), shared by all threads.
+class sbWaveformSynthesizer {
+public:
+    enum sbPulseShape {
+        fExponentialPulse,
+        fTabulatedPulse
+    };
+
+public:
+    static sbWaveformSynthesizer& GetInstance();
+    sbWaveformSynthesizer(const sbWaveformSynthesizer&) = delete;
+    sbWaveformSynthesizer& operator=(const sbWaveformSynthesizer&) = delete;
+
+private:
+    sbWaveformSynthesizer();
+    ~sbWaveformSynthesizer() {}
+
+    sbPulseShape fPulseShape;
+    G4double fRiseTime;
+    G4double fFallTime;
+    G4String fPulseFileName;
+    sbPulseTable fPulseTable;
+    G4bool fSparse;
+    G4double fThreshold;
+    G4double fFineStep;
+    G4double fFineWindow;
+    G4double fCoarseStep;
+
+    // Per thread, the tabulated kernel resampled at the recently used time steps.
+    static G4ThreadLocal sbPulseKernelCache* fKernelCache;
+
+public:
+    void SetPulseShape(sbPulseShape pulseShape);
+    void SetRiseTime(G4double riseTime);
+    void SetFallTime(G4double fallTime);
+    void SetPulseFileName(const G4String& fileName);
+    void SetSparse(G4bool sparse) { fSparse = sparse; }
+    void SetThreshold(G4double threshold) { fThreshold = threshold; }
+    void SetFineStep(G4double fineStep) { fFineStep = fineStep; }
+    void SetFineWindow(G4double fineWindow) { fFineWindow = fineWindow; }
+    void SetCoarseStep(G4double coarseStep) { fCoarseStep = coarseStep; }
+
+    G4bool IsSparse() const { return fSparse; }
+    G4double GetThreshold() const { return fThreshold; }
+
+    // Regions from startTime to endTime, fine at the leading edges of the pulses (sorted by time).
+    void BuildSparseGrid(const std::vector<sbPulse>& upperPulses, const std::vector<sbPulse>& lowerPulses,
+        G4double startTime, G4double endTime, std::vector<sbWaveformRegion>& regions) const;
+
+    // Pulses sorted by time, the waveform is resized to the samples of the regions.
+    void Synthesize(const std::vector<sbPulse>& pulses, const std::vector<sbWaveformRegion>& regions,
+        std::vector<float>& waveform) const;
+
+private:
+    G4bool LoadPulseFile();
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SB_WORKER_THREAD_INITIALIZATION_H
+#define SB_WORKER_THREAD_INITIALIZATION_H 1
+
+#include "G4UserWorkerThreadInitialization.hh"
+
+// Clones engines unknown to Geant4 (sbXoshiroEngine) for worker threads,
+// the others are left to G4UserWorkerThreadInitialization.
+class sbWorkerThreadInitialization : public G4UserWorkerThreadInitialization {
+public:
+    sbWorkerThreadInitialization() : G4UserWorkerThreadInitialization() {}
+    virtual ~sbWorkerThreadInitialization() {}
+
+    virtual void SetupRNGEngine(const CLHEP::HepRandomEngine* masterEngine) const;
+};
+
+#endif
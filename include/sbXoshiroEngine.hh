@@ -0,0 +1,78 @@
+#ifndef SB_XOSHIRO_ENGINE_H
+#define SB_XOSHIRO_ENGINE_H 1
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CLHEP/Random/RandomEngine.h"
+
+// xoshiro256** (Blackman & Vigna) as a CLHEP random engine.
+//
+// 256-bit state, period 2^256 - 1, a few ns per number. flatArray() is a tight loop
+// over the state kept in registers, use it for bulk draws (see sbMuonBatch).
+//
+// Seeding: the seeds are hashed into the state with splitmix64, so seeds that differ
+// in a single bit give unrelated streams. In MT mode every worker has its own engine
+// (see sbWorkerThreadInitialization) and Geant4 reseeds it with setSeeds() from the
+// master engine at every event, so the streams are independent per thread and per
+// event, and an event is reproducible from its seeds.
+class sbXoshiroEngine : public CLHEP::HepRandomEngine {
+public:
+    sbXoshiroEngine();
+    sbXoshiroEngine(long seed);
+    virtual ~sbXoshiroEngine() {}
+
+    virtual double flat() { return ToDouble(Next()); }
+    virtual void flatArray(const int size, double* vect);
+
+    virtual void setSeed(long seed, int);
+    virtual void setSeeds(const long* seeds, int numOfSeeds);
+
+    virtual void saveStatus(const char filename[] = "xoshiro256ss.conf") const;
+    virtual void restoreStatus(const char filename[] = "xoshiro256ss.conf");
+    virtual void showStatus() const;
+
+    virtual std::string name() const { return engineName(); }
+    static std::string engineName() { return "sbXoshiroEngine"; }
+    static std::string beginTag() { return "sbXoshiroEngine-begin"; }
+
+    virtual std::ostream& put(std::ostream& os) const;
+    virtual std::istream& get(std::istream& is);
+    virtual std::istream& getState(std::istream& is);
+    virtual std::vector<unsigned long> put() const;
+    virtual bool get(const std::vector<unsigned long>& v);
+    virtual bool getState(const std::vector<unsigned long>& v);
+
+    virtual operator double() { return flat(); }
+    virtual operator float() { return static_cast<float>(flat()); }
+    virtual operator unsigned int() { return static_cast<unsigned int>(Next() >> 32); }
+
+    // Advance the state by 2^128 numbers, i.e. start a non-overlapping subsequence.
+    void Jump();
+
+private:
+    static inline uint64_t RotateLeft(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    // Upper 53 bits to (0, 1), zero is excluded as CLHEP engines do.
+    static inline double ToDouble(uint64_t x) { return (static_cast<double>(x >> 11) + 0.5) * 0x1.0p-53; }
+    inline uint64_t Next();
+
+    uint64_t fState[4];
+    // Seeds of the last setSeeds(), zero-terminated as CLHEP expects.
+    long fSeeds[3];
+};
+
+inline uint64_t sbXoshiroEngine::Next() {
+    const uint64_t result = RotateLeft(fState[1] * 5, 7) * 9;
+    const uint64_t t = fState[1] << 17;
+    fState[2] ^= fState[0];
+    fState[3] ^= fState[1];
+    fState[1] ^= fState[2];
+    fState[0] ^= fState[3];
+    fState[2] ^= t;
+    fState[3] = RotateLeft(fState[3], 45);
+    return result;
+}
+
+#endif
@@ -11,6 +11,16 @@
 #include "sbDetectorConstruction.hh"
 #include "sbActionInitialization.hh"
 #include "sbPhysicsList.hh"
+#include "sbRandomEngines.hh"
+#include "sbRandomMessenger.hh"
+#include "sbOpticalMapMessenger.hh"
+#include "sbDepositMessenger.hh"
+#include "sbWaveformMessenger.hh"
+#include "sbFeatureMessenger.hh"
+#include "sbNoiseMessenger.hh"
+#include "sbTriggerMessenger.hh"
+#include "sbBiasingMessenger.hh"
+#include "sbWorkerThreadInitialization.hh"
 #include "sbConfigs.hh"
 
 G4bool gRunningInBatch;
@@ -26,7 +36,6 @@ int main(int argc, char** argv) {
         gRunningInBatch = false;
     } else {
         gRunningInBatch = true;
-        G4cout << "mkdir returns " << system(("mkdir " + gSiPMResultCSVDestDir).c_str()) << G4endl;
     }
 
     // Random engine seed.
@@ -34,11 +43,15 @@ int main(int argc, char** argv) {
 #if SB_USING_TIME_RANDOM_SEED
     CLHEP::HepRandom::setTheSeed((long)time(nullptr));
 #endif
+    // Random engine, before the run manager keeps it as the master engine.
+    sbRandomEngines::SelectEngineAtStartUp();
 
     // Construct the default run manager
     //
 #ifdef G4MULTITHREADED
     G4MTRunManager* runManager = new G4MTRunManager();
+    // Worker engines of the same type as the master engine.
+    runManager->SetUserInitialization(new sbWorkerThreadInitialization());
 #else
     G4RunManager* runManager = new G4RunManager();
 #endif
@@ -63,6 +76,14 @@ int main(int argc, char** argv) {
 
     // Get the pointer to the User Interface manager
     G4UImanager* UImanager = G4UImanager::GetUIpointer();
+    sbRandomMessenger* randomMessenger = new sbRandomMessenger();
+    sbOpticalMapMessenger* opticalMapMessenger = new sbOpticalMapMessenger();
+    sbDepositMessenger* depositMessenger = new sbDepositMessenger();
+    sbWaveformMessenger* waveformMessenger = new sbWaveformMessenger();
+    sbFeatureMessenger* featureMessenger = new sbFeatureMessenger();
+    sbNoiseMessenger* noiseMessenger = new sbNoiseMessenger();
+    sbTriggerMessenger* triggerMessenger = new sbTriggerMessenger();
+    sbBiasingMessenger* biasingMessenger = new sbBiasingMessenger();
 
     // Process macro or start UI session
     //
@@ -84,6 +105,14 @@ int main(int argc, char** argv) {
     // owned and deleted by the run manager, so they should not be deleted 
     // in the main() program !
 
+    delete biasingMessenger;
+    delete triggerMessenger;
+    delete noiseMessenger;
+    delete featureMessenger;
+    delete waveformMessenger;
+    delete depositMessenger;
+    delete opticalMapMessenger;
+    delete randomMessenger;
     delete visManager;
     delete runManager;
 }
\ No newline at end of file
@@ -1,24 +1,43 @@
 #include "sbActionInitialization.hh"
+#include "sbMuonSpectrumTable.hh"
+#include "sbOpticalResponseMap.hh"
+#include "sbConfigs.hh"
 
 ActionInitialization::ActionInitialization() : G4VUserActionInitialization() {}
 
 ActionInitialization::~ActionInitialization() {}
 
 void ActionInitialization::BuildForMaster() const {
+#if SB_USING_MUON_SPECTRUM_TABLE
+    // Build the shared spectrum table on master, workers only read it.
+    sbMuonSpectrumTable::GetInstance();
+#endif
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    // Load the shared response map on master.
+    sbOpticalResponseMap::GetInstance();
+#endif
+
     sbRunAction* runAction = new sbRunAction();
     SetUserAction(runAction);
 }
 
 void ActionInitialization::Build() const {
-    SetUserAction(new sbPrimaryGeneratorAction);
-
     sbRunAction* runAction = new sbRunAction();
     SetUserAction(runAction);
 
+    sbPrimaryGeneratorAction* primaryGenerator = new sbPrimaryGeneratorAction(runAction);
+    SetUserAction(primaryGenerator);
+    runAction->SetPrimaryGeneratorAction(primaryGenerator);
+
     sbEventAction* eventAction = new sbEventAction(runAction);
     SetUserAction(eventAction);
 
     sbSteppingAction* steppingAction = new sbSteppingAction(eventAction);
     SetUserAction(steppingAction);
+    runAction->SetSteppingAction(steppingAction);
+
+#if SB_ENABLE_OPTICAL_PHYSICS
+    SetUserAction(new sbStackingAction(steppingAction));
+#endif
 }
 
@@ -0,0 +1,192 @@
+#include <cstring>
+
+#include "sbAsyncFileWriter.hh"
+#include "sbGlobal.hh"
+
+sbAsyncFileWriter& sbAsyncFileWriter::GetInstance() {
+    static sbAsyncFileWriter instance;
+    return instance;
+}
+
+sbAsyncFileWriter::sbAsyncFileWriter() :
+    fQueue(gAsyncWriterQueueCapacity),
+    fWriterThread(),
+    fRunning(false),
+    fWaitMutex(),
+    fQueueNotEmpty(),
+    fQueueNotFull(),
+    fWriterSleeping(false),
+    fNumOfStalledWorkers(0),
+    fFileName(),
+    fFile(nullptr),
+    fFileBuffer(gAsyncWriterBufferSize),
+    fFileOffset(0),
+    fIndex(),
+    fStartTime(),
+    fMaxQueueDepth(0),
+    fNumOfStalls(0),
+    fNumOfBytes(0),
+    fNumOfFailures(0),
+    fNumOfBatches(0),
+    fWriteSeconds(0.0) {}
+
+sbAsyncFileWriter::~sbAsyncFileWriter() {
+    Stop();
+}
+
+void sbAsyncFileWriter::Start(const G4String& fileName) {
+    if (fWriterThread.joinable()) { return; }
+    fFileName = fileName;
+    fFile = std::fopen(fileName.c_str(), "wb");
+    if (!fFile) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot open " + fileName << G4endl;
+        G4Exception(
+            "sbAsyncFileWriter::Start(const G4String& fileName)",
+            "CannotOpenFile",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+    // Large sequential writes, the batches go through this buffer.
+    std::setvbuf(fFile, fFileBuffer.data(), _IOFBF, fFileBuffer.size());
+    fFileOffset = 0;
+    fIndex.clear();
+    fMaxQueueDepth = 0;
+    fNumOfStalls = 0;
+    fNumOfBytes = 0;
+    fNumOfFailures = 0;
+    fNumOfBatches = 0;
+    fWriteSeconds = 0.0;
+
+    sbWaveformFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SBWAVEFM", 8);
+    header.version = gWaveformFileVersion;
+    Append(&header, sizeof(header));
+
+    fStartTime = std::chrono::steady_clock::now();
+    fRunning = true;
+    fWriterThread = std::thread(&sbAsyncFileWriter::WriterLoop, this);
+}
+
+void sbAsyncFileWriter::Stop() {
+    if (!fWriterThread.joinable()) { return; }
+    // The writer drains the queue before it returns.
+    fRunning = false;
+    WakeUp(fQueueNotEmpty);
+    fWriterThread.join();
+
+    sbWaveformFileTrailer trailer;
+    std::memset(&trailer, 0, sizeof(trailer));
+    trailer.indexOffset = fFileOffset;
+    trailer.numOfEvents = fIndex.size();
+    std::memcpy(trailer.magic, "SBWFINDX", 8);
+    Append(fIndex.data(), fIndex.size() * sizeof(sbWaveformIndexEntry));
+    Append(&trailer, sizeof(trailer));
+    if (std::fclose(fFile) != 0) { ++fNumOfFailures; }
+    fFile = nullptr;
+    PrintStatistics(std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fStartTime).count());
+}
+
+void sbAsyncFileWriter::Write(G4int eventID, std::string record) {
+    if (!fRunning) {
+        G4ExceptionDescription exceptout;
+        exceptout << "The writer is not running, event " << eventID << " is not written." << G4endl;
+        G4Exception(
+            "sbAsyncFileWriter::Write(G4int eventID, std::string record)",
+            "WriterNotRunning",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    sbWriteRequest request{ eventID, std::move(record) };
+    if (!fQueue.TryPush(std::move(request))) {
+        // Backpressure, the disk is behind.
+        ++fNumOfStalls;
+        std::unique_lock<std::mutex> lock(fWaitMutex);
+        ++fNumOfStalledWorkers;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        fQueueNotFull.wait(lock, [this, &request] { return fQueue.TryPush(std::move(request)); });
+        --fNumOfStalledWorkers;
+    }
+    // Pairs with the fence of the writer going to sleep: it sees the push or we see it asleep.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (fWriterSleeping.load(std::memory_order_relaxed)) { WakeUp(fQueueNotEmpty); }
+    // Depth seen by the producers, the queue is never deeper than after a push.
+    const size_t depth = fQueue.Size();
+    size_t maxDepth = fMaxQueueDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth && !fMaxQueueDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {}
+}
+
+void sbAsyncFileWriter::WriterLoop() {
+    sbWriteRequest request;
+    for (;;) {
+        // Stop is seen before the last pop, nothing pushed before Stop is lost.
+        const G4bool running = fRunning.load();
+        if (!fQueue.TryPop(request)) {
+            if (!running) { return; }
+            std::unique_lock<std::mutex> lock(fWaitMutex);
+            fWriterSleeping = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            fQueueNotEmpty.wait(lock, [this] { return fQueue.Size() > 0 || !fRunning; });
+            fWriterSleeping = false;
+            continue;
+        }
+        // A batch, everything queued so far.
+        const auto batchStartTime = std::chrono::steady_clock::now();
+        do {
+            const uint64_t offset = fFileOffset;
+            if (Append(request.record.data(), request.record.size())) {
+                fIndex.push_back(sbWaveformIndexEntry{ request.eventID, 0, offset, request.record.size() });
+            }
+        } while (fQueue.TryPop(request));
+        // The queue is empty now, stalled workers go on.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (fNumOfStalledWorkers.load(std::memory_order_relaxed) > 0) { WakeUp(fQueueNotFull); }
+        fWriteSeconds += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - batchStartTime).count();
+        ++fNumOfBatches;
+    }
+}
+
+void sbAsyncFileWriter::WakeUp(std::condition_variable& condition) {
+    // The waiter checks its condition under the mutex, taking it here closes the window
+    // between that check and its wait.
+    { std::lock_guard<std::mutex> lock(fWaitMutex); }
+    condition.notify_all();
+}
+
+G4bool sbAsyncFileWriter::Append(const void* data, size_t size) {
+    const size_t numOfBytes = std::fwrite(data, 1, size, fFile);
+    fFileOffset += numOfBytes;
+    fNumOfBytes += numOfBytes;
+    if (numOfBytes != size) {
+        ++fNumOfFailures;
+        return false;
+    }
+    return true;
+}
+
+void sbAsyncFileWriter::PrintStatistics(G4double elapsedSeconds) const {
+    G4cout << "sbAsyncFileWriter: " << fIndex.size() << " events, " << fNumOfBytes / 1048576.0 << " MiB to "
+        << fFileName << " in " << fNumOfBatches << " batches.\n"
+        << "    Write time " << fWriteSeconds << " s of " << elapsedSeconds << " s";
+    if (fWriteSeconds > 0.0) {
+        G4cout << ", throughput " << fNumOfBytes / 1048576.0 / fWriteSeconds << " MiB/s";
+    }
+    G4cout << ".\n"
+        << "    Max queue depth " << fMaxQueueDepth.load() << " of " << fQueue.Capacity()
+        << ", workers stalled on a full queue " << fNumOfStalls.load() << " times." << G4endl;
+    if (fNumOfFailures > 0) {
+        G4ExceptionDescription exceptout;
+        exceptout << fNumOfFailures << " writes to " << fFileName << " failed, the container is incomplete." << G4endl;
+        G4Exception(
+            "sbAsyncFileWriter::PrintStatistics(G4double elapsedSeconds)",
+            "CannotWriteFile",
+            JustWarning,
+            exceptout
+        );
+    }
+}
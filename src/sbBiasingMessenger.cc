@@ -0,0 +1,39 @@
+#include "sbBiasingMessenger.hh"
+#include "sbPrimaryGeneratorAction.hh"
+#include "sbGlobal.hh"
+
+sbBiasingMessenger::sbBiasingMessenger() :
+    G4UImessenger() {
+    fBiasingDirectory = new G4UIdirectory("/smallbox/biasing/");
+    fBiasingDirectory->SetGuidance("Muon spectrum biasing (E/GeV)^energyIndex * cos(theta)^zenithIndex.");
+    fBiasingDirectory->SetGuidance("Only with SB_ENABLE_MUON_SPECTRUM_BIASING. Before /run/initialize, which builds");
+    fBiasingDirectory->SetGuidance("the muon spectrum table with them.");
+
+    fEnergyIndexCmd = new G4UIcmdWithADouble("/smallbox/biasing/energyIndex", this);
+    fEnergyIndexCmd->SetGuidance("Energy exponent, positive enhances the TeV tail, negative stopping muons.");
+    fEnergyIndexCmd->SetParameterName("energyIndex", false);
+    fEnergyIndexCmd->SetDefaultValue(gEnergyBiasIndex);
+    fEnergyIndexCmd->AvailableForStates(G4State_PreInit);
+    fEnergyIndexCmd->SetToBeBroadcasted(false);
+
+    fZenithIndexCmd = new G4UIcmdWithADouble("/smallbox/biasing/zenithIndex", this);
+    fZenithIndexCmd->SetGuidance("cos(theta) exponent, negative enhances inclined muons.");
+    fZenithIndexCmd->SetParameterName("zenithIndex", false);
+    fZenithIndexCmd->SetDefaultValue(gZenithBiasIndex);
+    fZenithIndexCmd->AvailableForStates(G4State_PreInit);
+    fZenithIndexCmd->SetToBeBroadcasted(false);
+}
+
+sbBiasingMessenger::~sbBiasingMessenger() {
+    delete fZenithIndexCmd;
+    delete fEnergyIndexCmd;
+    delete fBiasingDirectory;
+}
+
+void sbBiasingMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fEnergyIndexCmd) {
+        sbPrimaryGeneratorAction::SetEnergyBiasIndex(fEnergyIndexCmd->GetNewDoubleValue(newValue));
+    } else if (command == fZenithIndexCmd) {
+        sbPrimaryGeneratorAction::SetZenithBiasIndex(fZenithIndexCmd->GetNewDoubleValue(newValue));
+    }
+}
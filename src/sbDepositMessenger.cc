@@ -0,0 +1,38 @@
+#include "sbDepositMessenger.hh"
+#include "sbDepositRecorder.hh"
+#include "sbGlobal.hh"
+
+sbDepositMessenger::sbDepositMessenger() :
+    G4UImessenger() {
+    fDepositsDirectory = new G4UIdirectory("/smallbox/deposits/");
+    fDepositsDirectory->SetGuidance("Scintillator deposit recording for the optical replay.");
+
+    fRecordCmd = new G4UIcmdWithABool("/smallbox/deposits/record", this);
+    fRecordCmd->SetGuidance("Record the scintillator deposits of the following runs, optical photons are not tracked.");
+    fRecordCmd->SetGuidance("Replay them with /smallbox/gun/source replay.");
+    fRecordCmd->SetParameterName("record", true);
+    fRecordCmd->SetDefaultValue(true);
+    fRecordCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fRecordCmd->SetToBeBroadcasted(false);
+
+    fFileCmd = new G4UIcmdWithAString("/smallbox/deposits/file", this);
+    fFileCmd->SetGuidance("Deposit file written by the record mode, overwritten by every run.");
+    fFileCmd->SetParameterName("fileName", false);
+    fFileCmd->SetDefaultValue(gDepositFileName);
+    fFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fFileCmd->SetToBeBroadcasted(false);
+}
+
+sbDepositMessenger::~sbDepositMessenger() {
+    delete fFileCmd;
+    delete fRecordCmd;
+    delete fDepositsDirectory;
+}
+
+void sbDepositMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fRecordCmd) {
+        sbDepositRecorder::GetInstance().SetEnabled(fRecordCmd->GetNewBoolValue(newValue));
+    } else if (command == fFileCmd) {
+        sbDepositRecorder::GetInstance().SetFileName(newValue);
+    }
+}
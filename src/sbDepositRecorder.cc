@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "G4Event.hh"
+#include "G4Step.hh"
+#include "G4SDManager.hh"
+#include "G4Threading.hh"
+#include "G4SystemOfUnits.hh"
+#ifdef G4MULTITHREADED
+#include "G4MTRunManager.hh"
+#endif
+
+#include "sbDepositRecorder.hh"
+#include "sbScintillatorHit.hh"
+#include "sbSiPMSD.hh"
+#include "sbGlobal.hh"
+
+G4ThreadLocal std::ofstream* sbDepositRecorder::fThreadFile = nullptr;
+G4ThreadLocal std::vector<sbDepositFileStep>* sbDepositRecorder::fEventSteps = nullptr;
+
+sbDepositRecorder& sbDepositRecorder::GetInstance() {
+    static sbDepositRecorder instance;
+    return instance;
+}
+
+sbDepositRecorder::sbDepositRecorder() :
+    fEnabled(false),
+    fFileName(gDepositFileName) {}
+
+G4String sbDepositRecorder::ThreadFileName(G4int threadID) const {
+    return fFileName + ".t" + std::to_string(threadID);
+}
+
+void sbDepositRecorder::BeginOfRun() const {
+    if (!fEventSteps) { fEventSteps = new std::vector<sbDepositFileStep>(); }
+    fEventSteps->clear();
+    delete fThreadFile;
+    const G4String threadFileName = ThreadFileName(std::max(G4Threading::G4GetThreadId(), 0));
+    fThreadFile = new std::ofstream(threadFileName, std::ios::binary | std::ios::trunc);
+    if (!*fThreadFile) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot open " + threadFileName << G4endl;
+        G4Exception(
+            "sbDepositRecorder::BeginOfRun()",
+            "CannotOpenFile",
+            FatalException,
+            exceptout
+        );
+    }
+}
+
+void sbDepositRecorder::RecordStep(const G4Step* step) const {
+    const G4double energyDeposit = step->GetTotalEnergyDeposit();
+    if (energyDeposit <= 0.0 || !fEventSteps) { return; }
+    const G4StepPoint* preStepPoint = step->GetPreStepPoint();
+    const G4StepPoint* postStepPoint = step->GetPostStepPoint();
+    const G4ThreeVector& prePosition = preStepPoint->GetPosition();
+    const G4ThreeVector& postPosition = postStepPoint->GetPosition();
+    fEventSteps->push_back(sbDepositFileStep{
+        step->GetTrack()->GetParticleDefinition()->GetPDGEncoding(),
+        static_cast<float>(energyDeposit / MeV),
+        static_cast<float>(step->GetNonIonizingEnergyDeposit() / MeV),
+        static_cast<float>(step->GetStepLength() / mm),
+        static_cast<float>(preStepPoint->GetGlobalTime() / ns),
+        static_cast<float>(postStepPoint->GetGlobalTime() / ns),
+        { static_cast<float>(prePosition.x() / mm), static_cast<float>(prePosition.y() / mm),
+          static_cast<float>(prePosition.z() / mm) },
+        { static_cast<float>(postPosition.x() / mm), static_cast<float>(postPosition.y() / mm),
+          static_cast<float>(postPosition.z() / mm) }
+    });
+}
+
+void sbDepositRecorder::DiscardEvent() const {
+    if (fEventSteps) { fEventSteps->clear(); }
+}
+
+void sbDepositRecorder::EndOfEvent(const G4Event* event) const {
+    if (!fEventSteps || !fThreadFile) { return; }
+    if (fEventSteps->empty() || event->IsAborted()) {
+        fEventSteps->clear();
+        return;
+    }
+    uint32_t muonHitMask = 0;
+    const G4int muonHitsCollectionID =
+        G4SDManager::GetSDMpointer()->GetCollectionID(gScintillatorSDName + "/muon_hits_collection");
+    if (muonHitsCollectionID >= 0 && event->GetHCofThisEvent()) {
+        auto muonHitsCollection =
+            static_cast<const sbScintillatorHitsCollection*>(event->GetHCofThisEvent()->GetHC(muonHitsCollectionID));
+        for (size_t i = 0; i < muonHitsCollection->entries(); ++i) {
+            auto hit = static_cast<const sbScintillatorHit*>(muonHitsCollection->GetHit(i));
+            muonHitMask |= hit->GetScintillatorID() == sbScintillatorHit::fUpperScintillator ? 1u : 2u;
+        }
+    }
+    const sbDepositFileEvent eventRecord = {
+        static_cast<float>(sbSiPMSD::GetEventWeight()),
+        muonHitMask,
+        static_cast<uint32_t>(fEventSteps->size()),
+        0
+    };
+    fThreadFile->write(reinterpret_cast<const char*>(&eventRecord), sizeof(eventRecord));
+    fThreadFile->write(reinterpret_cast<const char*>(fEventSteps->data()),
+        fEventSteps->size() * sizeof(sbDepositFileStep));
+    fEventSteps->clear();
+}
+
+void sbDepositRecorder::EndOfRun() const {
+    delete fThreadFile;
+    fThreadFile = nullptr;
+}
+
+void sbDepositRecorder::Merge() const {
+    G4int numOfThreads = 1;
+#ifdef G4MULTITHREADED
+    if (G4Threading::IsMultithreadedApplication()) {
+        numOfThreads = G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads();
+    }
+#endif
+    // First pass, the event records.
+    std::vector<sbDepositFileEvent> events;
+    uint64_t numOfSteps = 0;
+    for (G4int threadID = 0; threadID < numOfThreads; ++threadID) {
+        std::ifstream threadFile(ThreadFileName(threadID), std::ios::binary);
+        sbDepositFileEvent eventRecord;
+        while (threadFile.read(reinterpret_cast<char*>(&eventRecord), sizeof(eventRecord))) {
+            events.push_back(eventRecord);
+            numOfSteps += eventRecord.numOfSteps;
+            threadFile.seekg(eventRecord.numOfSteps * sizeof(sbDepositFileStep), std::ios::cur);
+        }
+    }
+
+    std::ofstream file(fFileName, std::ios::binary | std::ios::trunc);
+    sbDepositFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SBDEPOST", 8);
+    header.version = 1;
+    header.numOfEvents = events.size();
+    header.numOfSteps = numOfSteps;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t firstStep = 0;
+    file.write(reinterpret_cast<const char*>(&firstStep), sizeof(firstStep));
+    for (const auto& eventRecord : events) {
+        firstStep += eventRecord.numOfSteps;
+        file.write(reinterpret_cast<const char*>(&firstStep), sizeof(firstStep));
+    }
+    file.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(sbDepositFileEvent));
+
+    // Second pass, the steps.
+    std::vector<sbDepositFileStep> steps;
+    for (G4int threadID = 0; threadID < numOfThreads; ++threadID) {
+        const G4String threadFileName = ThreadFileName(threadID);
+        std::ifstream threadFile(threadFileName, std::ios::binary);
+        sbDepositFileEvent eventRecord;
+        while (threadFile.read(reinterpret_cast<char*>(&eventRecord), sizeof(eventRecord))) {
+            steps.resize(eventRecord.numOfSteps);
+            threadFile.read(reinterpret_cast<char*>(steps.data()), steps.size() * sizeof(sbDepositFileStep));
+            file.write(reinterpret_cast<const char*>(steps.data()), steps.size() * sizeof(sbDepositFileStep));
+        }
+        threadFile.close();
+        std::remove(threadFileName.c_str());
+    }
+
+    if (!file) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot write " + fFileName << G4endl;
+        G4Exception(
+            "sbDepositRecorder::Merge()",
+            "CannotWriteFile",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    G4cout << "sbDepositRecorder: " << events.size() << " events, " << numOfSteps
+        << " deposition steps written to " << fFileName << G4endl;
+}
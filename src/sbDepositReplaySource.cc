@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4ParticleTable.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4Material.hh"
+#include "G4LossTableManager.hh"
+#include "G4EmSaturation.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "sbDepositReplaySource.hh"
+#include "sbDetectorConstruction.hh"
+#include "sbGlobal.hh"
+#include "sbConfigs.hh"
+
+sbDepositReplaySource::sbDepositReplaySource(const G4String& fileName) :
+    fMappedFile(sbMappedFile::MapShared(fileName)),
+    fNumOfEvents(0),
+    fFirstStep(nullptr),
+    fEvents(nullptr),
+    fSteps(nullptr),
+    fMuonHitMask(0),
+    fInitialized(false),
+    fSpectrum(),
+    fEmSaturation(nullptr),
+    fScintillatorCouple(nullptr) {
+    const char* data = fMappedFile->GetData();
+    const size_t size = fMappedFile->GetSize();
+    const auto header = reinterpret_cast<const sbDepositFileHeader*>(data);
+    // The index must be ascending and within the steps, GeneratePrimaries relies on it.
+    const G4bool valid = size >= sizeof(sbDepositFileHeader) &&
+        std::memcmp(header->magic, "SBDEPOST", 8) == 0 &&
+        header->version == 1 &&
+        fMappedFile->HasIndexedRecords(sizeof(sbDepositFileHeader), header->numOfEvents, sizeof(sbDepositFileEvent),
+            header->numOfSteps, sizeof(sbDepositFileStep));
+    if (!valid) {
+        G4ExceptionDescription exceptout;
+        exceptout << fileName + " is not a valid deposit file (version 1)." << G4endl;
+        G4Exception(
+            "sbDepositReplaySource::sbDepositReplaySource(const G4String& fileName)",
+            "InvalidDepositFile",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+    fNumOfEvents = header->numOfEvents;
+    fFirstStep = reinterpret_cast<const uint64_t*>(data + sizeof(sbDepositFileHeader));
+    fEvents = reinterpret_cast<const sbDepositFileEvent*>(fFirstStep + fNumOfEvents + 1);
+    fSteps = reinterpret_cast<const sbDepositFileStep*>(fEvents + fNumOfEvents);
+    G4cout << "sbDepositReplaySource: " << fNumOfEvents << " events in " << fileName << G4endl;
+}
+
+void sbDepositReplaySource::CheckNumOfEvents(G4int numOfEvents) const {
+    if (uint64_t(numOfEvents) <= fNumOfEvents) { return; }
+    G4ExceptionDescription exceptout;
+    exceptout << "Run of " << numOfEvents << " events, but " << fMappedFile->GetFileName()
+        << " holds " << fNumOfEvents << " only." << G4endl;
+    G4Exception(
+        "sbDepositReplaySource::CheckNumOfEvents(G4int numOfEvents)",
+        "DepositFileTooShort",
+        FatalException,
+        exceptout
+    );
+}
+
+void sbDepositReplaySource::Initialize() {
+    fInitialized = true;
+    if (!fSpectrum.Build(G4Material::GetMaterial(gScintillatorMaterialName))) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Replay needs the optical properties, is SB_ENABLE_OPTICAL_PHYSICS enabled?" << G4endl;
+        G4Exception(
+            "sbDepositReplaySource::Initialize()",
+            "NoOpticalProperties",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+    // Birks' law as G4OpticalPhysics sets it up for G4Scintillation.
+    fEmSaturation = G4LossTableManager::Instance()->EmSaturation();
+    fScintillatorCouple = sbDetectorConstruction::GetsbDCInstance()->GetPhysicalScintillators().first->
+        GetLogicalVolume()->GetMaterialCutsCouple();
+}
+
+void sbDepositReplaySource::GeneratePrimaries(G4Event* event) {
+    // Record of the event ID, the run is checked against the file at its start.
+    const uint64_t eventID = event->GetEventID();
+    if (eventID >= fNumOfEvents) {
+        event->SetEventAborted();
+        return;
+    }
+    if (!fInitialized) { Initialize(); }
+
+#if SB_REDUCE_SCINTILLATION_YIELD
+    constexpr G4double yieldFactor = 1.0 / gScintillationYieldReduction;
+    constexpr G4double photonWeight = gScintillationYieldReduction;
+#else
+    constexpr G4double yieldFactor = 1.0;
+    constexpr G4double photonWeight = 1.0;
+#endif
+    const sbDepositFileEvent& eventRecord = fEvents[eventID];
+    fMuonHitMask = eventRecord.muonHitMask;
+    // The event weight on a vertex of its own, the photon vertices keep weight 1 so the photon
+    // tracks (vertex times primary weight) carry only their own (see sbSiPMSD::PhotonWeight).
+    auto weightVertex = new G4PrimaryVertex(G4ThreeVector(), 0.0);
+    weightVertex->SetWeight(eventRecord.weight);
+    event->AddPrimaryVertex(weightVertex);
+    auto particleTable = G4ParticleTable::GetParticleTable();
+    for (uint64_t i = fFirstStep[eventID]; i < fFirstStep[eventID + 1]; ++i) {
+        const sbDepositFileStep& step = fSteps[i];
+        auto particleDefinition = particleTable->FindParticle(step.pdgCode);
+        if (!particleDefinition) { continue; }
+        G4double visibleEnergy = step.energyDeposit * MeV;
+        if (fEmSaturation && fScintillatorCouple) {
+            visibleEnergy = fEmSaturation->VisibleEnergyDeposition(particleDefinition, fScintillatorCouple,
+                step.stepLength * mm, step.energyDeposit * MeV, step.nonIonizingEnergyDeposit * MeV);
+        }
+        // Number of photons and components as G4Scintillation.
+        const G4int numOfPhotons = fSpectrum.SampleNumOfPhotons(fSpectrum.GetYield() * yieldFactor * visibleEnergy);
+        if (numOfPhotons <= 0) { continue; }
+        const G4int numOfFastPhotons = G4int(std::min(fSpectrum.GetYieldRatio(), 1.0) * numOfPhotons);
+
+        const G4ThreeVector prePosition(step.prePosition[0], step.prePosition[1], step.prePosition[2]);
+        const G4ThreeVector stepVector =
+            G4ThreeVector(step.postPosition[0], step.postPosition[1], step.postPosition[2]) - prePosition;
+        for (G4int j = 0; j < numOfPhotons; ++j) {
+            const G4bool fast = j < numOfFastPhotons;
+            const G4double timeConstant = fast ? fSpectrum.GetFastTimeConstant() : fSpectrum.GetSlowTimeConstant();
+            const G4double fraction = G4UniformRand();
+            G4double time = step.preTime + fraction * (step.postTime - step.preTime);
+            time = time * ns - timeConstant * log(G4UniformRand());
+
+            G4ThreeVector direction, polarization;
+            sbScintillationSpectrum::SamplePhotonDirection(direction, polarization);
+            auto vertex = new G4PrimaryVertex((prePosition + fraction * stepVector) * mm, time);
+            auto photon = new G4PrimaryParticle(G4OpticalPhoton::Definition());
+            photon->SetKineticEnergy(fSpectrum.SamplePhotonEnergy(fast));
+            photon->SetMomentumDirection(direction);
+            photon->SetPolarization(polarization);
+            photon->SetWeight(photonWeight);
+            vertex->SetPrimary(photon);
+            event->AddPrimaryVertex(vertex);
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "sbDetectorConstruction.hh"
+#include "sbOpticalPhotonFastModel.hh"
 
 sbDetectorConstruction* sbDetectorConstruction::sbDCInstance = nullptr;
 
@@ -6,7 +7,14 @@ sbDetectorConstruction::sbDetectorConstruction() :
     fLogicalScintillator(nullptr),
     fPhysicalScintillators(nullptr, nullptr),
     fLogicalSiPM(nullptr),
-    fPhysicalSiPMs(nullptr, nullptr) {}
+    fPhysicalSiPMs(nullptr, nullptr)
+#if SB_ENABLE_OPTICAL_PHYSICS && SB_SIPM_SURFACE_DETECTION
+    , fSiPMSurfacePropertiesTable(nullptr),
+    fSiPMSurfacePDE(nullptr),
+    fSiPMSurfaceUnitEfficiency(nullptr),
+    fSiPMSurfaceAppliesPDE(true)
+#endif
+    {}
 
 G4VPhysicalVolume* sbDetectorConstruction::Construct() {
     // Set if check overlaps
@@ -81,6 +89,13 @@ G4VPhysicalVolume* sbDetectorConstruction::Construct() {
         gScintillatorGeneralName
     );
 
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    // scintillator region, envelope of the optical fast simulation model
+    //
+    auto scintillatorRegion = new G4Region(gScintillatorRegionName);
+    scintillatorRegion->AddRootLogicalVolume(fLogicalScintillator);
+#endif
+
     // physical upper scintillator construction
 
     this->fPhysicalScintillators.first = new G4PVPlacement(
@@ -250,6 +265,25 @@ G4VPhysicalVolume* sbDetectorConstruction::Construct() {
         checkOverlaps
     );
 
+#if SB_ENABLE_OPTICAL_PHYSICS && SB_SIPM_SURFACE_DETECTION
+    // SiPM optical surface construction
+
+    // SiPM optical surface
+    //
+    G4OpticalSurface* SiPMOpticalSurface = new G4OpticalSurface(
+        gSiPMGeneralName + "_optical_surface",
+        unified,
+        polished,
+        dielectric_metal
+    );
+    SetSiPMSurfaceProperties(SiPMOpticalSurface);
+    new G4LogicalSkinSurface(
+        gSiPMGeneralName + "_surface",
+        fLogicalSiPM,
+        SiPMOpticalSurface
+    );
+#endif
+
     // ============================================================================
     // light guides
     // ============================================================================
@@ -378,6 +412,15 @@ void sbDetectorConstruction::ConstructSDandField() {
     sbSiPMSD* SiPMSD = new sbSiPMSD(gSiPMSDName);
     SDManager->AddNewDetector(SiPMSD);
     SetSensitiveDetector(fLogicalSiPM, SiPMSD);
+#if SB_DIGITIZE_SIPM_HITS
+    // Run by sbSiPMSD at the end of every event.
+    G4DigiManager::GetDMpointer()->AddNewModule(new sbSiPMDigitizer(gSiPMDigitizerName));
+#endif
+#endif
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    // Registered to the region, one per thread.
+    scintillatorSD->SetOpticalFastModel(
+        new sbOpticalPhotonFastModel(G4RegionStore::GetInstance()->GetRegion(gScintillatorRegionName)));
 #endif
 }
 
@@ -402,7 +445,7 @@ void sbDetectorConstruction::SetWorldMaterialProperties(G4Material* worldMateria
 
 void sbDetectorConstruction::SetScintillatorMaterialProperties(G4Material* scintillatorMaterial) const {
     G4MaterialPropertiesTable* scintillatorPropertiesTable = new G4MaterialPropertiesTable();
-    auto scintillatorProperties(CreateMapFromCSV<G4double>("./datafiles/scintillatorProperties.csv"));
+    auto scintillatorProperties(CreateMapFromCSV<G4double>(gScintillatorPropertiesFileName));
 
     scintillatorPropertiesTable->AddProperty(
         "RINDEX",
@@ -519,6 +562,7 @@ void sbDetectorConstruction::SetSiPMMaterialProperties(G4Material* SiPMMaterial)
         refractionIndex,
         2
     );
+#if !SB_SIPM_SURFACE_DETECTION
     // Absorption length
     G4double absorptionLengthPhotonEnergy[2] = { 1.0 * eV, 20.0 * eV };
     G4double absorptionLength[2] = { 0.0, 0.0 };
@@ -528,11 +572,60 @@ void sbDetectorConstruction::SetSiPMMaterialProperties(G4Material* SiPMMaterial)
         absorptionLength,
         2
     );
+#endif
 
     // Set!
     SiPMMaterial->SetMaterialPropertiesTable(SiPMPropertiesTable);
 }
 
+#if SB_SIPM_SURFACE_DETECTION
+void sbDetectorConstruction::SetSiPMSurfaceProperties(G4OpticalSurface* SiPMOpticalSurface) {
+    G4MaterialPropertiesTable* SiPMSurfacePropertiesTable = new G4MaterialPropertiesTable();
+    auto SiPMProperties(CreateMapFromCSV<G4double>(gSiPMPropertiesFileName));
+
+    // Reflectivity, every photon reaching the surface is absorbed.
+    G4double reflectionPhotonEnergy[2] = { 1.0 * eV, 20.0 * eV };
+    G4double reflectivity[2] = { 0.0, 0.0 };
+    SiPMSurfacePropertiesTable->AddProperty(
+        "REFLECTIVITY",
+        reflectionPhotonEnergy,
+        reflectivity,
+        2
+    );
+    // Efficiency, absorbed photons are detected with the PDE, or all of them with the PDE filter.
+    fSiPMSurfacePDE = new G4MaterialPropertyVector(
+        &SiPMProperties["PDE_energy"][0],
+        &SiPMProperties["PDE"][0],
+        SiPMProperties["PDE"].size()
+    );
+    std::vector<G4double> unitEfficiency(SiPMProperties["PDE"].size(), 1.0);
+    fSiPMSurfaceUnitEfficiency = new G4MaterialPropertyVector(
+        &SiPMProperties["PDE_energy"][0],
+        &unitEfficiency[0],
+        unitEfficiency.size()
+    );
+    SiPMSurfacePropertiesTable->AddProperty(
+        "EFFICIENCY",
+        fSiPMSurfaceAppliesPDE ? fSiPMSurfacePDE : fSiPMSurfaceUnitEfficiency
+    );
+
+    // Set!
+    SiPMOpticalSurface->SetMaterialPropertiesTable(SiPMSurfacePropertiesTable);
+    fSiPMSurfacePropertiesTable = SiPMSurfacePropertiesTable;
+}
+
+void sbDetectorConstruction::SetSiPMSurfacePDE(G4bool applyPDE) {
+    // Every worker sets the same value while processing its commands, only the first changes it.
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (applyPDE == fSiPMSurfaceAppliesPDE) { return; }
+    fSiPMSurfaceAppliesPDE = applyPDE;
+    // Before the geometry is built, SetSiPMSurfaceProperties() picks the vector.
+    if (!fSiPMSurfacePropertiesTable) { return; }
+    fSiPMSurfacePropertiesTable->AddProperty("EFFICIENCY", applyPDE ? fSiPMSurfacePDE : fSiPMSurfaceUnitEfficiency);
+}
+#endif
+
 void sbDetectorConstruction::SetLightGuideMaterialProperties(G4Material* lightGuideMaterial) const {
     G4MaterialPropertiesTable* lightGuidePropertiesTable = new G4MaterialPropertiesTable();
 
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "sbElectronicNoise.hh"
+#include "sbXoshiroEngine.hh"
+#include "CreateMapFromCSV.hh"
+#include "sbGlobal.hh"
+
+G4ThreadLocal sbElectronicNoise::sbNoiseRing* sbElectronicNoise::fRing = nullptr;
+
+namespace {
+    // In place radix-2 FFT, size a power of two, inverse without the 1/n.
+    void FFT(std::vector<std::complex<G4double>>& data, G4bool inverse) {
+        const size_t n = data.size();
+        for (size_t i = 1, j = 0; i < n; ++i) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) { j ^= bit; }
+            j ^= bit;
+            if (i < j) { std::swap(data[i], data[j]); }
+        }
+        for (size_t length = 2; length <= n; length <<= 1) {
+            const G4double angle = (inverse ? 2.0 : -2.0) * CLHEP::pi / length;
+            const std::complex<G4double> rotation(std::cos(angle), std::sin(angle));
+            for (size_t begin = 0; begin < n; begin += length) {
+                std::complex<G4double> twiddle(1.0, 0.0);
+                for (size_t k = 0; k < length / 2; ++k) {
+                    const auto even = data[begin + k];
+                    const auto odd = data[begin + k + length / 2] * twiddle;
+                    data[begin + k] = even + odd;
+                    data[begin + k + length / 2] = even - odd;
+                    twiddle *= rotation;
+                }
+            }
+        }
+    }
+}
+
+sbElectronicNoise& sbElectronicNoise::GetInstance() {
+    static sbElectronicNoise instance;
+    return instance;
+}
+
+sbElectronicNoise::sbElectronicNoise() :
+    fEnabled(false),
+    fSpectrumFileName(gSiPMPropertiesFileName),
+    fFrequencies(),
+    fPowerSpectrum(),
+    fRMS(0.0),
+    fTimeStep(gNoiseTimeStep),
+    fRingLength(gNoiseRingLength),
+    fSeed(0),
+    fRingVersion(0),
+    fBaselineSigma(0.0),
+    fWanderAmplitude(0.0),
+    fWanderFrequency(gNoiseWanderFrequency),
+    fADCLSB(0.0),
+    fADCBits(gADCBits),
+    fADCPedestal(gADCPedestal) {}
+
+void sbElectronicNoise::SetEnabled(G4bool enabled) {
+    // Loaded here by the master, the threads only read it.
+    if (enabled && fFrequencies.empty() && !LoadSpectrumFile()) { return; }
+    fEnabled = enabled;
+}
+
+void sbElectronicNoise::SetSpectrumFileName(const G4String& fileName) {
+    fSpectrumFileName = fileName;
+    fFrequencies.clear();
+    fPowerSpectrum.clear();
+    if (fEnabled && !LoadSpectrumFile()) { fEnabled = false; }
+}
+
+void sbElectronicNoise::SetRingLength(G4int ringLength) {
+    if (ringLength < 2 || (ringLength & (ringLength - 1))) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Noise ring length " << ringLength << " is not a power of two, unchanged." << G4endl;
+        G4Exception(
+            "sbElectronicNoise::SetRingLength(G4int ringLength)",
+            "InvalidRingLength",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    fRingLength = ringLength;
+    ++fRingVersion;
+}
+
+G4bool sbElectronicNoise::LoadSpectrumFile() {
+    auto spectrum(CreateMapFromCSV<G4double>(fSpectrumFileName));
+    const auto& frequencies = spectrum["NOISE_frequency"];
+    const auto& powerSpectrum = spectrum["NOISE_PSD"];
+    G4bool valid = frequencies.size() >= 2 && frequencies.size() == powerSpectrum.size();
+    for (size_t i = 1; valid && i < frequencies.size(); ++i) {
+        valid = frequencies[i] > frequencies[i - 1];
+    }
+    if (!valid) {
+        G4ExceptionDescription exceptout;
+        exceptout << fSpectrumFileName + " has no valid NOISE_frequency and NOISE_PSD." << G4endl;
+        exceptout << "The electronic noise stays off." << G4endl;
+        G4Exception(
+            "sbElectronicNoise::LoadSpectrumFile()",
+            "InvalidNoiseFile",
+            JustWarning,
+            exceptout
+        );
+        return false;
+    }
+    fFrequencies.resize(frequencies.size());
+    std::transform(frequencies.begin(), frequencies.end(), fFrequencies.begin(), [](G4double f) { return f * megahertz; });
+    fPowerSpectrum = powerSpectrum;
+    ++fRingVersion;
+    return true;
+}
+
+G4double sbElectronicNoise::PowerSpectrum(G4double frequency) const {
+    if (frequency < fFrequencies.front() || frequency > fFrequencies.back()) { return 0.0; }
+    const size_t i = std::upper_bound(fFrequencies.begin(), fFrequencies.end(), frequency) - fFrequencies.begin();
+    if (i == fFrequencies.size()) { return fPowerSpectrum.back(); }
+    const G4double fraction = (frequency - fFrequencies[i - 1]) / (fFrequencies[i] - fFrequencies[i - 1]);
+    return fPowerSpectrum[i - 1] + fraction * (fPowerSpectrum[i] - fPowerSpectrum[i - 1]);
+}
+
+const std::vector<float>& sbElectronicNoise::Ring() const {
+    if (fRing && fRing->version == fRingVersion) { return fRing->samples; }
+    if (!fRing) { fRing = new sbNoiseRing(); }
+    fRing->version = fRingVersion;
+
+    // x(n) = sum of A_k cos + B_k sin over the frequencies k / (N timeStep), A_k and B_k
+    // Gaussian with the variance PSD(f_k) df, so the ring has the spectrum and is periodic.
+    const size_t n = fRingLength;
+    const G4double frequencyStep = 1.0 / (n * fTimeStep);
+    sbXoshiroEngine engine(fSeed);
+    CLHEP::RandGaussQ gauss(engine);
+    std::vector<std::complex<G4double>> coefficients(n);
+    for (size_t k = 1; k < n / 2; ++k) {
+        const G4double sigma = std::sqrt(PowerSpectrum(k * frequencyStep) * frequencyStep / megahertz);
+        coefficients[k] = 0.5 * n * std::complex<G4double>(sigma * gauss.fire(), -sigma * gauss.fire());
+        coefficients[n - k] = std::conj(coefficients[k]);
+    }
+    FFT(coefficients, true);
+
+    auto& samples = fRing->samples;
+    samples.resize(n);
+    G4double sumOfSquares = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        samples[i] = coefficients[i].real() / n;
+        sumOfSquares += samples[i] * samples[i];
+    }
+    const G4double rms = std::sqrt(sumOfSquares / n);
+    if (fRMS > 0.0 && rms > 0.0) {
+        for (auto& sample : samples) { sample *= fRMS / rms; }
+    }
+    G4cout << "sbElectronicNoise: ring of " << n << " samples (" << n * fTimeStep / us << " us), rms "
+        << (fRMS > 0.0 ? fRMS : rms) << " SPE peak." << G4endl;
+    return samples;
+}
+
+sbElectronicNoise::sbNoiseRealization sbElectronicNoise::DrawRealization() const {
+    sbNoiseRealization realization;
+    realization.ringOffset = std::floor(G4UniformRand() * fRingLength);
+    realization.baseline = fBaselineSigma > 0.0 ? G4RandGauss::shoot(0.0, fBaselineSigma) : 0.0;
+    realization.wanderPhase = CLHEP::twopi * G4UniformRand();
+    return realization;
+}
+
+void sbElectronicNoise::AddNoise(const sbNoiseRealization& realization, const std::vector<sbWaveformRegion>& regions,
+    std::vector<float>& waveform) const {
+    if (regions.empty() || waveform.empty()) { return; }
+    const auto& ring = Ring();
+    const size_t ringLength = ring.size();
+    // Position in the ring of a time, the same for every waveform of the realization.
+    auto ringPosition = [&](G4double time) {
+        const G4double position = std::fmod(realization.ringOffset + time / fTimeStep, G4double(ringLength));
+        return position < 0.0 ? position + ringLength : position;
+    };
+    for (const auto& region : regions) {
+        const G4double stride = region.timeStep_ns * ns / fTimeStep;
+        const G4double first = ringPosition(region.startTime_ns * ns);
+        float* samples = waveform.data() + region.firstSample;
+        if (std::abs(stride - std::round(stride)) < 1e-6 && std::abs(first - std::round(first)) < 1e-6) {
+            // Sampled on the ring, e.g. the ring step itself: a plain strided add.
+            const size_t step = std::lround(stride) % ringLength;
+            size_t index = size_t(std::llround(first)) % ringLength;
+            for (size_t k = 0; k < region.numOfSamples; ++k) {
+                samples[k] += ring[index];
+                index += step;
+                if (index >= ringLength) { index -= ringLength; }
+            }
+        } else {
+            // Between ring samples, linear interpolation of the band-limited noise.
+            for (size_t k = 0; k < region.numOfSamples; ++k) {
+                const G4double position = std::fmod(first + k * stride, G4double(ringLength));
+                const size_t index = size_t(position);
+                const G4double fraction = position - index;
+                const size_t next = index + 1 == ringLength ? 0 : index + 1;
+                samples[k] += (1.0 - fraction) * ring[index] + fraction * ring[next];
+            }
+        }
+    }
+
+    if (fBaselineSigma > 0.0 || fWanderAmplitude > 0.0) {
+        const G4double angularFrequency = CLHEP::twopi * fWanderFrequency;
+        for (const auto& region : regions) {
+            float* samples = waveform.data() + region.firstSample;
+            for (size_t k = 0; k < region.numOfSamples; ++k) {
+                const G4double time = region.startTime_ns * ns + k * region.timeStep_ns * ns;
+                samples[k] += realization.baseline +
+                    fWanderAmplitude * std::sin(angularFrequency * time + realization.wanderPhase);
+            }
+        }
+    }
+
+    if (fADCLSB > 0.0) {
+        const G4double maxCount = (1 << fADCBits) - 1;
+        for (auto& sample : waveform) {
+            const G4double count = std::min(std::max(std::round(sample / fADCLSB) + fADCPedestal, 0.0), maxCount);
+            sample = (count - fADCPedestal) * fADCLSB;
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include "sbEventAction.hh"
 #include "sbGlobal.hh"
+#include "sbOpticalMapBuilder.hh"
+#include "sbDepositRecorder.hh"
 
 sbEventAction::sbEventAction(sbRunAction* runAction) :
     G4UserEventAction(),
@@ -9,5 +11,14 @@ sbEventAction::~sbEventAction() {}
 
 void sbEventAction::BeginOfEventAction(const G4Event*) {}
 
-void sbEventAction::EndOfEventAction(const G4Event*) {}
+void sbEventAction::EndOfEventAction(const G4Event* event) {
+    const auto& opticalMapBuilder = sbOpticalMapBuilder::GetInstance();
+    if (opticalMapBuilder.IsEnabled()) {
+        opticalMapBuilder.RecordEvent(event);
+    }
+    const auto& depositRecorder = sbDepositRecorder::GetInstance();
+    if (depositRecorder.IsEnabled()) {
+        depositRecorder.EndOfEvent(event);
+    }
+}
 
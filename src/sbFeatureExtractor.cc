@@ -0,0 +1,39 @@
+#include <limits>
+
+#include "G4SystemOfUnits.hh"
+
+#include "sbFeatureExtractor.hh"
+#include "sbSiPMResponseCore.hh"
+#include "sbGlobal.hh"
+
+sbFeatureExtractor& sbFeatureExtractor::GetInstance() {
+    static sbFeatureExtractor instance;
+    return instance;
+}
+
+sbFeatureExtractor::sbFeatureExtractor() :
+    fCFDFraction(gFeatureCFDFraction),
+    fPrescale(gFullRecordPrescale),
+    fSelectedPhotoelectrons(0.0) {}
+
+void sbFeatureExtractor::Extract(const sbSiPMPhotonBuffer& photons, const std::vector<sbPulse>& pulses,
+    const std::vector<sbWaveformRegion>& regions, const std::vector<float>& waveform,
+    sbPulseFeatures& features) const {
+    const G4double noTime = std::numeric_limits<G4double>::quiet_NaN();
+    features.firstPhotonTime = photons.Empty() ? noTime : photons.GetTime(0) / ns;
+    features.numOfPhotoelectrons = 0.0;
+    for (const auto& pulse : pulses) { features.numOfPhotoelectrons += pulse.amplitude; }
+
+    const sbWaveformMeasures measures = sbMeasureWaveform(waveform.data(), regions, fCFDFraction);
+    features.amplitude = measures.amplitude;
+    features.charge = measures.charge;
+    features.CFDTime = measures.CFDTime;
+}
+
+G4bool sbFeatureExtractor::KeepFullRecord(G4int eventID, const sbPulseFeatures& upperFeatures,
+    const sbPulseFeatures& lowerFeatures) const {
+    if (fPrescale > 0 && eventID % fPrescale == 0) { return true; }
+    return fSelectedPhotoelectrons > 0.0 &&
+        upperFeatures.numOfPhotoelectrons >= fSelectedPhotoelectrons &&
+        lowerFeatures.numOfPhotoelectrons >= fSelectedPhotoelectrons;
+}
@@ -0,0 +1,53 @@
+#include "sbFeatureMessenger.hh"
+#include "sbFeatureExtractor.hh"
+#include "sbGlobal.hh"
+
+sbFeatureMessenger::sbFeatureMessenger() :
+    G4UImessenger() {
+    fFeatureDirectory = new G4UIdirectory("/smallbox/features/");
+    fFeatureDirectory->SetGuidance("SiPM pulse features and full record prescale.");
+
+    fCFDFractionCmd = new G4UIcmdWithADouble("/smallbox/features/cfdFraction", this);
+    fCFDFractionCmd->SetGuidance("Constant fraction of the amplitude for the CFD time.");
+    fCFDFractionCmd->SetParameterName("fraction", false);
+    fCFDFractionCmd->SetRange("fraction > 0. && fraction <= 1.");
+    fCFDFractionCmd->SetDefaultValue(gFeatureCFDFraction);
+    fCFDFractionCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fCFDFractionCmd->SetToBeBroadcasted(false);
+
+    fPrescaleCmd = new G4UIcmdWithAnInteger("/smallbox/features/prescale", this);
+    fPrescaleCmd->SetGuidance("Full records (hits, waveform samples, container) of 1 in N events by event ID,");
+    fPrescaleCmd->SetGuidance("1 for all events, 0 for the selected events only. Features are kept for all.");
+    fPrescaleCmd->SetParameterName("N", false);
+    fPrescaleCmd->SetRange("N >= 0");
+    fPrescaleCmd->SetDefaultValue(gFullRecordPrescale);
+    fPrescaleCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fPrescaleCmd->SetToBeBroadcasted(false);
+
+    fSelectCmd = new G4UIcmdWithADouble("/smallbox/features/selectPhotoelectrons", this);
+    fSelectCmd->SetGuidance("Full records also for events with at least this many photoelectrons");
+    fSelectCmd->SetGuidance("in both SiPMs, 0 to select none.");
+    fSelectCmd->SetParameterName("numOfPhotoelectrons", false);
+    fSelectCmd->SetRange("numOfPhotoelectrons >= 0.");
+    fSelectCmd->SetDefaultValue(0.0);
+    fSelectCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fSelectCmd->SetToBeBroadcasted(false);
+}
+
+sbFeatureMessenger::~sbFeatureMessenger() {
+    delete fSelectCmd;
+    delete fPrescaleCmd;
+    delete fCFDFractionCmd;
+    delete fFeatureDirectory;
+}
+
+void sbFeatureMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    auto& featureExtractor = sbFeatureExtractor::GetInstance();
+    if (command == fCFDFractionCmd) {
+        featureExtractor.SetCFDFraction(fCFDFractionCmd->GetNewDoubleValue(newValue));
+    } else if (command == fPrescaleCmd) {
+        featureExtractor.SetPrescale(fPrescaleCmd->GetNewIntValue(newValue));
+    } else if (command == fSelectCmd) {
+        featureExtractor.SetSelectedPhotoelectrons(fSelectCmd->GetNewDoubleValue(newValue));
+    }
+}
@@ -0,0 +1,80 @@
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sbMappedFile.hh"
+
+sbMappedFile::sbMappedFile(const G4String& fileName) :
+    fFileName(fileName),
+    fData(nullptr),
+    fSize(0) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    struct stat fileStatus;
+    if (fd < 0 || fstat(fd, &fileStatus) != 0 || fileStatus.st_size == 0) {
+        if (fd >= 0) { close(fd); }
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot open " + fileName + " or it is empty." << G4endl;
+        G4Exception(
+            "sbMappedFile::sbMappedFile(const G4String& fileName)",
+            "CannotOpenFile",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+    fSize = fileStatus.st_size;
+    void* mapping = mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps its own reference.
+    if (mapping == MAP_FAILED) {
+        fSize = 0;
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot memory-map " + fileName << G4endl;
+        G4Exception(
+            "sbMappedFile::sbMappedFile(const G4String& fileName)",
+            "CannotMapFile",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+    // Readers stream through their part of the file.
+    madvise(mapping, fSize, MADV_SEQUENTIAL);
+    fData = static_cast<const char*>(mapping);
+}
+
+sbMappedFile::~sbMappedFile() {
+    if (fData) {
+        munmap(const_cast<char*>(fData), fSize);
+    }
+}
+
+G4bool sbMappedFile::HasIndexedRecords(size_t offset, uint64_t numOfRecords, size_t recordSize,
+    uint64_t numOfItems, size_t itemSize) const {
+    if (!fData || fSize < offset || fSize - offset < sizeof(uint64_t)) { return false; }
+    const size_t available = fSize - offset - sizeof(uint64_t);
+    const size_t bytesPerRecord = sizeof(uint64_t) + recordSize;
+    if (numOfRecords > available / bytesPerRecord) { return false; }
+    if (numOfItems > (available - numOfRecords * bytesPerRecord) / itemSize) { return false; }
+    const auto index = reinterpret_cast<const uint64_t*>(fData + offset);
+    if (index[numOfRecords] != numOfItems) { return false; }
+    for (uint64_t i = 0; i < numOfRecords; ++i) {
+        if (index[i] > index[i + 1]) { return false; }
+    }
+    return true;
+}
+
+std::shared_ptr<const sbMappedFile> sbMappedFile::MapShared(const G4String& fileName) {
+    static std::mutex mappedFilesMutex;
+    static std::map<G4String, std::weak_ptr<const sbMappedFile>> mappedFiles;
+    std::lock_guard<std::mutex> lock(mappedFilesMutex);
+    auto mappedFile = mappedFiles[fileName].lock();
+    if (!mappedFile) {
+        mappedFile = std::make_shared<const sbMappedFile>(fileName);
+        mappedFiles[fileName] = mappedFile;
+    }
+    return mappedFile;
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+
+#include "Randomize.hh"
+
+#include "sbMuonBatch.hh"
+#include "sbMuonSpectrumTable.hh"
+#include "sbRunAction.hh"
+#include "sbGlobal.hh"
+
+// sin and cos of x (|x| < 2^30), branch-free so that the loop is vectorized.
+// Cody-Waite reduction to [-pi/4, pi/4] and Taylor polynomials, error ~1e-16.
+static void SinCos(const G4double* __restrict x, G4double* __restrict sinx, G4double* __restrict cosx, size_t n) {
+    constexpr G4double roundingShifter = 6755399441055744.0;  // 1.5 * 2^52
+    constexpr G4double twoOverPi = 0.63661977236758134308;
+    constexpr G4double piOver2Hi = 1.57079632673412561417e+00;
+    constexpr G4double piOver2Lo = 6.07710050650619224932e-11;
+    for (size_t i = 0; i < n; ++i) {
+        G4double q = (x[i] * twoOverPi + roundingShifter) - roundingShifter;
+        G4double r = (x[i] - q * piOver2Hi) - q * piOver2Lo;
+        G4double r2 = r * r;
+        G4double s = r + r * r2 * (-1.0 / 6.0 + r2 * (1.0 / 120.0 + r2 * (-1.0 / 5040.0 + r2 * (1.0 / 362880.0
+            + r2 * (-1.0 / 39916800.0 + r2 * (1.0 / 6227020800.0 + r2 * (-1.0 / 1307674368000.0)))))));
+        G4double c = 1.0 + r2 * (-0.5 + r2 * (1.0 / 24.0 + r2 * (-1.0 / 720.0 + r2 * (1.0 / 40320.0
+            + r2 * (-1.0 / 3628800.0 + r2 * (1.0 / 479001600.0 + r2 * (-1.0 / 87178291200.0
+            + r2 * (1.0 / 20922789888000.0))))))));
+        // Quadrant: sin = s, c, -s, -c and cos = c, -s, -c, s.
+        G4int quadrant = static_cast<G4int>(q);
+        G4double odd = static_cast<G4double>(quadrant & 1);
+        G4double sinSign = static_cast<G4double>(1 - (quadrant & 2));
+        G4double cosSign = static_cast<G4double>(1 - ((quadrant + 1) & 2));
+        sinx[i] = sinSign * (odd * c + (1.0 - odd) * s);
+        cosx[i] = cosSign * (odd * s + (1.0 - odd) * c);
+    }
+}
+
+// Branch-free slab test of lines through (x, y, 0) along direction u against an
+// axis-aligned box, the result is or-ed into crossed.
+static void LinesCrossBox(const G4double* __restrict x, const G4double* __restrict y,
+    const G4double* __restrict ux, const G4double* __restrict uy, const G4double* __restrict uz,
+    const G4ThreeVector& boxCentre, const G4double* boxHalfSize, char* __restrict crossed, size_t n) {
+    const G4double xLow = boxCentre.x() - boxHalfSize[0], xHigh = boxCentre.x() + boxHalfSize[0];
+    const G4double yLow = boxCentre.y() - boxHalfSize[1], yHigh = boxCentre.y() + boxHalfSize[1];
+    const G4double zLow = boxCentre.z() - boxHalfSize[2], zHigh = boxCentre.z() + boxHalfSize[2];
+    for (size_t i = 0; i < n; ++i) {
+        // Division by zero gives +-inf, which the min/max below handle correctly.
+        G4double inverseUx = 1.0 / ux[i];
+        G4double inverseUy = 1.0 / uy[i];
+        G4double inverseUz = 1.0 / uz[i];
+        G4double sx1 = (xLow - x[i]) * inverseUx, sx2 = (xHigh - x[i]) * inverseUx;
+        G4double sy1 = (yLow - y[i]) * inverseUy, sy2 = (yHigh - y[i]) * inverseUy;
+        G4double sz1 = zLow * inverseUz, sz2 = zHigh * inverseUz;
+        G4double sMin = std::max(std::max(std::min(sx1, sx2), std::min(sy1, sy2)), std::min(sz1, sz2));
+        G4double sMax = std::min(std::min(std::max(sx1, sx2), std::max(sy1, sy2)), std::max(sz1, sz2));
+        crossed[i] |= static_cast<char>(sMin <= sMax);
+    }
+}
+
+sbMuonBatch::sbMuonBatch(sbRunAction* runAction) :
+    fRunAction(runAction),
+    fSize(0),
+    fNext(0),
+    fEnergy(gMuonBatchSize),
+    fPositionX(gMuonBatchSize),
+    fPositionY(gMuonBatchSize),
+    fPositionZ(gMuonBatchSize),
+    fDirectionX(gMuonBatchSize),
+    fDirectionY(gMuonBatchSize),
+    fDirectionZ(gMuonBatchSize),
+    fIsMuonPlus(gMuonBatchSize),
+    fWeight(gMuonBatchSize),
+    fRandom(4 * gMuonBatchSize),
+    fThetaBin(gMuonBatchSize),
+    fTheta(gMuonBatchSize),
+    fSinTheta(gMuonBatchSize),
+    fCosTheta(gMuonBatchSize),
+    fPhi(gMuonBatchSize),
+    fSinPhi(gMuonBatchSize),
+    fCosPhi(gMuonBatchSize),
+    fAccepted(gMuonBatchSize) {}
+
+void sbMuonBatch::Pop(G4double& energy, G4ThreeVector& position, G4ThreeVector& direction, G4bool& isMuonPlus,
+    G4double& weight) {
+    while (fNext == fSize) { Refill(); }
+    energy = fEnergy[fNext];
+    position.set(fPositionX[fNext], fPositionY[fNext], fPositionZ[fNext]);
+    direction.set(fDirectionX[fNext], fDirectionY[fNext], fDirectionZ[fNext]);
+    isMuonPlus = fIsMuonPlus[fNext];
+    weight = fWeight[fNext];
+    ++fNext;
+}
+
+void sbMuonBatch::Refill() {
+    constexpr size_t n = gMuonBatchSize;
+    const auto& spectrumTable = sbMuonSpectrumTable::GetInstance();
+    auto engine = G4Random::getTheEngine();
+
+    // Theta, phi, sphere centre x and y.
+    engine->flatArray(static_cast<G4int>(4 * n), fRandom.data());
+    const G4double* uTheta = fRandom.data();
+    const G4double* uPhi = uTheta + n;
+    const G4double* uCentreX = uPhi + n;
+    const G4double* uCentreY = uCentreX + n;
+
+    for (size_t i = 0; i < n; ++i) {
+        fThetaBin[i] = spectrumTable.SampleTheta(uTheta[i], fTheta[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        fPhi[i] = 2.0 * M_PI * uPhi[i];
+    }
+    SinCos(fTheta.data(), fSinTheta.data(), fCosTheta.data(), n);
+    SinCos(fPhi.data(), fSinPhi.data(), fCosPhi.data(), n);
+
+    // Unit vector from sphere centre to the start point (stored in fDirection for now)
+    // and sphere centre (stored in fPosition for now).
+    for (size_t i = 0; i < n; ++i) {
+        fDirectionX[i] = fSinTheta[i] * fCosPhi[i];
+        fDirectionY[i] = fSinTheta[i] * fSinPhi[i];
+        fDirectionZ[i] = fCosTheta[i];
+        fPositionX[i] = (2.0 * uCentreX[i] - 1.0) * gEffectiveRange;
+        fPositionY[i] = (2.0 * uCentreY[i] - 1.0) * gEffectiveRange;
+    }
+
+#if SB_ACCEPTANCE_AWARE_MUON_GENERATION
+    std::fill(fAccepted.begin(), fAccepted.end(), 0);
+    LinesCrossBox(fPositionX.data(), fPositionY.data(), fDirectionX.data(), fDirectionY.data(), fDirectionZ.data(),
+        gScintillatorsPosition.first, gScintillatorHalfSize, fAccepted.data(), n);
+    LinesCrossBox(fPositionX.data(), fPositionY.data(), fDirectionX.data(), fDirectionY.data(), fDirectionZ.data(),
+        gScintillatorsPosition.second, gScintillatorHalfSize, fAccepted.data(), n);
+#else
+    std::fill(fAccepted.begin(), fAccepted.end(), 1);
+#endif
+
+    // Compact accepted candidates to the front.
+    size_t numOfAccepted = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!fAccepted[i]) { continue; }
+        fThetaBin[numOfAccepted] = fThetaBin[i];
+        fTheta[numOfAccepted] = fTheta[i];
+        fDirectionX[numOfAccepted] = fDirectionX[i];
+        fDirectionY[numOfAccepted] = fDirectionY[i];
+        fDirectionZ[numOfAccepted] = fDirectionZ[i];
+        fPositionX[numOfAccepted] = fPositionX[i];
+        fPositionY[numOfAccepted] = fPositionY[i];
+        ++numOfAccepted;
+    }
+
+    // Energy and charge, only for accepted candidates.
+    engine->flatArray(static_cast<G4int>(2 * numOfAccepted), fRandom.data());
+    const G4double* uEnergy = fRandom.data();
+    const G4double* uCharge = uEnergy + numOfAccepted;
+    for (size_t i = 0; i < numOfAccepted; ++i) {
+        fEnergy[i] = spectrumTable.SampleEnergy(fThetaBin[i], uEnergy[i]);
+    }
+    for (size_t i = 0; i < numOfAccepted; ++i) {
+        fWeight[i] = spectrumTable.Weight(fEnergy[i], fTheta[i]);
+    }
+    for (size_t i = 0; i < numOfAccepted; ++i) {
+        fPositionX[i] += fDirectionX[i] * gSphereRadius;
+        fPositionY[i] += fDirectionY[i] * gSphereRadius;
+        fPositionZ[i] = fDirectionZ[i] * gSphereRadius;
+        fDirectionX[i] = -fDirectionX[i];
+        fDirectionY[i] = -fDirectionY[i];
+        fDirectionZ[i] = -fDirectionZ[i];
+        fIsMuonPlus[i] = static_cast<char>(uCharge[i] <= 0.563319);
+    }
+#if SB_ACCEPTANCE_AWARE_MUON_GENERATION
+    G4double sumOfWeights = 0.0;
+    for (size_t i = 0; i < numOfAccepted; ++i) { sumOfWeights += fWeight[i]; }
+    fRunAction->CountMuonCandidates(static_cast<G4int>(n), static_cast<G4int>(numOfAccepted), sumOfWeights);
+#endif
+
+    fSize = numOfAccepted;
+    fNext = 0;
+}
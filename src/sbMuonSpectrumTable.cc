@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cmath>
+
+#include "sbMuonSpectrumTable.hh"
+#include "sbPrimaryGeneratorAction.hh"
+#include "sbGlobal.hh"
+#include "sbConfigs.hh"
+
+const sbMuonSpectrumTable& sbMuonSpectrumTable::GetInstance() {
+    // Thread-safe initialization, the first caller builds the table.
+    static const sbMuonSpectrumTable instance;
+    return instance;
+}
+
+sbMuonSpectrumTable::sbMuonSpectrumTable() :
+    fThetaCDF(fNumOfThetaBins + 1, 0.0),
+    fEnergyEdges(fNumOfEnergyBins + 1, 0.0),
+    fSpectrumAtEdges(fNumOfThetaBins * (fNumOfEnergyBins + 1), 0.0),
+    fEnergyCDF(fNumOfThetaBins * (fNumOfEnergyBins + 1), 0.0),
+    fIntegral(0.0),
+    fWeightNormalization(1.0) {
+    // Energy bin edges, log-spaced since the spectrum falls steeply.
+    const G4double logMinE = log(gMinE_GeV);
+    const G4double logEnergyStep = (log(gMaxE_GeV) - logMinE) / fNumOfEnergyBins;
+    for (G4int i = 0; i <= fNumOfEnergyBins; ++i) {
+        fEnergyEdges[i] = exp(logMinE + i * logEnergyStep);
+    }
+    fEnergyEdges.back() = gMaxE_GeV;
+
+    // Conditional CDFs in energy of the (biased) spectrum, evaluated at theta bin centres.
+    const G4double thetaStep = M_PI_2 / fNumOfThetaBins;
+    G4double unbiasedIntegral = 0.0;
+    for (G4int j = 0; j < fNumOfThetaBins; ++j) {
+        const G4double theta = (j + 0.5) * thetaStep;
+        G4double* spectrum = &fSpectrumAtEdges[j * (fNumOfEnergyBins + 1)];
+        G4double* cdf = &fEnergyCDF[j * (fNumOfEnergyBins + 1)];
+        G4double previousUnbiasedSpectrum = 0.0;
+        for (G4int i = 0; i <= fNumOfEnergyBins; ++i) {
+            G4double unbiasedSpectrum = sbPrimaryGeneratorAction::EnergySpectrum(fEnergyEdges[i], theta);
+            spectrum[i] = unbiasedSpectrum * sbPrimaryGeneratorAction::BiasingFunction(fEnergyEdges[i], theta);
+            if (i > 0) {
+                unbiasedIntegral += 0.5 * (previousUnbiasedSpectrum + unbiasedSpectrum) *
+                    (fEnergyEdges[i] - fEnergyEdges[i - 1]) * thetaStep;
+            }
+            previousUnbiasedSpectrum = unbiasedSpectrum;
+        }
+        // Trapezoid rule, consistent with the linear interpolation in SampleEnergy().
+        for (G4int i = 0; i < fNumOfEnergyBins; ++i) {
+            cdf[i + 1] = cdf[i] + 0.5 * (spectrum[i] + spectrum[i + 1]) * (fEnergyEdges[i + 1] - fEnergyEdges[i]);
+        }
+        const G4double thetaBinIntegral = cdf[fNumOfEnergyBins];
+        if (thetaBinIntegral > 0.0) {
+            for (G4int i = 1; i <= fNumOfEnergyBins; ++i) { cdf[i] /= thetaBinIntegral; }
+        } else {  // Never sampled since the marginal probability is zero, keep it sane anyway.
+            for (G4int i = 1; i <= fNumOfEnergyBins; ++i) { cdf[i] = G4double(i) / fNumOfEnergyBins; }
+        }
+        fThetaCDF[j + 1] = fThetaCDF[j] + thetaBinIntegral * thetaStep;
+    }
+
+    // Marginal CDF in theta.
+    fIntegral = fThetaCDF.back();
+    for (auto& cdf : fThetaCDF) { cdf /= fIntegral; }
+    fWeightNormalization = fIntegral / unbiasedIntegral;
+
+    G4cout << "sbMuonSpectrumTable: " << fNumOfThetaBins << " x " << fNumOfEnergyBins
+        << " (theta x energy) table built, spectrum integral = " << unbiasedIntegral << G4endl;
+#if SB_ENABLE_MUON_SPECTRUM_BIASING
+    G4cout << "sbMuonSpectrumTable: sampling the biased spectrum, muons carry weights." << G4endl;
+#endif
+
+#if SB_CHECK_MUON_SPECTRUM_TABLE
+    CheckAgainstRejectionSampling(gMuonSpectrumTableCheckSamples);
+#endif
+}
+
+G4double sbMuonSpectrumTable::Weight(G4double energy, G4double theta) const {
+#if SB_ENABLE_MUON_SPECTRUM_BIASING
+    // Ratio of the normalized spectrum to the normalized biased spectrum.
+    return fWeightNormalization / sbPrimaryGeneratorAction::BiasingFunction(energy / GeV, theta);
+#else
+    (void)energy;
+    (void)theta;
+    return 1.0;
+#endif
+}
+
+G4int sbMuonSpectrumTable::SampleTheta(G4double u, G4double& theta) const {
+    // First CDF value greater than u is the upper edge of the bin.
+    auto upperEdge = std::upper_bound(fThetaCDF.begin() + 1, fThetaCDF.end() - 1, u);
+    G4int bin = upperEdge - fThetaCDF.begin() - 1;
+    // Reuse the remaining fraction of u inside the bin, theta is uniform in a bin.
+    G4double fraction = (u - fThetaCDF[bin]) / (fThetaCDF[bin + 1] - fThetaCDF[bin]);
+    theta = (bin + fraction) * (M_PI_2 / fNumOfThetaBins);
+    return bin;
+}
+
+G4double sbMuonSpectrumTable::SampleEnergy(G4int thetaBin, G4double u) const {
+    const G4double* cdf = &fEnergyCDF[thetaBin * (fNumOfEnergyBins + 1)];
+    const G4double* spectrum = &fSpectrumAtEdges[thetaBin * (fNumOfEnergyBins + 1)];
+    const G4double* upperEdge = std::upper_bound(cdf + 1, cdf + fNumOfEnergyBins, u);
+    G4int bin = upperEdge - cdf - 1;
+    G4double r = (u - cdf[bin]) / (cdf[bin + 1] - cdf[bin]);
+    // Invert the CDF of the linear density between the two bin edges:
+    // x = r(f0 + f1) / (f0 + sqrt(f0^2 + r(f1^2 - f0^2))), stable also for f0 == f1.
+    G4double f0 = spectrum[bin];
+    G4double f1 = spectrum[bin + 1];
+    G4double denominator = f0 + sqrt(f0 * f0 + r * (f1 * f1 - f0 * f0));
+    G4double fraction = denominator > 0.0 ? r * (f0 + f1) / denominator : r;
+    return (fEnergyEdges[bin] + fraction * (fEnergyEdges[bin + 1] - fEnergyEdges[bin])) * GeV;
+}
+
+void sbMuonSpectrumTable::CheckAgainstRejectionSampling(G4int numOfSamples) const {
+    // log10(E/GeV) in [-1, 3.4), 10 bins per decade; theta in [0, pi/2), 30 bins.
+    constexpr G4int numOfCheckEnergyBins = 44;
+    constexpr G4int numOfCheckThetaBins = 30;
+    auto energyBin = [](G4double energy) {
+        G4int bin = static_cast<G4int>(floor((log10(energy / GeV) + 1.0) * 10.0));
+        return std::min(std::max(bin, 0), numOfCheckEnergyBins - 1);
+    };
+    auto thetaBin = [](G4double theta) {
+        G4int bin = static_cast<G4int>(theta / M_PI_2 * numOfCheckThetaBins);
+        return std::min(std::max(bin, 0), numOfCheckThetaBins - 1);
+    };
+
+    // Sum of weights and sum of squared weights of the table samples (weight is 1
+    // without biasing), counts of the rejection samples.
+    std::vector<G4double> tableEnergyHist(numOfCheckEnergyBins, 0.0), tableEnergyHistW2(numOfCheckEnergyBins, 0.0);
+    std::vector<G4double> tableThetaHist(numOfCheckThetaBins, 0.0), tableThetaHistW2(numOfCheckThetaBins, 0.0);
+    std::vector<G4double> rejectionEnergyHist(numOfCheckEnergyBins, 0.0);
+    std::vector<G4double> rejectionThetaHist(numOfCheckThetaBins, 0.0);
+    G4double energy, theta;
+    for (G4int i = 0; i < numOfSamples; ++i) {
+        Sample(energy, theta);
+        G4double weight = Weight(energy, theta);
+        tableEnergyHist[energyBin(energy)] += weight;
+        tableEnergyHistW2[energyBin(energy)] += weight * weight;
+        tableThetaHist[thetaBin(theta)] += weight;
+        tableThetaHistW2[thetaBin(theta)] += weight * weight;
+        sbPrimaryGeneratorAction::FindEnergyAndTheta(energy, theta);
+        rejectionEnergyHist[energyBin(energy)] += 1.0;
+        rejectionThetaHist[thetaBin(theta)] += 1.0;
+    }
+
+    // Two-sample chi-square with equal sample sizes, sum of (a - b)^2 / (var(a) + b).
+    auto chiSquare = [](const std::vector<G4double>& a, const std::vector<G4double>& aW2,
+        const std::vector<G4double>& b, G4int& ndf) {
+        G4double chi2 = 0.0;
+        ndf = -1;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (aW2[i] + b[i] == 0.0) { continue; }
+            chi2 += (a[i] - b[i]) * (a[i] - b[i]) / (aW2[i] + b[i]);
+            ++ndf;
+        }
+        return chi2;
+    };
+    G4int energyNDF, thetaNDF;
+    G4double energyChi2 = chiSquare(tableEnergyHist, tableEnergyHistW2, rejectionEnergyHist, energyNDF);
+    G4double thetaChi2 = chiSquare(tableThetaHist, tableThetaHistW2, rejectionThetaHist, thetaNDF);
+    G4cout << "sbMuonSpectrumTable: compared with rejection sampling, " << numOfSamples << " samples each:\n"
+        << "    energy chi2/ndf = " << energyChi2 << '/' << energyNDF << '\n'
+        << "    theta  chi2/ndf = " << thetaChi2 << '/' << thetaNDF << G4endl;
+
+    // Flag deviations beyond 5 sigma of the chi-square distribution.
+    auto deviates = [](G4double chi2, G4int ndf) { return ndf > 0 && chi2 - ndf > 5.0 * sqrt(2.0 * ndf); };
+    if (deviates(energyChi2, energyNDF) || deviates(thetaChi2, thetaNDF)) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Spectrum table deviates from the rejection sampler." << G4endl;
+        exceptout << "Maybe the table range or binning is too coarse?" << G4endl;
+        G4Exception(
+            "sbMuonSpectrumTable::CheckAgainstRejectionSampling(G4int numOfSamples)",
+            "SpectrumTableMismatch",
+            JustWarning,
+            exceptout
+        );
+    }
+}
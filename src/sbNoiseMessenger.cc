@@ -0,0 +1,154 @@
+#include "G4SystemOfUnits.hh"
+
+#include "sbNoiseMessenger.hh"
+#include "sbElectronicNoise.hh"
+#include "sbGlobal.hh"
+
+sbNoiseMessenger::sbNoiseMessenger() :
+    G4UImessenger() {
+    fNoiseDirectory = new G4UIdirectory("/smallbox/noise/");
+    fNoiseDirectory->SetGuidance("Electronic noise, baseline and ADC of the SiPM waveforms.");
+
+    fEnableCmd = new G4UIcmdWithABool("/smallbox/noise/enable", this);
+    fEnableCmd->SetGuidance("Add readout noise to the waveforms, clean waveforms by default.");
+    fEnableCmd->SetParameterName("enable", true);
+    fEnableCmd->SetDefaultValue(true);
+    fEnableCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fEnableCmd->SetToBeBroadcasted(false);
+
+    fSpectrumFileCmd = new G4UIcmdWithAString("/smallbox/noise/spectrumFile", this);
+    fSpectrumFileCmd->SetGuidance("csv file of the noise power spectrum, NOISE_frequency in MHz and");
+    fSpectrumFileCmd->SetGuidance("NOISE_PSD in SPE peak^2 / MHz (one-sided).");
+    fSpectrumFileCmd->SetParameterName("fileName", false);
+    fSpectrumFileCmd->SetDefaultValue(gSiPMPropertiesFileName);
+    fSpectrumFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fSpectrumFileCmd->SetToBeBroadcasted(false);
+
+    fRMSCmd = new G4UIcmdWithADouble("/smallbox/noise/rms", this);
+    fRMSCmd->SetGuidance("Noise rms in single photoelectron peaks, the spectrum shape is kept.");
+    fRMSCmd->SetGuidance("0 for the rms of the spectrum.");
+    fRMSCmd->SetParameterName("rms", false);
+    fRMSCmd->SetRange("rms >= 0.");
+    fRMSCmd->SetDefaultValue(0.0);
+    fRMSCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fRMSCmd->SetToBeBroadcasted(false);
+
+    fTimeStepCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/noise/timeStep", this);
+    fTimeStepCmd->SetGuidance("Time step of the noise ring, waveforms at other steps interpolate it.");
+    fTimeStepCmd->SetParameterName("timeStep", false);
+    fTimeStepCmd->SetRange("timeStep > 0.");
+    fTimeStepCmd->SetDefaultValue(gNoiseTimeStep / ns);
+    fTimeStepCmd->SetDefaultUnit("ns");
+    fTimeStepCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fTimeStepCmd->SetToBeBroadcasted(false);
+
+    fRingLengthCmd = new G4UIcmdWithAnInteger("/smallbox/noise/ringLength", this);
+    fRingLengthCmd->SetGuidance("Samples of the noise ring of every thread, a power of two.");
+    fRingLengthCmd->SetParameterName("ringLength", false);
+    fRingLengthCmd->SetRange("ringLength >= 2");
+    fRingLengthCmd->SetDefaultValue(gNoiseRingLength);
+    fRingLengthCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fRingLengthCmd->SetToBeBroadcasted(false);
+
+    fSeedCmd = new G4UIcmdWithAnInteger("/smallbox/noise/seed", this);
+    fSeedCmd->SetGuidance("Seed of the noise ring, the same ring in all threads.");
+    fSeedCmd->SetParameterName("seed", false);
+    fSeedCmd->SetDefaultValue(0);
+    fSeedCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fSeedCmd->SetToBeBroadcasted(false);
+
+    fBaselineSigmaCmd = new G4UIcmdWithADouble("/smallbox/noise/baselineSigma", this);
+    fBaselineSigmaCmd->SetGuidance("Sigma of the baseline offset per SiPM and event, in single photoelectron peaks.");
+    fBaselineSigmaCmd->SetParameterName("sigma", false);
+    fBaselineSigmaCmd->SetRange("sigma >= 0.");
+    fBaselineSigmaCmd->SetDefaultValue(0.0);
+    fBaselineSigmaCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fBaselineSigmaCmd->SetToBeBroadcasted(false);
+
+    fWanderAmplitudeCmd = new G4UIcmdWithADouble("/smallbox/noise/wanderAmplitude", this);
+    fWanderAmplitudeCmd->SetGuidance("Amplitude of the sinusoidal baseline wander, in single photoelectron peaks.");
+    fWanderAmplitudeCmd->SetParameterName("amplitude", false);
+    fWanderAmplitudeCmd->SetRange("amplitude >= 0.");
+    fWanderAmplitudeCmd->SetDefaultValue(0.0);
+    fWanderAmplitudeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fWanderAmplitudeCmd->SetToBeBroadcasted(false);
+
+    fWanderFrequencyCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/noise/wanderFrequency", this);
+    fWanderFrequencyCmd->SetGuidance("Frequency of the baseline wander, random phase per SiPM and event.");
+    fWanderFrequencyCmd->SetParameterName("frequency", false);
+    fWanderFrequencyCmd->SetRange("frequency >= 0.");
+    fWanderFrequencyCmd->SetDefaultValue(gNoiseWanderFrequency / megahertz);
+    fWanderFrequencyCmd->SetDefaultUnit("MHz");
+    fWanderFrequencyCmd->SetUnitCategory("Frequency");
+    fWanderFrequencyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fWanderFrequencyCmd->SetToBeBroadcasted(false);
+
+    fADCLSBCmd = new G4UIcmdWithADouble("/smallbox/noise/adcLSB", this);
+    fADCLSBCmd->SetGuidance("ADC least significant bit in single photoelectron peaks, 0 for no ADC.");
+    fADCLSBCmd->SetParameterName("LSB", false);
+    fADCLSBCmd->SetRange("LSB >= 0.");
+    fADCLSBCmd->SetDefaultValue(0.0);
+    fADCLSBCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fADCLSBCmd->SetToBeBroadcasted(false);
+
+    fADCBitsCmd = new G4UIcmdWithAnInteger("/smallbox/noise/adcBits", this);
+    fADCBitsCmd->SetGuidance("ADC resolution, samples are clipped to 0 to 2^bits - 1 counts.");
+    fADCBitsCmd->SetParameterName("bits", false);
+    fADCBitsCmd->SetRange("bits >= 1 && bits <= 24");
+    fADCBitsCmd->SetDefaultValue(gADCBits);
+    fADCBitsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fADCBitsCmd->SetToBeBroadcasted(false);
+
+    fADCPedestalCmd = new G4UIcmdWithAnInteger("/smallbox/noise/adcPedestal", this);
+    fADCPedestalCmd->SetGuidance("ADC counts of the zero baseline.");
+    fADCPedestalCmd->SetParameterName("pedestal", false);
+    fADCPedestalCmd->SetRange("pedestal >= 0");
+    fADCPedestalCmd->SetDefaultValue(gADCPedestal);
+    fADCPedestalCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fADCPedestalCmd->SetToBeBroadcasted(false);
+}
+
+sbNoiseMessenger::~sbNoiseMessenger() {
+    delete fADCPedestalCmd;
+    delete fADCBitsCmd;
+    delete fADCLSBCmd;
+    delete fWanderFrequencyCmd;
+    delete fWanderAmplitudeCmd;
+    delete fBaselineSigmaCmd;
+    delete fSeedCmd;
+    delete fRingLengthCmd;
+    delete fTimeStepCmd;
+    delete fRMSCmd;
+    delete fSpectrumFileCmd;
+    delete fEnableCmd;
+    delete fNoiseDirectory;
+}
+
+void sbNoiseMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    auto& electronicNoise = sbElectronicNoise::GetInstance();
+    if (command == fEnableCmd) {
+        electronicNoise.SetEnabled(fEnableCmd->GetNewBoolValue(newValue));
+    } else if (command == fSpectrumFileCmd) {
+        electronicNoise.SetSpectrumFileName(newValue);
+    } else if (command == fRMSCmd) {
+        electronicNoise.SetRMS(fRMSCmd->GetNewDoubleValue(newValue));
+    } else if (command == fTimeStepCmd) {
+        electronicNoise.SetTimeStep(fTimeStepCmd->GetNewDoubleValue(newValue));
+    } else if (command == fRingLengthCmd) {
+        electronicNoise.SetRingLength(fRingLengthCmd->GetNewIntValue(newValue));
+    } else if (command == fSeedCmd) {
+        electronicNoise.SetSeed(fSeedCmd->GetNewIntValue(newValue));
+    } else if (command == fBaselineSigmaCmd) {
+        electronicNoise.SetBaselineSigma(fBaselineSigmaCmd->GetNewDoubleValue(newValue));
+    } else if (command == fWanderAmplitudeCmd) {
+        electronicNoise.SetWanderAmplitude(fWanderAmplitudeCmd->GetNewDoubleValue(newValue));
+    } else if (command == fWanderFrequencyCmd) {
+        electronicNoise.SetWanderFrequency(fWanderFrequencyCmd->GetNewDoubleValue(newValue));
+    } else if (command == fADCLSBCmd) {
+        electronicNoise.SetADCLSB(fADCLSBCmd->GetNewDoubleValue(newValue));
+    } else if (command == fADCBitsCmd) {
+        electronicNoise.SetADCBits(fADCBitsCmd->GetNewIntValue(newValue));
+    } else if (command == fADCPedestalCmd) {
+        electronicNoise.SetADCPedestal(fADCPedestalCmd->GetNewIntValue(newValue));
+    }
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4Material.hh"
+#include "G4SDManager.hh"
+#include "G4RunManager.hh"
+#include "Randomize.hh"
+
+#include "sbOpticalMapBuilder.hh"
+#include "sbOpticalResponseMap.hh"
+#include "sbSiPMSD.hh"
+#include "sbGlobal.hh"
+#include "sbConfigs.hh"
+
+// FNV-1a, 64 bit.
+static void HashBytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+}
+
+static constexpr G4int gEntrySize = 1 + gOpticalMapQuantiles;
+
+static off_t EntryOffset(G4int globalVoxel, G4int SiPMID) {
+    return sizeof(sbOpticalResponseMapHeader) + (off_t(globalVoxel) * 2 + SiPMID) * gEntrySize * sizeof(float);
+}
+
+sbOpticalMapBuilder& sbOpticalMapBuilder::GetInstance() {
+    static sbOpticalMapBuilder instance;
+    return instance;
+}
+
+sbOpticalMapBuilder::sbOpticalMapBuilder() :
+    fEnabled(false),
+    fPhotonsPerVoxel(gOpticalMapPhotonsPerVoxel),
+    fPartialFile(-1),
+    fKey(0),
+    fPendingVoxels(),
+    fSpectrum() {}
+
+sbOpticalMapBuilder::~sbOpticalMapBuilder() {
+    if (fPartialFile >= 0) { close(fPartialFile); }
+}
+
+void sbOpticalMapBuilder::SetEnabled(G4bool enabled) {
+#if SB_ENABLE_OPTICAL_PHYSICS && SB_PROCESS_SIPM_HIT
+    fEnabled = enabled;
+#else
+    if (enabled) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Building the optical response map requires SB_ENABLE_OPTICAL_PHYSICS and SB_PROCESS_SIPM_HIT."
+            << G4endl;
+        G4Exception(
+            "sbOpticalMapBuilder::SetEnabled(G4bool enabled)",
+            "OpticalPhysicsDisabled",
+            JustWarning,
+            exceptout
+        );
+    }
+#endif
+}
+
+G4int sbOpticalMapBuilder::NumOfVoxels() {
+    return gOpticalMapBins[0] * gOpticalMapBins[1] * gOpticalMapBins[2];
+}
+
+uint64_t sbOpticalMapBuilder::ComputeKey() {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const G4double geometry[] = {
+        gScintillatorHalfSize[0], gScintillatorHalfSize[1], gScintillatorHalfSize[2], gScintillatorDistance,
+        gAlFoilThickness, gAlFoilHoleHalfWidth, gAlFoilScintillatorGap,
+        gSiPMHalfSize[0], gSiPMHalfSize[1], gSiPMHalfSize[2], gSiPMScintillatorGap,
+        gLightGuideHalfWidth, gLightGuideThickness,
+        gPCBHalfSize[0], gPCBHalfSize[1], gPCBHalfSize[2]
+    };
+    HashBytes(hash, geometry, sizeof(geometry));
+    const G4int settings[] = {
+        gOpticalMapBins[0], gOpticalMapBins[1], gOpticalMapBins[2], gOpticalMapQuantiles,
+        SB_ENABLE_AL_FOIL_REFLECTION, SB_KILL_SCINTILLATION_PHOTON, SB_SIPM_SURFACE_DETECTION
+    };
+    HashBytes(hash, settings, sizeof(settings));
+    const G4String materialNames = gWorldMaterialName + gScintillatorMaterialName + gAlFoilMaterialName +
+        gSiPMMaterialName + gLightGuideMaterialName + gPCBMaterialName;
+    HashBytes(hash, materialNames.data(), materialNames.size());
+
+    for (const auto& csvFileName : { gScintillatorPropertiesFileName, gSiPMPropertiesFileName }) {
+        std::ifstream csv(csvFileName, std::ios::binary);
+        std::vector<char> csvBytes((std::istreambuf_iterator<char>(csv)), std::istreambuf_iterator<char>());
+        HashBytes(hash, csvBytes.data(), csvBytes.size());
+    }
+    return hash;
+}
+
+void sbOpticalMapBuilder::BeginOfRun() {
+    fKey = ComputeKey();
+    fPendingVoxels.clear();
+    const G4int numOfGlobalVoxels = 2 * NumOfVoxels();
+
+    // Nothing to do if the map is up to date.
+    sbOpticalResponseMapHeader header;
+    std::ifstream map(gOpticalResponseMapFileName, std::ios::binary);
+    if (map.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        std::memcmp(header.magic, "SBOPTMAP", 8) == 0 && header.key == fKey) {
+        G4cout << "sbOpticalMapBuilder: " << gOpticalResponseMapFileName << " is up to date." << G4endl;
+        return;
+    }
+
+    // Resume from the partial map if it is made for the same key, otherwise start over.
+    const G4String partialFileName = gOpticalResponseMapFileName + ".partial";
+    const off_t doneOffset = EntryOffset(numOfGlobalVoxels, 0);
+    const off_t partialFileSize = doneOffset + numOfGlobalVoxels;
+    fPartialFile = open(partialFileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fPartialFile < 0) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot open " + partialFileName << G4endl;
+        G4Exception(
+            "sbOpticalMapBuilder::BeginOfRun()",
+            "CannotOpenFile",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+    G4bool resumed = pread(fPartialFile, &header, sizeof(header), 0) == ssize_t(sizeof(header)) &&
+        std::memcmp(header.magic, "SBOPTMAP", 8) == 0 && header.key == fKey &&
+        lseek(fPartialFile, 0, SEEK_END) == partialFileSize;
+    if (!resumed) {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "SBOPTMAP", 8);
+        header.version = 1;
+        header.numOfQuantiles = gOpticalMapQuantiles;
+        for (G4int i = 0; i < 3; ++i) { header.numOfBins[i] = gOpticalMapBins[i]; }
+        header.key = fKey;
+        // Zeros, all voxels pending.
+        if (ftruncate(fPartialFile, 0) != 0 || ftruncate(fPartialFile, partialFileSize) != 0 ||
+            pwrite(fPartialFile, &header, sizeof(header), 0) != ssize_t(sizeof(header))) {
+            G4ExceptionDescription exceptout;
+            exceptout << "Cannot write " + partialFileName << G4endl;
+            G4Exception(
+                "sbOpticalMapBuilder::BeginOfRun()",
+                "CannotWriteFile",
+                FatalException,
+                exceptout
+            );
+            return;
+        }
+    }
+    std::vector<char> done(numOfGlobalVoxels, 0);
+    if (pread(fPartialFile, done.data(), numOfGlobalVoxels, doneOffset) != numOfGlobalVoxels) {
+        std::fill(done.begin(), done.end(), 0);
+    }
+    for (G4int i = 0; i < numOfGlobalVoxels; ++i) {
+        if (!done[i]) { fPendingVoxels.push_back(i); }
+    }
+
+    if (!fSpectrum.Build(G4Material::GetMaterial(gScintillatorMaterialName))) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot sample scintillation photons without optical properties." << G4endl;
+        G4Exception(
+            "sbOpticalMapBuilder::BeginOfRun()",
+            "NoOpticalProperties",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+
+    G4cout << "sbOpticalMapBuilder: " << (resumed ? "resuming " : "starting ") << partialFileName << ", "
+        << fPendingVoxels.size() << " of " << numOfGlobalVoxels << " voxels pending, "
+        << fPhotonsPerVoxel << " photons each (one event per voxel)." << G4endl;
+}
+
+void sbOpticalMapBuilder::EndOfRun() {
+    if (fPartialFile < 0) { return; }
+    const G4int numOfGlobalVoxels = 2 * NumOfVoxels();
+    std::vector<char> done(numOfGlobalVoxels, 0);
+    if (pread(fPartialFile, done.data(), numOfGlobalVoxels, EntryOffset(numOfGlobalVoxels, 0)) != numOfGlobalVoxels) {
+        std::fill(done.begin(), done.end(), 0);
+    }
+    G4int numOfPending = std::count(done.begin(), done.end(), 0);
+    if (numOfPending == 0) {
+        Finalize();
+    } else {
+        fsync(fPartialFile);
+        close(fPartialFile);
+        fPartialFile = -1;
+        G4cout << "sbOpticalMapBuilder: " << numOfPending << " voxels pending, run again to resume." << G4endl;
+    }
+}
+
+void sbOpticalMapBuilder::Finalize() {
+    // Drop the done flags and replace the map.
+    const G4String partialFileName = gOpticalResponseMapFileName + ".partial";
+    G4bool succeeded = ftruncate(fPartialFile, EntryOffset(2 * NumOfVoxels(), 0)) == 0 &&
+        fsync(fPartialFile) == 0;
+    close(fPartialFile);
+    fPartialFile = -1;
+    succeeded = succeeded && std::rename(partialFileName.c_str(), gOpticalResponseMapFileName.c_str()) == 0;
+    if (!succeeded) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot replace " + gOpticalResponseMapFileName + " by " + partialFileName << G4endl;
+        G4Exception(
+            "sbOpticalMapBuilder::Finalize()",
+            "CannotWriteFile",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    G4cout << "sbOpticalMapBuilder: " << gOpticalResponseMapFileName << " is built." << G4endl;
+}
+
+void sbOpticalMapBuilder::GeneratePrimaries(G4Event* event) const {
+    const G4int eventID = event->GetEventID();
+    if (eventID >= static_cast<G4int>(fPendingVoxels.size())) {
+        G4ExceptionDescription exceptout;
+        exceptout << "All " << fPendingVoxels.size() << " pending voxels are assigned." << G4endl;
+        exceptout << "Run of this thread is aborted." << G4endl;
+        G4Exception(
+            "sbOpticalMapBuilder::GeneratePrimaries(G4Event* event)",
+            "OpticalMapDone",
+            JustWarning,
+            exceptout
+        );
+        event->SetEventAborted();
+        G4RunManager::GetRunManager()->AbortRun(true);
+        return;
+    }
+
+    const G4int globalVoxel = fPendingVoxels[eventID];
+    const G4int scintillatorID = globalVoxel / NumOfVoxels();
+    G4int voxel = globalVoxel % NumOfVoxels();
+    G4ThreeVector voxelSize, voxelLowCorner;
+    for (G4int i = 0; i < 3; ++i) {
+        voxelSize[i] = 2.0 * gScintillatorHalfSize[i] / gOpticalMapBins[i];
+        voxelLowCorner[i] = -gScintillatorHalfSize[i] + (voxel % gOpticalMapBins[i]) * voxelSize[i];
+        voxel /= gOpticalMapBins[i];
+    }
+    const G4ThreeVector& scintillatorPosition =
+        scintillatorID == 0 ? gScintillatorsPosition.first : gScintillatorsPosition.second;
+
+    for (G4int i = 0; i < fPhotonsPerVoxel; ++i) {
+        G4ThreeVector position(
+            voxelLowCorner.x() + G4UniformRand() * voxelSize.x(),
+            voxelLowCorner.y() + G4UniformRand() * voxelSize.y(),
+            voxelLowCorner.z() + G4UniformRand() * voxelSize.z()
+        );
+        G4ThreeVector direction, polarization;
+        sbScintillationSpectrum::SamplePhotonDirection(direction, polarization);
+
+        auto vertex = new G4PrimaryVertex(scintillatorPosition + position, 0.0);
+        auto photon = new G4PrimaryParticle(G4OpticalPhoton::Definition());
+        photon->SetKineticEnergy(fSpectrum.SamplePhotonEnergy());
+        photon->SetMomentumDirection(direction);
+        photon->SetPolarization(polarization);
+        vertex->SetPrimary(photon);
+        event->AddPrimaryVertex(vertex);
+    }
+}
+
+void sbOpticalMapBuilder::RecordEvent(const G4Event* event) const {
+    const G4int eventID = event->GetEventID();
+    if (event->IsAborted() || eventID >= static_cast<G4int>(fPendingVoxels.size())) { return; }
+    const G4int globalVoxel = fPendingVoxels[eventID];
+    auto SiPMSD = static_cast<const sbSiPMSD*>(G4SDManager::GetSDMpointer()->FindSensitiveDetector(gSiPMSDName));
+
+    for (G4int SiPMID = 0; SiPMID < 2; ++SiPMID) {
+        // Photons start at t = 0, the photon time is the arrival delay, sorted by sbSiPMSD.
+        const auto& delays = SiPMID == sbSiPMHit::fUpperSiPM ?
+            SiPMSD->GetPhotonBuffers().first.GetRelativeTimes() : SiPMSD->GetPhotonBuffers().second.GetRelativeTimes();
+
+        float entry[gEntrySize] = {};
+        entry[0] = static_cast<float>(G4double(delays.size()) / fPhotonsPerVoxel);
+        if (!delays.empty()) {
+            for (G4int k = 0; k < gOpticalMapQuantiles; ++k) {
+                G4double position = G4double(k) / (gOpticalMapQuantiles - 1) * (delays.size() - 1);
+                size_t j = std::min(static_cast<size_t>(position), delays.size() - 1);
+                size_t jNext = std::min(j + 1, delays.size() - 1);
+                entry[1 + k] = static_cast<float>(delays[j] + (position - j) * (delays[jNext] - delays[j]));
+            }
+        }
+        if (pwrite(fPartialFile, entry, sizeof(entry), EntryOffset(globalVoxel, SiPMID)) != ssize_t(sizeof(entry))) {
+            return;  // Left pending.
+        }
+    }
+    // Done flag last, a voxel interrupted in between is simply redone.
+    const char done = 1;
+    if (pwrite(fPartialFile, &done, 1, EntryOffset(2 * NumOfVoxels(), 0) + globalVoxel) != 1) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot write voxel " << globalVoxel << " of the optical response map, it is left pending."
+            << G4endl;
+        G4Exception(
+            "sbOpticalMapBuilder::RecordEvent(const G4Event* event)",
+            "CannotWriteFile",
+            JustWarning,
+            exceptout
+        );
+    }
+}
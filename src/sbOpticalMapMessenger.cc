@@ -0,0 +1,40 @@
+#include "sbOpticalMapMessenger.hh"
+#include "sbOpticalMapBuilder.hh"
+#include "sbGlobal.hh"
+
+sbOpticalMapMessenger::sbOpticalMapMessenger() :
+    G4UImessenger() {
+    fOpticalMapDirectory = new G4UIdirectory("/smallbox/opticalMap/");
+    fOpticalMapDirectory->SetGuidance("Optical response map building.");
+
+    fBuildCmd = new G4UIcmdWithABool("/smallbox/opticalMap/build", this);
+    fBuildCmd->SetGuidance("Build the optical response map in the following runs.");
+    fBuildCmd->SetGuidance("One event per pending voxel, the run start prints the number of pending voxels.");
+    fBuildCmd->SetGuidance("Interrupted or short runs are resumed by the next run.");
+    fBuildCmd->SetParameterName("build", true);
+    fBuildCmd->SetDefaultValue(true);
+    fBuildCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fBuildCmd->SetToBeBroadcasted(false);
+
+    fPhotonsPerVoxelCmd = new G4UIcmdWithAnInteger("/smallbox/opticalMap/photonsPerVoxel", this);
+    fPhotonsPerVoxelCmd->SetGuidance("Number of photons emitted in each voxel.");
+    fPhotonsPerVoxelCmd->SetParameterName("photonsPerVoxel", false);
+    fPhotonsPerVoxelCmd->SetDefaultValue(gOpticalMapPhotonsPerVoxel);
+    fPhotonsPerVoxelCmd->SetRange("photonsPerVoxel > 0");
+    fPhotonsPerVoxelCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fPhotonsPerVoxelCmd->SetToBeBroadcasted(false);
+}
+
+sbOpticalMapMessenger::~sbOpticalMapMessenger() {
+    delete fPhotonsPerVoxelCmd;
+    delete fBuildCmd;
+    delete fOpticalMapDirectory;
+}
+
+void sbOpticalMapMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fBuildCmd) {
+        sbOpticalMapBuilder::GetInstance().SetEnabled(fBuildCmd->GetNewBoolValue(newValue));
+    } else if (command == fPhotonsPerVoxelCmd) {
+        sbOpticalMapBuilder::GetInstance().SetPhotonsPerVoxel(fPhotonsPerVoxelCmd->GetNewIntValue(newValue));
+    }
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4Step.hh"
+#include "G4Material.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4SDManager.hh"
+#include "G4LossTableManager.hh"
+#include "G4EmSaturation.hh"
+#include "G4NavigationHistory.hh"
+#include "Randomize.hh"
+
+#include "sbOpticalPhotonFastModel.hh"
+#include "sbDetectorConstruction.hh"
+#include "sbSiPMSD.hh"
+#include "sbOpticalMapBuilder.hh"
+#include "sbGlobal.hh"
+#include "sbConfigs.hh"
+
+sbOpticalPhotonFastModel::sbOpticalPhotonFastModel(G4Region* envelope) :
+    G4VFastSimulationModel("optical_photon_fast_model", envelope),
+    fResponseMap(sbOpticalResponseMap::GetInstance()),
+    fInitialized(false),
+    fSiPMSD(nullptr),
+    fSpectrum(),
+    fSpectrumBuilt(false),
+    fEmSaturation(nullptr) {}
+
+G4bool sbOpticalPhotonFastModel::IsApplicable(const G4ParticleDefinition& particle) {
+    return &particle == G4OpticalPhoton::Definition() && fResponseMap.IsLoaded();
+}
+
+G4bool sbOpticalPhotonFastModel::ModelTrigger(const G4FastTrack&) {
+    // Photons are tracked in full while the map is built.
+    return !sbOpticalMapBuilder::GetInstance().IsEnabled();
+}
+
+void sbOpticalPhotonFastModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) {
+    const G4Track* photon = fastTrack.GetPrimaryTrack();
+    fastStep.KillPrimaryTrack();
+    fastStep.ProposePrimaryTrackPathLength(0.0);
+
+    if (!fInitialized) { Initialize(); }
+    G4int SiPMID;
+    G4double delay;
+    if (SampleDetection(ScintillatorID(photon->GetVolume()),
+        fResponseMap.Voxel(fastTrack.GetPrimaryTrackLocalPosition()), SiPMID, delay)) {
+        fSiPMSD->AddHit(SiPMID, photon->GetGlobalTime() + delay, photon->GetTotalEnergy(),
+            sbSiPMSD::PhotonWeight(photon));
+    }
+}
+
+void sbOpticalPhotonFastModel::SampleDeposit(const G4Step* step) {
+    if (step->GetTotalEnergyDeposit() <= 0.0 || !fResponseMap.IsLoaded() ||
+        sbOpticalMapBuilder::GetInstance().IsEnabled()) {
+        return;
+    }
+    if (!fInitialized) { Initialize(); }
+    if (!fSpectrumBuilt) { return; }
+
+#if SB_REDUCE_SCINTILLATION_YIELD
+    constexpr G4double yieldFactor = 1.0 / gScintillationYieldReduction;
+    constexpr G4double photonWeight = gScintillationYieldReduction;
+#else
+    constexpr G4double yieldFactor = 1.0;
+    constexpr G4double photonWeight = 1.0;
+#endif
+    const G4double visibleEnergy = fEmSaturation ?
+        fEmSaturation->VisibleEnergyDepositionAtAStep(step) : step->GetTotalEnergyDeposit();
+    const G4int numOfPhotons = fSpectrum.SampleNumOfPhotons(fSpectrum.GetYield() * yieldFactor * visibleEnergy);
+    if (numOfPhotons <= 0) { return; }
+    const G4int numOfFastPhotons = G4int(std::min(fSpectrum.GetYieldRatio(), 1.0) * numOfPhotons);
+
+    const G4StepPoint* preStepPoint = step->GetPreStepPoint();
+    const G4StepPoint* postStepPoint = step->GetPostStepPoint();
+    const G4int scintillatorID = ScintillatorID(preStepPoint->GetPhysicalVolume());
+    // The scintillator frame is an affine map of the global one, so the step stays straight.
+    const auto& transform = preStepPoint->GetTouchableHandle()->GetHistory()->GetTopTransform();
+    const G4ThreeVector localPrePosition = transform.TransformPoint(preStepPoint->GetPosition());
+    const G4ThreeVector localStep = transform.TransformPoint(postStepPoint->GetPosition()) - localPrePosition;
+    const G4double preTime = preStepPoint->GetGlobalTime();
+    const G4double stepTime = postStepPoint->GetGlobalTime() - preTime;
+    for (G4int i = 0; i < numOfPhotons; ++i) {
+        const G4double fraction = G4UniformRand();
+        G4int SiPMID;
+        G4double delay;
+        // Most photons are lost, their time and energy are never drawn.
+        if (!SampleDetection(scintillatorID, fResponseMap.Voxel(localPrePosition + fraction * localStep),
+            SiPMID, delay)) {
+            continue;
+        }
+        const G4bool fast = i < numOfFastPhotons;
+        const G4double timeConstant = fast ? fSpectrum.GetFastTimeConstant() : fSpectrum.GetSlowTimeConstant();
+        const G4double emissionTime = preTime + fraction * stepTime - timeConstant * std::log(G4UniformRand());
+        fSiPMSD->AddHit(SiPMID, emissionTime + delay, fSpectrum.SamplePhotonEnergy(fast), photonWeight);
+    }
+}
+
+void sbOpticalPhotonFastModel::Initialize() {
+    fInitialized = true;
+    fSiPMSD = static_cast<sbSiPMSD*>(G4SDManager::GetSDMpointer()->FindSensitiveDetector(gSiPMSDName));
+    fSpectrumBuilt = fSpectrum.Build(G4Material::GetMaterial(gScintillatorMaterialName));
+    // Birks' law as G4OpticalPhysics sets it up for G4Scintillation.
+    fEmSaturation = G4LossTableManager::Instance()->EmSaturation();
+}
+
+G4int sbOpticalPhotonFastModel::ScintillatorID(const G4VPhysicalVolume* volume) const {
+    return volume == sbDetectorConstruction::GetsbDCInstance()->GetPhysicalScintillators().first ? 0 : 1;
+}
+
+G4bool sbOpticalPhotonFastModel::SampleDetection(G4int scintillatorID, G4int voxel, G4int& SiPMID,
+    G4double& delay) const {
+    // At most one SiPM detects the photon.
+    G4double u = G4UniformRand();
+    for (SiPMID = 0; SiPMID < 2; ++SiPMID) {
+        const G4double probability = fResponseMap.GetDetectionProbability(scintillatorID, voxel, SiPMID);
+        if (u < probability) {
+            delay = fResponseMap.SampleDelay(scintillatorID, voxel, SiPMID, G4UniformRand());
+            return true;
+        }
+        u -= probability;
+    }
+    return false;
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "G4SystemOfUnits.hh"
+
+#include "sbOpticalResponseMap.hh"
+#include "sbOpticalMapBuilder.hh"
+#include "sbGlobal.hh"
+
+const sbOpticalResponseMap& sbOpticalResponseMap::GetInstance() {
+    // Thread-safe initialization, the first caller loads the map.
+    static const sbOpticalResponseMap instance;
+    return instance;
+}
+
+sbOpticalResponseMap::sbOpticalResponseMap() :
+    fMappedFile(nullptr),
+    fHeader(nullptr),
+    fEntries(nullptr),
+    fNumOfVoxels(0),
+    fEntrySize(0) {
+    if (!std::ifstream(gOpticalResponseMapFileName).good()) {
+        G4ExceptionDescription exceptout;
+        exceptout << gOpticalResponseMapFileName + " not found." << G4endl;
+        exceptout << "No scintillation light is simulated without a valid map (SB_ENABLE_OPTICAL_FAST_SIMULATION)." << G4endl;
+        G4Exception(
+            "sbOpticalResponseMap::sbOpticalResponseMap()",
+            "DataFileNotFound",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    fMappedFile.reset(new sbMappedFile(gOpticalResponseMapFileName));
+
+    const char* data = fMappedFile->GetData();
+    const size_t size = fMappedFile->GetSize();
+    const auto header = reinterpret_cast<const sbOpticalResponseMapHeader*>(data);
+    G4bool valid = size >= sizeof(sbOpticalResponseMapHeader) &&
+        std::memcmp(header->magic, "SBOPTMAP", 8) == 0 &&
+        header->version == 1 &&
+        header->numOfQuantiles >= 2 &&
+        header->numOfBins[0] > 0 && header->numOfBins[1] > 0 && header->numOfBins[2] > 0;
+    if (valid) {
+        fNumOfVoxels = header->numOfBins[0] * header->numOfBins[1] * header->numOfBins[2];
+        fEntrySize = 1 + header->numOfQuantiles;
+        valid = size >= sizeof(sbOpticalResponseMapHeader) + 4 * fNumOfVoxels * fEntrySize * sizeof(float);
+    }
+    if (!valid) {
+        G4ExceptionDescription exceptout;
+        exceptout << gOpticalResponseMapFileName + " is not a valid optical response map (version 1)." << G4endl;
+        exceptout << "No scintillation light is simulated without a valid map (SB_ENABLE_OPTICAL_FAST_SIMULATION)." << G4endl;
+        G4Exception(
+            "sbOpticalResponseMap::sbOpticalResponseMap()",
+            "InvalidOpticalResponseMap",
+            JustWarning,
+            exceptout
+        );
+        fMappedFile.reset();
+        return;
+    }
+    if (header->key != sbOpticalMapBuilder::ComputeKey()) {
+        G4ExceptionDescription exceptout;
+        exceptout << gOpticalResponseMapFileName + " was built for another geometry or scintillator properties."
+            << G4endl;
+        exceptout << "Rebuild it with /smallbox/opticalMap/build. "
+            << "No scintillation light is simulated without a valid map (SB_ENABLE_OPTICAL_FAST_SIMULATION)." << G4endl;
+        G4Exception(
+            "sbOpticalResponseMap::sbOpticalResponseMap()",
+            "OutdatedOpticalResponseMap",
+            JustWarning,
+            exceptout
+        );
+        fMappedFile.reset();
+        return;
+    }
+    fHeader = header;
+    fEntries = reinterpret_cast<const float*>(data + sizeof(sbOpticalResponseMapHeader));
+
+    G4cout << "sbOpticalResponseMap: " << header->numOfBins[0] << " x " << header->numOfBins[1]
+        << " x " << header->numOfBins[2] << " voxels, " << header->numOfQuantiles
+        << " delay quantiles, loaded from " << gOpticalResponseMapFileName << G4endl;
+}
+
+G4int sbOpticalResponseMap::Voxel(const G4ThreeVector& localPosition) const {
+    G4int index[3];
+    for (G4int i = 0; i < 3; ++i) {
+        const G4int numOfBins = fHeader->numOfBins[i];
+        G4int bin = static_cast<G4int>(
+            (localPosition[i] + gScintillatorHalfSize[i]) / (2.0 * gScintillatorHalfSize[i]) * numOfBins);
+        index[i] = std::min(std::max(bin, 0), numOfBins - 1);
+    }
+    return (index[2] * fHeader->numOfBins[1] + index[1]) * fHeader->numOfBins[0] + index[0];
+}
+
+G4double sbOpticalResponseMap::SampleDelay(G4int scintillatorID, G4int voxel, G4int SiPMID, G4double u) const {
+    // Linear interpolation between the quantiles.
+    const float* quantiles = Entry(scintillatorID, voxel, SiPMID) + 1;
+    G4double position = u * (fHeader->numOfQuantiles - 1);
+    G4int k = std::min(static_cast<G4int>(position), static_cast<G4int>(fHeader->numOfQuantiles) - 2);
+    G4double fraction = position - k;
+    return (quantiles[k] + fraction * (quantiles[k + 1] - quantiles[k])) * ns;
+}
@@ -1,9 +1,16 @@
 #include "sbPhysicsList.hh"
+#include "sbGlobal.hh"
 
 sbPhysicsList::sbPhysicsList() : G4VModularPhysicsList() {
 #if SB_ENABLE_OPTICAL_PHYSICS
     RegisterPhysics(OpticalPhysics_init());
 #endif
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    // Optical photons in the scintillator region go to sbOpticalPhotonFastModel.
+    auto fastSimulationPhysics = new G4FastSimulationPhysics();
+    fastSimulationPhysics->ActivateFastSimulation("opticalphoton");
+    RegisterPhysics(fastSimulationPhysics);
+#endif
 
     //G4SpinDecayPhysics depends on G4DecayPhysics.
     RegisterPhysics(new G4DecayPhysics());
@@ -28,7 +35,16 @@ G4OpticalPhysics* sbPhysicsList::OpticalPhysics_init() {
     pOptics->SetTrackSecondariesFirst(kWLS, false);
 
     //Scintillation
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    // Sampled per energy deposit by sbOpticalPhotonFastModel, no photon tracks.
+    pOptics->Configure(kScintillation, false);
+#endif
+#if SB_REDUCE_SCINTILLATION_YIELD
+    // The SiPM hits carry the weight back, see sbSiPMSD::PhotonWeight.
+    pOptics->SetScintillationYieldFactor(1.0 / gScintillationYieldReduction);
+#else
     pOptics->SetScintillationYieldFactor(1.);
+#endif
     pOptics->SetScintillationExcitationRatio(0.);
 
     //Cerenkov light
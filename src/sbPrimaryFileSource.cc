@@ -0,0 +1,91 @@
+#include <cstring>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4ParticleTable.hh"
+#include "G4SystemOfUnits.hh"
+
+#include "sbPrimaryFileSource.hh"
+
+sbPrimaryFileSource::sbPrimaryFileSource(const G4String& fileName) :
+    fMappedFile(sbMappedFile::MapShared(fileName)),
+    fNumOfEvents(0),
+    fFirstParticle(nullptr),
+    fParticles(nullptr) {
+    const char* data = fMappedFile->GetData();
+    const size_t size = fMappedFile->GetSize();
+    const auto header = reinterpret_cast<const sbPrimaryFileHeader*>(data);
+    // The index must be ascending and within the particles, GeneratePrimaries relies on it.
+    const G4bool valid = size >= sizeof(sbPrimaryFileHeader) &&
+        std::memcmp(header->magic, "SBPRIMRY", 8) == 0 &&
+        header->version == 1 &&
+        fMappedFile->HasIndexedRecords(sizeof(sbPrimaryFileHeader), header->numOfEvents, 0,
+            header->numOfParticles, sizeof(sbPrimaryFileParticle));
+    if (!valid) {
+        G4ExceptionDescription exceptout;
+        exceptout << fileName + " is not a valid primary file (version 1)." << G4endl;
+        G4Exception(
+            "sbPrimaryFileSource::sbPrimaryFileSource(const G4String& fileName)",
+            "InvalidPrimaryFile",
+            FatalException,
+            exceptout
+        );
+        return;
+    }
+    fNumOfEvents = header->numOfEvents;
+    fFirstParticle = reinterpret_cast<const uint64_t*>(data + sizeof(sbPrimaryFileHeader));
+    fParticles = reinterpret_cast<const sbPrimaryFileParticle*>(fFirstParticle + fNumOfEvents + 1);
+    G4cout << "sbPrimaryFileSource: " << fNumOfEvents << " events in " << fileName << G4endl;
+}
+
+void sbPrimaryFileSource::CheckNumOfEvents(G4int numOfEvents) const {
+    if (uint64_t(numOfEvents) <= fNumOfEvents) { return; }
+    G4ExceptionDescription exceptout;
+    exceptout << "Run of " << numOfEvents << " events, but " << fMappedFile->GetFileName()
+        << " holds " << fNumOfEvents << " only." << G4endl;
+    G4Exception(
+        "sbPrimaryFileSource::CheckNumOfEvents(G4int numOfEvents)",
+        "PrimaryFileTooShort",
+        FatalException,
+        exceptout
+    );
+}
+
+void sbPrimaryFileSource::GeneratePrimaries(G4Event* event) {
+    // Record of the event ID, the run is checked against the file at its start.
+    const uint64_t eventID = event->GetEventID();
+    if (eventID >= fNumOfEvents) {
+        event->SetEventAborted();
+        return;
+    }
+
+    auto particleTable = G4ParticleTable::GetParticleTable();
+    for (uint64_t i = fFirstParticle[eventID]; i < fFirstParticle[eventID + 1]; ++i) {
+        const sbPrimaryFileParticle& particle = fParticles[i];
+        auto particleDefinition = particleTable->FindParticle(particle.pdgCode);
+        if (!particleDefinition) {
+            G4ExceptionDescription exceptout;
+            exceptout << "Unknown PDG code " << particle.pdgCode << " in event " << eventID
+                << ", particle skipped." << G4endl;
+            G4Exception(
+                "sbPrimaryFileSource::GeneratePrimaries(G4Event* event)",
+                "UnknownParticle",
+                JustWarning,
+                exceptout
+            );
+            continue;
+        }
+        auto vertex = new G4PrimaryVertex(
+            G4ThreeVector(particle.position[0], particle.position[1], particle.position[2]) * mm,
+            particle.time * ns
+        );
+        auto primary = new G4PrimaryParticle(particleDefinition);
+        primary->SetKineticEnergy(particle.kineticEnergy * MeV);
+        primary->SetMomentumDirection(
+            G4ThreeVector(particle.direction[0], particle.direction[1], particle.direction[2]).unit());
+        primary->SetWeight(particle.weight);
+        vertex->SetPrimary(primary);
+        event->AddPrimaryVertex(vertex);
+    }
+}
@@ -1,51 +1,212 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+
 #include "sbPrimaryGeneratorAction.hh"
+#include "sbRunAction.hh"
+#include "sbOpticalMapBuilder.hh"
+#include "sbConfigs.hh"
+
+G4double sbPrimaryGeneratorAction::fEnergyBiasIndex = gEnergyBiasIndex;
+G4double sbPrimaryGeneratorAction::fZenithBiasIndex = gZenithBiasIndex;
 
-sbPrimaryGeneratorAction::sbPrimaryGeneratorAction() :
+sbPrimaryGeneratorAction::sbPrimaryGeneratorAction(sbRunAction* runAction) :
     G4VUserPrimaryGeneratorAction(),
-    fParticleGun(new G4ParticleGun(1)) {}
+    fParticleGun(new G4ParticleGun(1)),
+    fRunAction(runAction),
+    fMuonWeight(1.0),
+    fMessenger(nullptr),
+    fSource(fAnalyticSource),
+    fInputFileName(),
+    fPrimaryFileSource(nullptr),
+    fDepositReplaySource(nullptr) {
+#if SB_BATCHED_MUON_GENERATION
+    fMuonBatch = new sbMuonBatch(runAction);
+#endif
+    fMessenger = new sbPrimaryGeneratorMessenger(this);
+}
 
 sbPrimaryGeneratorAction::~sbPrimaryGeneratorAction() {
     delete fParticleGun;
+#if SB_BATCHED_MUON_GENERATION
+    delete fMuonBatch;
+#endif
+    delete fMessenger;
+    delete fPrimaryFileSource;
+    delete fDepositReplaySource;
 }
 
 void sbPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
-    SetMuonProperties();
-    fParticleGun->GeneratePrimaryVertex(anEvent);
+    // Building the optical response map replaces any source.
+    const auto& opticalMapBuilder = sbOpticalMapBuilder::GetInstance();
+    if (opticalMapBuilder.IsEnabled()) {
+        opticalMapBuilder.GeneratePrimaries(anEvent);
+        return;
+    }
+    switch (fSource) {
+    case fFileSource:
+        if (!fPrimaryFileSource) {
+            fPrimaryFileSource = new sbPrimaryFileSource(fInputFileName);
+        }
+        fPrimaryFileSource->GeneratePrimaries(anEvent);
+        break;
+    case fReplaySource:
+        if (!fDepositReplaySource) {
+            fDepositReplaySource = new sbDepositReplaySource(fInputFileName);
+        }
+        fDepositReplaySource->GeneratePrimaries(anEvent);
+        break;
+    case fAnalyticSource:
+    default:
+        SetMuonProperties();
+        fParticleGun->GeneratePrimaryVertex(anEvent);
+        // Track weights are the vertex weight times the primary weight.
+        anEvent->GetPrimaryVertex(anEvent->GetNumberOfPrimaryVertex() - 1)->SetWeight(fMuonWeight);
+        break;
+    }
+}
+
+void sbPrimaryGeneratorAction::BeginOfRun(G4int numOfEvents) {
+    if (sbOpticalMapBuilder::GetInstance().IsEnabled()) { return; }
+    if (fSource == fFileSource) {
+        if (!fPrimaryFileSource) {
+            fPrimaryFileSource = new sbPrimaryFileSource(fInputFileName);
+        }
+        fPrimaryFileSource->CheckNumOfEvents(numOfEvents);
+    } else if (fSource == fReplaySource) {
+        if (!fDepositReplaySource) {
+            fDepositReplaySource = new sbDepositReplaySource(fInputFileName);
+        }
+        fDepositReplaySource->CheckNumOfEvents(numOfEvents);
+    }
+}
+
+void sbPrimaryGeneratorAction::SetInputFileName(const G4String& fileName) {
+    if (fileName == fInputFileName) { return; }
+    fInputFileName = fileName;
+    // Reopen at the next run.
+    delete fPrimaryFileSource;
+    fPrimaryFileSource = nullptr;
+    delete fDepositReplaySource;
+    fDepositReplaySource = nullptr;
+}
+
+G4int sbPrimaryGeneratorAction::GetReplayedMuonHitMask() const {
+    if (fSource != fReplaySource || !fDepositReplaySource) { return -1; }
+    return fDepositReplaySource->GetMuonHitMask();
 }
 
 constexpr G4double _2_pi = 2.0 * M_PI;
 
-void sbPrimaryGeneratorAction::SetMuonProperties() const {
+void sbPrimaryGeneratorAction::SetMuonProperties() {
+#if SB_BATCHED_MUON_GENERATION
+    G4double energy;
+    G4ThreeVector position;
+    G4ThreeVector direction;
+    G4bool isMuonPlus;
+    fMuonBatch->Pop(energy, position, direction, isMuonPlus, fMuonWeight);
+    fParticleGun->SetParticleDefinition(isMuonPlus ? G4MuonPlus::Definition() : G4MuonMinus::Definition());
+    fParticleGun->SetParticleEnergy(energy);
+    fParticleGun->SetParticlePosition(position);
+    fParticleGun->SetParticleMomentumDirection(direction);
+#else
     G4double theta = 0.0;
     G4double energy = 0.0;
+#if SB_USING_MUON_SPECTRUM_TABLE
+    const auto& spectrumTable = sbMuonSpectrumTable::GetInstance();
+    // Energy only depends on theta, sample it after the trajectory is kept.
+    G4int thetaBin = spectrumTable.SampleTheta(G4UniformRand(), theta);
+#else
     FindEnergyAndTheta(energy, theta);
+#endif
+    G4ThreeVector relativePositionVec;
+    G4ThreeVector sphereCentre;
+    SampleTrajectory(theta, relativePositionVec, sphereCentre);
+
+#if SB_ACCEPTANCE_AWARE_MUON_GENERATION
+    // Throw again until the trajectory crosses a scintillator.
+    // Note: the acceptance depends on theta, so theta is thrown again as well.
+    G4int numOfCandidates = 1;
+    while (!CrossScintillators(sphereCentre, relativePositionVec)) {
+        ++numOfCandidates;
+#if SB_USING_MUON_SPECTRUM_TABLE
+        thetaBin = spectrumTable.SampleTheta(G4UniformRand(), theta);
+#else
+        FindEnergyAndTheta(energy, theta);
+#endif
+        SampleTrajectory(theta, relativePositionVec, sphereCentre);
+    }
+#endif
 
+#if SB_USING_MUON_SPECTRUM_TABLE
+    energy = spectrumTable.SampleEnergy(thetaBin, G4UniformRand());
+    fMuonWeight = spectrumTable.Weight(energy, theta);
+#endif
+#if SB_ACCEPTANCE_AWARE_MUON_GENERATION
+    fRunAction->CountMuonCandidates(numOfCandidates, 1, fMuonWeight);
+#endif
+
+    // Muon definition.
+    if (G4UniformRand() > 0.563319) {
+        fParticleGun->SetParticleDefinition(G4MuonMinus::Definition());
+    } else {
+        fParticleGun->SetParticleDefinition(G4MuonPlus::Definition());
+    }
+    fParticleGun->SetParticleEnergy(energy);
+    fParticleGun->SetParticlePosition(relativePositionVec + sphereCentre);
+    fParticleGun->SetParticleMomentumDirection(-relativePositionVec);
+#endif
+}
+
+void sbPrimaryGeneratorAction::SampleTrajectory(G4double theta,
+    G4ThreeVector& relativePositionVec, G4ThreeVector& sphereCentre) {
     G4double sinTheta = sin(theta);
     G4double phi = _2_pi * G4UniformRand();
-    auto relativePositionVec = G4ThreeVector(
+    relativePositionVec = G4ThreeVector(
         sinTheta * cos(phi),
         sinTheta * sin(phi),
         cos(theta)
     ) * gSphereRadius;
 
-    auto sphereCentre = G4ThreeVector(
+    sphereCentre = G4ThreeVector(
         2.0 * G4UniformRand() - 1.0,
         2.0 * G4UniformRand() - 1.0,
         0.0
     ) * gEffectiveRange;
+}
 
-    // Muon definition.
-    if (G4UniformRand() > 0.563319) {
-        fParticleGun->SetParticleDefinition(G4MuonMinus::Definition());
-    } else {
-        fParticleGun->SetParticleDefinition(G4MuonPlus::Definition());
+// Slab test of the infinite line point + s * direction against an axis-aligned box.
+static G4bool LineCrossesBox(const G4ThreeVector& point, const G4ThreeVector& direction,
+    const G4ThreeVector& boxCentre, const G4double* boxHalfSize) {
+    G4double sMin = -DBL_MAX;
+    G4double sMax = DBL_MAX;
+    for (G4int i = 0; i < 3; ++i) {
+        G4double relativePoint = point[i] - boxCentre[i];
+        if (direction[i] == 0.0) {
+            if (std::abs(relativePoint) > boxHalfSize[i]) { return false; }
+            continue;
+        }
+        G4double s1 = (-boxHalfSize[i] - relativePoint) / direction[i];
+        G4double s2 = (boxHalfSize[i] - relativePoint) / direction[i];
+        if (s1 > s2) { std::swap(s1, s2); }
+        sMin = std::max(sMin, s1);
+        sMax = std::min(sMax, s2);
+        if (sMin > sMax) { return false; }
     }
-    fParticleGun->SetParticleEnergy(energy);
-    fParticleGun->SetParticlePosition(relativePositionVec + sphereCentre);
-    fParticleGun->SetParticleMomentumDirection(-relativePositionVec);
+    return true;
+}
+
+G4bool sbPrimaryGeneratorAction::CrossScintillators(const G4ThreeVector& sphereCentre,
+    const G4ThreeVector& direction) {
+    // The whole stack lies well inside the generation sphere, so the infinite line
+    // through the sphere centre is equivalent to the muon track.
+    return LineCrossesBox(sphereCentre, direction, gScintillatorsPosition.first, gScintillatorHalfSize) ||
+        LineCrossesBox(sphereCentre, direction, gScintillatorsPosition.second, gScintillatorHalfSize);
 }
 
-void sbPrimaryGeneratorAction::FindEnergyAndTheta(G4double& energy, G4double& theta) const {
+void sbPrimaryGeneratorAction::FindEnergyAndTheta(G4double& energy, G4double& theta) {
     G4double y;
     do {
         energy = G4UniformRand() * gMaxE_GeV;
@@ -55,7 +216,17 @@ void sbPrimaryGeneratorAction::FindEnergyAndTheta(G4double& energy, G4double& th
     energy *= GeV;
 }
 
-G4double sbPrimaryGeneratorAction::EnergySpectrum(G4double E_GeV, G4double theta) const {
+G4double sbPrimaryGeneratorAction::BiasingFunction(G4double E_GeV, G4double theta) {
+#if SB_ENABLE_MUON_SPECTRUM_BIASING
+    return pow(E_GeV, fEnergyBiasIndex) * pow(cos(theta), fZenithBiasIndex);
+#else
+    (void)E_GeV;
+    (void)theta;
+    return 1.0;
+#endif
+}
+
+G4double sbPrimaryGeneratorAction::EnergySpectrum(G4double E_GeV, G4double theta) {
     G4double cosTheta = cos(theta);
     G4double y = log(E_GeV * cosTheta);
     G4double exponent = 0.0481903 - 0.00171198 * y;
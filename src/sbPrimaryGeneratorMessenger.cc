@@ -0,0 +1,50 @@
+#include "sbPrimaryGeneratorMessenger.hh"
+#include "sbPrimaryGeneratorAction.hh"
+
+sbPrimaryGeneratorMessenger::sbPrimaryGeneratorMessenger(sbPrimaryGeneratorAction* primaryGenerator) :
+    G4UImessenger(),
+    fPrimaryGenerator(primaryGenerator) {
+    fSmallboxDirectory = new G4UIdirectory("/smallbox/");
+    fSmallboxDirectory->SetGuidance("smallbox control commands.");
+
+    fGunDirectory = new G4UIdirectory("/smallbox/gun/");
+    fGunDirectory->SetGuidance("Primary generator control.");
+
+    fSourceCmd = new G4UIcmdWithAString("/smallbox/gun/source", this);
+    fSourceCmd->SetGuidance("Select the primary source.");
+    fSourceCmd->SetGuidance("  analytic : built-in cosmic muon spectrum.");
+    fSourceCmd->SetGuidance("  file     : binary primary file, see /smallbox/gun/inputFile.");
+    fSourceCmd->SetGuidance("  replay   : optical photons of a deposit file (/smallbox/deposits/record),");
+    fSourceCmd->SetGuidance("             see /smallbox/gun/inputFile.");
+    fSourceCmd->SetParameterName("source", false);
+    fSourceCmd->SetCandidates("analytic file replay");
+    fSourceCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fInputFileCmd = new G4UIcmdWithAString("/smallbox/gun/inputFile", this);
+    fInputFileCmd->SetGuidance("Binary primary file used by the file source, or deposit file used by the replay source.");
+    fInputFileCmd->SetGuidance("It is memory-mapped, event i of a run is record i of the file.");
+    fInputFileCmd->SetGuidance("Runs of more events than the file holds are refused.");
+    fInputFileCmd->SetParameterName("fileName", false);
+    fInputFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+sbPrimaryGeneratorMessenger::~sbPrimaryGeneratorMessenger() {
+    delete fInputFileCmd;
+    delete fSourceCmd;
+    delete fGunDirectory;
+    delete fSmallboxDirectory;
+}
+
+void sbPrimaryGeneratorMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fSourceCmd) {
+        if (newValue == "file") {
+            fPrimaryGenerator->SetSource(sbPrimaryGeneratorAction::fFileSource);
+        } else if (newValue == "replay") {
+            fPrimaryGenerator->SetSource(sbPrimaryGeneratorAction::fReplaySource);
+        } else {
+            fPrimaryGenerator->SetSource(sbPrimaryGeneratorAction::fAnalyticSource);
+        }
+    } else if (command == fInputFileCmd) {
+        fPrimaryGenerator->SetInputFileName(newValue);
+    }
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "Randomize.hh"
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/JamesRandom.h"
+#include "CLHEP/Random/RanecuEngine.h"
+#include "CLHEP/Random/Ranlux64Engine.h"
+
+#include "sbRandomEngines.hh"
+#include "sbXoshiroEngine.hh"
+#include "sbConfigs.hh"
+
+CLHEP::HepRandomEngine* sbRandomEngines::NewEngine(const G4String& engineName) {
+    if (engineName == "xoshiro") { return new sbXoshiroEngine(); }
+    if (engineName == "mixmax") { return new CLHEP::MixMaxRng(); }
+    if (engineName == "james") { return new CLHEP::HepJamesRandom(); }
+    if (engineName == "ranecu") { return new CLHEP::RanecuEngine(); }
+    if (engineName == "ranlux64") { return new CLHEP::Ranlux64Engine(); }
+    return nullptr;
+}
+
+void sbRandomEngines::SelectEngine(const G4String& engineName) {
+    // Owns the selected engine until the end of the program.
+    static std::unique_ptr<CLHEP::HepRandomEngine> selectedEngine;
+    CLHEP::HepRandomEngine* engine = NewEngine(engineName);
+    if (!engine) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Unknown random engine " << engineName << ", the engine is not changed." << G4endl;
+        exceptout << "Available: " << Candidates() << G4endl;
+        G4Exception(
+            "sbRandomEngines::SelectEngine(const G4String& engineName)",
+            "UnknownEngine",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    // Keep the seed, e.g. the time seed set in main().
+    engine->setSeed(G4Random::getTheEngine()->getSeed(), 0);
+    G4Random::setTheEngine(engine);
+    selectedEngine.reset(engine);
+    G4cout << "Random engine: " << engine->name() << G4endl;
+}
+
+void sbRandomEngines::SelectEngineAtStartUp() {
+    const char* engineName = std::getenv("SB_RANDOM_ENGINE");
+    if (engineName) {
+        SelectEngine(engineName);
+        return;
+    }
+#if SB_USING_XOSHIRO_ENGINE
+    SelectEngine("xoshiro");
+#endif
+}
+
+void sbRandomEngines::Benchmark(G4int numOfNumbers) {
+    constexpr G4int arraySize = 4096;
+    std::vector<G4double> buffer(arraySize);
+    G4cout << "Random engine benchmark, " << numOfNumbers << " numbers each (ns per number):\n"
+        << "    engine                flat()   flatArray()" << G4endl;
+    std::istringstream candidates(Candidates());
+    std::string engineName;
+    while (candidates >> engineName) {
+        std::unique_ptr<CLHEP::HepRandomEngine> engine(NewEngine(engineName));
+        engine->setSeed(12345, 0);
+
+        G4double sum = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (G4int i = 0; i < numOfNumbers; ++i) { sum += engine->flat(); }
+        auto end = std::chrono::steady_clock::now();
+        G4double flatTime = std::chrono::duration<G4double, std::nano>(end - start).count() / numOfNumbers;
+
+        start = std::chrono::steady_clock::now();
+        for (G4int i = 0; i < numOfNumbers; i += arraySize) {
+            engine->flatArray(std::min(arraySize, numOfNumbers - i), buffer.data());
+            sum += buffer[0];
+        }
+        end = std::chrono::steady_clock::now();
+        G4double flatArrayTime = std::chrono::duration<G4double, std::nano>(end - start).count() / numOfNumbers;
+
+        // Print the sum so that the loops are not optimized away.
+        G4cout << "    " << std::setw(18) << std::left << engine->name() << std::right
+            << std::setw(9) << flatTime << std::setw(14) << flatArrayTime
+            << "   (checksum " << sum << ')' << G4endl;
+    }
+}
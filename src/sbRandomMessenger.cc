@@ -0,0 +1,28 @@
+#include "sbRandomMessenger.hh"
+#include "sbRandomEngines.hh"
+
+sbRandomMessenger::sbRandomMessenger() :
+    G4UImessenger() {
+    fRandomDirectory = new G4UIdirectory("/smallbox/random/");
+    fRandomDirectory->SetGuidance("Random engine control.");
+    fRandomDirectory->SetGuidance("The engine is selected at start-up by the SB_RANDOM_ENGINE environment variable.");
+
+    fBenchmarkCmd = new G4UIcmdWithAnInteger("/smallbox/random/benchmark", this);
+    fBenchmarkCmd->SetGuidance("Time the throughput of all selectable engines.");
+    fBenchmarkCmd->SetParameterName("numOfNumbers", true);
+    fBenchmarkCmd->SetDefaultValue(100000000);
+    fBenchmarkCmd->SetRange("numOfNumbers > 0");
+    fBenchmarkCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fBenchmarkCmd->SetToBeBroadcasted(false);
+}
+
+sbRandomMessenger::~sbRandomMessenger() {
+    delete fBenchmarkCmd;
+    delete fRandomDirectory;
+}
+
+void sbRandomMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fBenchmarkCmd) {
+        sbRandomEngines::Benchmark(fBenchmarkCmd->GetNewIntValue(newValue));
+    }
+}
@@ -5,16 +5,31 @@
 #include "G4LogicalVolume.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
 
 #include "sbRunAction.hh"
 #include "sbPrimaryGeneratorAction.hh"
 #include "sbDetectorConstruction.hh"
 #include "sbSiPMSD.hh"
+#include "sbSteppingAction.hh"
+#include "sbOpticalMapBuilder.hh"
+#include "sbDepositRecorder.hh"
+#include "sbAsyncFileWriter.hh"
 #include "sbConfigs.hh"
 
 sbRunAction::sbRunAction() :
     G4UserRunAction(),
-    fAnalysisManager(nullptr) {
+    fAnalysisManager(nullptr),
+    fNumOfMuonCandidates(0.0),
+    fNumOfGeneratedMuons(0.0),
+    fSumOfMuonWeights(0.0),
+    fSteppingAction(nullptr),
+    fPrimaryGenerator(nullptr) {
+    auto accumulableManager = G4AccumulableManager::Instance();
+    accumulableManager->RegisterAccumulable(fNumOfMuonCandidates);
+    accumulableManager->RegisterAccumulable(fNumOfGeneratedMuons);
+    accumulableManager->RegisterAccumulable(fSumOfMuonWeights);
+
     if (gRunningInBatch) {
         fAnalysisManager = G4Analysis::ManagerInstance("root");
         G4cout << "G4Analysis manager is using " << fAnalysisManager->GetType() << '.' << G4endl;
@@ -23,6 +38,8 @@ sbRunAction::sbRunAction() :
         fAnalysisManager->SetNtupleMerging(true);
         fAnalysisManager->SetVerboseLevel(1);
         fAnalysisManager->SetFileName(gRootFileName);
+        // Booked once, every run fills the same ntuples (see sbSiPMSD::sbNtupleID).
+        CreateTreeAndHistrogram();
     } else {
         G4cout << "Running in interactive mode, G4Analysis manager is disabled." << G4endl;
     }
@@ -35,24 +52,70 @@ sbRunAction::~sbRunAction() {
 }
 
 void sbRunAction::BeginOfRunAction(const G4Run* run) {
+    G4AccumulableManager::Instance()->Reset();
+    if (fSteppingAction != nullptr) { fSteppingAction->BeginOfRun(); }
+    // Every thread is given the number of events of the whole run.
+    if (fPrimaryGenerator != nullptr) { fPrimaryGenerator->BeginOfRun(run->GetNumberOfEventToBeProcessed()); }
+    // Building the optical response map writes no analysis output.
+    auto& opticalMapBuilder = sbOpticalMapBuilder::GetInstance();
+    if (opticalMapBuilder.IsEnabled()) {
+        if (IsMaster()) { opticalMapBuilder.BeginOfRun(); }
+        return;
+    }
+    // Threads running events, the master of a MT run does not.
+    const auto& depositRecorder = sbDepositRecorder::GetInstance();
+    if (depositRecorder.IsEnabled() && (!IsMaster() || !G4Threading::IsMultithreadedApplication())) {
+        depositRecorder.BeginOfRun();
+    }
     if (gRunningInBatch) {
-        CreateTreeAndHistrogram(run->GetNumberOfEventToBeProcessed());
+#if SB_PROCESS_SIPM_HIT
+        // Workers write the response files through it.
+        if (IsMaster()) { sbAsyncFileWriter::GetInstance().Start(gWaveformFileName); }
+#endif
         G4AnalysisManager::Instance()->OpenFile();
     }
 }
 
 void sbRunAction::EndOfRunAction(const G4Run*) {
+    G4AccumulableManager::Instance()->Merge();
+    if (fSteppingAction != nullptr) { fSteppingAction->PrintPhotonKillCounters(); }
+    auto& opticalMapBuilder = sbOpticalMapBuilder::GetInstance();
+    if (opticalMapBuilder.IsEnabled()) {
+        if (IsMaster()) { opticalMapBuilder.EndOfRun(); }
+        return;
+    }
+    const auto& depositRecorder = sbDepositRecorder::GetInstance();
+    if (depositRecorder.IsEnabled()) {
+        depositRecorder.EndOfRun();
+        // Workers have ended their runs before the master.
+        if (IsMaster()) { depositRecorder.Merge(); }
+    }
+#if SB_ACCEPTANCE_AWARE_MUON_GENERATION
+    if (IsMaster() && fNumOfMuonCandidates.GetValue() > 0.0) {
+        G4double acceptance = fNumOfGeneratedMuons.GetValue() / fNumOfMuonCandidates.GetValue();
+        G4cout << "Acceptance-aware muon generation: " << fNumOfGeneratedMuons.GetValue()
+            << " muons generated from " << fNumOfMuonCandidates.GetValue() << " candidates.\n"
+            << "    Geometric acceptance = " << acceptance
+            << ", scale rates by this factor (each muon stands for "
+            << 1.0 / acceptance << " muons of the full source)." << G4endl;
+#if SB_ENABLE_MUON_SPECTRUM_BIASING
+        G4cout << "    Spectrum biasing: sum of muon weights = " << fSumOfMuonWeights.GetValue()
+            << ", weighted acceptance = " << fSumOfMuonWeights.GetValue() / fNumOfMuonCandidates.GetValue()
+            << " (scale weighted rates by this factor)." << G4endl;
+#endif
+    }
+#endif
     if (gRunningInBatch) {
+#if SB_PROCESS_SIPM_HIT
+        // Workers have ended their runs, the queue is drained.
+        if (IsMaster()) { sbAsyncFileWriter::GetInstance().Stop(); }
+#endif
         G4AnalysisManager::Instance()->Write();
         G4AnalysisManager::Instance()->CloseFile();
     }
 }
 
-void sbRunAction::CreateTreeAndHistrogram(G4int
-#if SB_PROCESS_SIPM_HIT
-    numberOfEvent
-#endif
-) const {
+void sbRunAction::CreateTreeAndHistrogram() const {
 #if SB_PROCESS_SCINTILLATOR_HIT
 #define SB_ENERGY_RANGE_AND_UNIT 200, 0*GeV, 200*GeV, "GeV"
     fAnalysisManager->CreateH1("UpperMuonEnergy", "MuonEnergy", SB_ENERGY_RANGE_AND_UNIT);
@@ -63,33 +126,50 @@ void sbRunAction::CreateTreeAndHistrogram(G4int
     fAnalysisManager->CreateH1("LowerMuonMinus", "MuonMinus", SB_ENERGY_RANGE_AND_UNIT);
 #endif
 #if SB_PROCESS_SIPM_HIT
-    sbSiPMSD::fHitEventCount = -1;
-    std::string snStr;
-    std::stringstream ss;
-    for (G4int sn = 0; sn < numberOfEvent; ++sn) {
-        ss.clear();
-        ss << sn;
-        ss >> snStr;
+    // Same ntuples for any number of events, see sbSiPMSD::sbNtupleID.
+    // SiPM optical photon hits
+    fAnalysisManager->CreateNtuple("SiPMOpticalPhotonHits", "OpticalPhotonHits");
+    fAnalysisManager->CreateNtupleIColumn("EventID");
+    fAnalysisManager->CreateNtupleIColumn("HitIndex");
+    fAnalysisManager->CreateNtupleIColumn("SiPMID");
+    fAnalysisManager->CreateNtupleDColumn("HitTime[ns]");
+    fAnalysisManager->CreateNtupleDColumn("PhotonEnergy[eV]");
+    fAnalysisManager->CreateNtupleDColumn("Weight");
+    fAnalysisManager->FinishNtuple();
 
-        // Upper SiPM photon hit
-        fAnalysisManager->CreateNtuple("UpperSiPMOpticalPhotonHits" + snStr, "OpticalPhotonHits");
-        fAnalysisManager->CreateNtupleDColumn("HitTime[ns]");
-        fAnalysisManager->CreateNtupleDColumn("PhotonEnergy[eV]");
-        fAnalysisManager->FinishNtuple();
+    // Photoelectric response
+    fAnalysisManager->CreateNtuple("SiPMPhotoelectricResponse", "PhotoelectricResponse");
+    fAnalysisManager->CreateNtupleIColumn("EventID");
+    fAnalysisManager->CreateNtupleIColumn("Sample");
+    fAnalysisManager->CreateNtupleDColumn("Time[ns]");
+    fAnalysisManager->CreateNtupleDColumn("UpperPhotoelectricResponse[a.u.]");
+    fAnalysisManager->CreateNtupleDColumn("LowerPhotoelectricResponse[a.u.]");
+    fAnalysisManager->CreateNtupleDColumn("Weight");
+    fAnalysisManager->FinishNtuple();
 
-        // Lower SiPM photon hit
-        fAnalysisManager->CreateNtuple("LowerSiPMOpticalPhotonHits" + snStr, "OpticalPhotonHits");
-        fAnalysisManager->CreateNtupleDColumn("HitTime[ns]");
-        fAnalysisManager->CreateNtupleDColumn("PhotonEnergy[eV]");
-        fAnalysisManager->FinishNtuple();
+    // Event index
+    fAnalysisManager->CreateNtuple("SiPMEventIndex", "EventIndex");
+    fAnalysisManager->CreateNtupleIColumn("EventID");
+    fAnalysisManager->CreateNtupleIColumn("NumOfUpperHits");
+    fAnalysisManager->CreateNtupleIColumn("NumOfLowerHits");
+    fAnalysisManager->CreateNtupleIColumn("NumOfSamples");
+    fAnalysisManager->CreateNtupleDColumn("Weight");
+    fAnalysisManager->FinishNtuple();
 
-        // Photoelectric response
-        fAnalysisManager->CreateNtuple("SiPMPhotoelectricResponse" + snStr, "PhotoelectricResponse");
-        fAnalysisManager->CreateNtupleDColumn("Time[ns]");
-        fAnalysisManager->CreateNtupleDColumn("UpperPhotoelectricResponse[a.u.]");
-        fAnalysisManager->CreateNtupleDColumn("LowerPhotoelectricResponse[a.u.]");
-        fAnalysisManager->FinishNtuple();
+    // Pulse features
+    fAnalysisManager->CreateNtuple("SiPMPulseFeatures", "PulseFeatures");
+    fAnalysisManager->CreateNtupleIColumn("EventID");
+    for (const G4String SiPM : { "Upper", "Lower" }) {
+        fAnalysisManager->CreateNtupleDColumn(SiPM + "FirstPhotonTime[ns]");
+        fAnalysisManager->CreateNtupleDColumn(SiPM + "CFDTime[ns]");
+        fAnalysisManager->CreateNtupleDColumn(SiPM + "Amplitude[a.u.]");
+        fAnalysisManager->CreateNtupleDColumn(SiPM + "Charge[a.u.*ns]");
+        fAnalysisManager->CreateNtupleDColumn(SiPM + "NumOfPhotoelectrons");
     }
+    fAnalysisManager->CreateNtupleDColumn("TimeDifference[ns]");
+    fAnalysisManager->CreateNtupleDColumn("TriggerTime[ns]");
+    fAnalysisManager->CreateNtupleIColumn("FullRecord");
+    fAnalysisManager->CreateNtupleDColumn("Weight");
+    fAnalysisManager->FinishNtuple();
 #endif
 }
-
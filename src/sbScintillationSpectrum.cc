@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cmath>
+
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4Poisson.hh"
+#include "Randomize.hh"
+
+#include "sbScintillationSpectrum.hh"
+
+sbScintillationSpectrum::sbScintillationSpectrum() :
+    fFastComponentEnergies(),
+    fFastComponentCDF(),
+    fSlowComponentEnergies(),
+    fSlowComponentCDF(),
+    fYield(0.0),
+    fResolutionScale(1.0),
+    fYieldRatio(1.0),
+    fFastTimeConstant(0.0),
+    fSlowTimeConstant(0.0) {}
+
+G4bool sbScintillationSpectrum::Build(const G4Material* material) {
+    auto propertiesTable = material ? material->GetMaterialPropertiesTable() : nullptr;
+    if (!propertiesTable || !propertiesTable->GetProperty("FASTCOMPONENT") ||
+        !propertiesTable->GetProperty("SLOWCOMPONENT")) {
+        G4ExceptionDescription exceptout;
+        exceptout << (material ? material->GetName() : G4String("Material"))
+            << " has no scintillation properties." << G4endl;
+        G4Exception(
+            "sbScintillationSpectrum::Build(const G4Material* material)",
+            "NoOpticalProperties",
+            JustWarning,
+            exceptout
+        );
+        return false;
+    }
+    // Trapezoid rule, as G4Scintillation does.
+    auto buildCDF = [&](const char* componentName, std::vector<G4double>& energies, std::vector<G4double>& cdf) {
+        auto component = propertiesTable->GetProperty(componentName);
+        energies.clear();
+        cdf.clear();
+        for (size_t i = 0; i < component->GetVectorLength(); ++i) {
+            energies.push_back(component->Energy(i));
+            cdf.push_back(i == 0 ? 0.0 : cdf.back() +
+                0.5 * ((*component)[i - 1] + (*component)[i]) * (energies[i] - energies[i - 1]));
+        }
+        for (auto& c : cdf) { c /= cdf.back(); }
+    };
+    buildCDF("FASTCOMPONENT", fFastComponentEnergies, fFastComponentCDF);
+    buildCDF("SLOWCOMPONENT", fSlowComponentEnergies, fSlowComponentCDF);
+    fYield = propertiesTable->GetConstProperty("SCINTILLATIONYIELD");
+    fResolutionScale = propertiesTable->GetConstProperty("RESOLUTIONSCALE");
+    fYieldRatio = propertiesTable->GetConstProperty("YIELDRATIO");
+    fFastTimeConstant = propertiesTable->GetConstProperty("FASTTIMECONSTANT");
+    fSlowTimeConstant = propertiesTable->GetConstProperty("SLOWTIMECONSTANT");
+    return true;
+}
+
+G4int sbScintillationSpectrum::SampleNumOfPhotons(G4double meanNumOfPhotons) const {
+    if (meanNumOfPhotons > 10.0) {
+        const G4double sigma = fResolutionScale * sqrt(meanNumOfPhotons);
+        return G4int(G4RandGauss::shoot(meanNumOfPhotons, sigma) + 0.5);
+    }
+    return G4int(G4Poisson(meanNumOfPhotons));
+}
+
+G4bool sbScintillationSpectrum::SampleFastComponent() const {
+    return G4UniformRand() < fYieldRatio;
+}
+
+G4double sbScintillationSpectrum::SamplePhotonEnergy(G4bool fastComponent) const {
+    const auto& energies = fastComponent ? fFastComponentEnergies : fSlowComponentEnergies;
+    const auto& cdf = fastComponent ? fFastComponentCDF : fSlowComponentCDF;
+    const G4double u = G4UniformRand();
+    size_t bin = std::upper_bound(cdf.begin() + 1, cdf.end() - 1, u) - cdf.begin() - 1;
+    G4double fraction = cdf[bin + 1] > cdf[bin] ? (u - cdf[bin]) / (cdf[bin + 1] - cdf[bin]) : 0.5;
+    return energies[bin] + fraction * (energies[bin + 1] - energies[bin]);
+}
+
+void sbScintillationSpectrum::SamplePhotonDirection(G4ThreeVector& direction, G4ThreeVector& polarization) {
+    G4double cosTheta = 2.0 * G4UniformRand() - 1.0;
+    G4double sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    G4double phi = 2.0 * M_PI * G4UniformRand();
+    direction.set(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+    polarization = direction.orthogonal().unit();
+    polarization.rotate(2.0 * M_PI * G4UniformRand(), direction);
+}
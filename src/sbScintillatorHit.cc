@@ -11,6 +11,7 @@ sbScintillatorHit::sbScintillatorHit() :
     fMomentumDirection(0.0),
     fKineticEnergy(0.0),
     fEnergyDeposition(0.0),
+    fWeight(1.0),
     fParticleDefinition(nullptr) {}
 
 sbScintillatorHit::sbScintillatorHit(G4VPhysicalVolume* physicalScintillator) :
@@ -20,6 +21,7 @@ sbScintillatorHit::sbScintillatorHit(G4VPhysicalVolume* physicalScintillator) :
     fMomentumDirection(0.0),
     fKineticEnergy(0.0),
     fEnergyDeposition(0.0),
+    fWeight(1.0),
     fParticleDefinition(nullptr) {
     auto sbDC = sbDetectorConstruction::GetsbDCInstance();
     if (physicalScintillator == sbDC->GetPhysicalScintillators().first) {
@@ -47,6 +49,7 @@ sbScintillatorHit::sbScintillatorHit(const sbScintillatorHit& rhs) :
     fMomentumDirection(rhs.fMomentumDirection),
     fKineticEnergy(rhs.fKineticEnergy),
     fEnergyDeposition(rhs.fEnergyDeposition),
+    fWeight(rhs.fWeight),
     fParticleDefinition(rhs.fParticleDefinition) {}
 
 sbScintillatorHit::~sbScintillatorHit() {}
@@ -59,6 +62,7 @@ const sbScintillatorHit& sbScintillatorHit::operator=(const sbScintillatorHit& r
         this->fMomentumDirection = rhs.fMomentumDirection;
         this->fKineticEnergy = rhs.fKineticEnergy;
         this->fEnergyDeposition = rhs.fEnergyDeposition;
+        this->fWeight = rhs.fWeight;
         this->fParticleDefinition = rhs.fParticleDefinition;
     }
     return *this;
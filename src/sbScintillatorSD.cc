@@ -5,11 +5,18 @@
 #include "sbScintillatorSD.hh"
 #include "sbConfigs.hh"
 #include "sbScintillatorHit.hh"
+#include "sbDepositRecorder.hh"
+#include "sbOpticalPhotonFastModel.hh"
 
 sbScintillatorSD::sbScintillatorSD(const G4String& scintillatorSDName) :
     G4VSensitiveDetector(scintillatorSDName),
     fMuonHitsCollection(nullptr),
-    fAnalysisManager(nullptr) {
+    fAnalysisManager(nullptr)
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    ,
+    fOpticalFastModel(nullptr)
+#endif
+{
     if (gRunningInBatch) {
         fAnalysisManager = G4AnalysisManager::Instance();
     }
@@ -25,6 +32,16 @@ void sbScintillatorSD::Initialize(G4HCofThisEvent* hitCollectionOfThisEvent) {
 
 G4bool sbScintillatorSD::ProcessHits(G4Step* step, G4TouchableHistory*) {
     auto presentParticle = step->GetTrack()->GetParticleDefinition();
+    const auto& depositRecorder = sbDepositRecorder::GetInstance();
+    if (depositRecorder.IsEnabled() && presentParticle != G4OpticalPhoton::Definition()) {
+        depositRecorder.RecordStep(step);
+    }
+#if SB_ENABLE_OPTICAL_FAST_SIMULATION
+    // Recorded deposits get their light at the replay.
+    if (fOpticalFastModel && !depositRecorder.IsEnabled() && presentParticle != G4OpticalPhoton::Definition()) {
+        fOpticalFastModel->SampleDeposit(step);
+    }
+#endif
     if (presentParticle != G4MuonPlus::Definition() &&
         presentParticle != G4MuonMinus::Definition()) {
         return false;
@@ -39,6 +56,8 @@ G4bool sbScintillatorSD::ProcessHits(G4Step* step, G4TouchableHistory*) {
     hit->SetKineticEnergy(preStepPoint->GetKineticEnergy());
     hit->SetMomentumDirection(preStepPoint->GetMomentumDirection());
     hit->SetEnergyDeposition(step->GetTotalEnergyDeposit());
+    // Weight of the primary muon, inherited by secondaries.
+    hit->SetWeight(step->GetTrack()->GetWeight());
     hit->SetParticleDefinition(presentParticle);
     fMuonHitsCollection->insert(hit);
     return true;
@@ -70,13 +89,13 @@ void sbScintillatorSD::FillHistrogram() const {
         if (hit->GetScintillatorID() == sbScintillatorHit::sbScintillatorSet::fLowerScintillator) {
             ++HistID;
         }
-        fAnalysisManager->FillH1(HistID, hit->GetKineticEnergy());
+        fAnalysisManager->FillH1(HistID, hit->GetKineticEnergy(), hit->GetWeight());
         HistID += 2;
         if (hit->GetParticleDefinition() == G4MuonPlus::Definition()) {
-            fAnalysisManager->FillH1(HistID, hit->GetKineticEnergy());
+            fAnalysisManager->FillH1(HistID, hit->GetKineticEnergy(), hit->GetWeight());
         } else {
             HistID += 2;
-            fAnalysisManager->FillH1(HistID, hit->GetKineticEnergy());
+            fAnalysisManager->FillH1(HistID, hit->GetKineticEnergy(), hit->GetWeight());
         }
     }
 }
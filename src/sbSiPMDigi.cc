@@ -0,0 +1,32 @@
+#include "sbSiPMDigi.hh"
+
+G4ThreadLocal G4Allocator<sbSiPMDigi>* sbSiPMDigiAllocator = nullptr;
+
+sbSiPMDigi::sbSiPMDigi() :
+    G4VDigi(),
+    fTime(0.0),
+    fSiPMID(0),
+    fPixel(0),
+    fCharge(0.0),
+    fType(fPhotoelectron) {}
+
+sbSiPMDigi::sbSiPMDigi(const sbSiPMDigi& rhs) :
+    G4VDigi(),
+    fTime(rhs.fTime),
+    fSiPMID(rhs.fSiPMID),
+    fPixel(rhs.fPixel),
+    fCharge(rhs.fCharge),
+    fType(rhs.fType) {}
+
+sbSiPMDigi::~sbSiPMDigi() {}
+
+const sbSiPMDigi& sbSiPMDigi::operator=(const sbSiPMDigi& rhs) {
+    if (&rhs != this) {
+        this->fTime = rhs.fTime;
+        this->fSiPMID = rhs.fSiPMID;
+        this->fPixel = rhs.fPixel;
+        this->fCharge = rhs.fCharge;
+        this->fType = rhs.fType;
+    }
+    return *this;
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <functional>
+
+#include "G4SDManager.hh"
+#include "G4Poisson.hh"
+#include "Randomize.hh"
+
+#include "sbSiPMDigitizer.hh"
+#include "sbSiPMDigitizerMessenger.hh"
+#include "sbSiPMSD.hh"
+#include "sbSiPMResponseCore.hh"
+#include "CreateMapFromCSV.hh"
+#include "sbGlobal.hh"
+#include "sbConfigs.hh"
+
+sbSiPMDigitizer::sbSiPMDigitizer(const G4String& name) :
+    G4VDigitizerModule(name),
+    fMessenger(nullptr),
+    fSiPMSD(nullptr),
+    fCrosstalkProbability(gSiPMCrosstalkProbability),
+    fAfterpulseProbability(gSiPMAfterpulseProbability),
+    fAfterpulseTimeConstant(gSiPMAfterpulseTimeConstant),
+    fRecoveryTime(gSiPMRecoveryTime),
+    fDarkCountRate(gSiPMDarkCountRate),
+    fReadoutWindow(gSiPMReadoutWindow),
+    // The SiPM surface (EFFICIENCY) applies the PDE already.
+    fApplyPDE(!SB_SIPM_SURFACE_DETECTION),
+    fPDEEnergies(),
+    fPDEValues(),
+    fNumOfPixelsPerRow(G4int(2.0 * gSiPMHalfSize[0] / gSiPMPixelPitch)),
+    fNumOfPixels(fNumOfPixelsPerRow * fNumOfPixelsPerRow),
+    fFiredPixelBits((2 * fNumOfPixels + 63) / 64, 0),
+    fLastFireTimes(2 * fNumOfPixels, 0.0),
+    fFiredPixels(),
+    fAvalanches() {
+    collectionName.push_back(gSiPMDigitsCollectionName);
+    fMessenger = new sbSiPMDigitizerMessenger(this);
+    auto SiPMProperties(CreateMapFromCSV<G4double>(gSiPMPropertiesFileName));
+    fPDEEnergies = SiPMProperties["PDE_energy"];
+    fPDEValues = SiPMProperties["PDE"];
+}
+
+sbSiPMDigitizer::~sbSiPMDigitizer() {
+    delete fMessenger;
+}
+
+void sbSiPMDigitizer::Digitize() {
+    if (!fSiPMSD) {
+        fSiPMSD = static_cast<const sbSiPMSD*>(G4SDManager::GetSDMpointer()->FindSensitiveDetector(gSiPMSDName));
+    }
+    auto digits = new sbSiPMDigitsCollection(moduleName, collectionName[0]);
+
+    fAvalanches.clear();
+    for (G4int SiPMID : { sbSiPMHit::fUpperSiPM, sbSiPMHit::fLowerSiPM }) {
+        const auto& photons = SiPMID == sbSiPMHit::fUpperSiPM ?
+            fSiPMSD->GetPhotonBuffers().first : fSiPMSD->GetPhotonBuffers().second;
+        for (size_t i = 0; i < photons.Size(); ++i) { AddPhotoelectrons(photons, i, SiPMID); }
+        AddDarkCounts(SiPMID, photons.GetT0());
+    }
+
+    // Earliest first, crosstalk and afterpulses join the heap as they are made.
+    std::make_heap(fAvalanches.begin(), fAvalanches.end(), std::greater<sbAvalanche>());
+    while (!fAvalanches.empty()) {
+        std::pop_heap(fAvalanches.begin(), fAvalanches.end(), std::greater<sbAvalanche>());
+        const sbAvalanche avalanche = fAvalanches.back();
+        fAvalanches.pop_back();
+        Fire(avalanche, digits);
+    }
+    ResetPixels();
+
+    StoreDigiCollection(digits);
+}
+
+void sbSiPMDigitizer::AddPhotoelectrons(const sbSiPMPhotonBuffer& photons, size_t index, G4int SiPMID) {
+    const G4double weight = photons.GetWeight(index);
+    const G4int numOfPhotons = sbNumOfPhotons(weight, G4UniformRand());
+    const G4double efficiency = fApplyPDE ? PDE(photons.GetEnergy(index)) : 1.0;
+    G4bool atHitPosition = photons.IsLocated(index);
+    for (G4int i = 0; i < numOfPhotons; ++i) {
+        if (fApplyPDE && G4UniformRand() >= efficiency) { continue; }
+        const G4int pixel = atHitPosition ? PixelAt(photons.GetLocalPosition(index)) : RandomPixel();
+        atHitPosition = false;
+        fAvalanches.push_back(sbAvalanche{ photons.GetTime(index), SiPMID, pixel, sbSiPMDigi::fPhotoelectron });
+    }
+}
+
+void sbSiPMDigitizer::AddDarkCounts(G4int SiPMID, G4double T0) {
+    if (fDarkCountRate <= 0.0) { return; }
+    const G4int numOfDarkCounts = G4Poisson(sbDarkCountMean(fDarkCountRate, fReadoutWindow));
+    for (G4int i = 0; i < numOfDarkCounts; ++i) {
+        fAvalanches.push_back(sbAvalanche{ sbDarkCountTime(T0, fReadoutWindow, G4UniformRand()), SiPMID, RandomPixel(), sbSiPMDigi::fDarkCount });
+    }
+}
+
+void sbSiPMDigitizer::Fire(const sbAvalanche& avalanche, sbSiPMDigitsCollection* digits) {
+    const G4int cell = avalanche.SiPMID * fNumOfPixels + avalanche.pixel;
+    uint64_t& word = fFiredPixelBits[cell >> 6];
+    const uint64_t bit = uint64_t(1) << (cell & 63);
+    G4double charge = 1.0;
+    if (word & bit) {
+        // Still recovering from its last avalanche.
+        charge = sbRecoveredCharge(avalanche.time - fLastFireTimes[cell], fRecoveryTime);
+    } else {
+        word |= bit;
+        fFiredPixels.push_back(cell);
+    }
+    if (charge <= 0.0) { return; }
+    fLastFireTimes[cell] = avalanche.time;
+
+    auto digi = new sbSiPMDigi();
+    digi->SetTime(avalanche.time);
+    digi->SetSiPMID(avalanche.SiPMID);
+    digi->SetPixel(avalanche.pixel);
+    digi->SetCharge(charge);
+    digi->SetType(avalanche.type);
+    digits->insert(digi);
+
+    if (fCrosstalkProbability > 0.0) {
+        const G4int numOfCrosstalks = G4Poisson(sbCrosstalkMean(fCrosstalkProbability, charge));
+        const G4int row = avalanche.pixel / fNumOfPixelsPerRow;
+        const G4int column = avalanche.pixel % fNumOfPixelsPerRow;
+        for (G4int i = 0; i < numOfCrosstalks; ++i) {
+            G4int neighbourRow = row;
+            G4int neighbourColumn = column;
+            switch (G4int(4.0 * G4UniformRand())) {
+                case 0: ++neighbourRow; break;
+                case 1: --neighbourRow; break;
+                case 2: ++neighbourColumn; break;
+                default: --neighbourColumn; break;
+            }
+            // Off the edge of the SiPM.
+            if (neighbourRow < 0 || neighbourRow >= fNumOfPixelsPerRow ||
+                neighbourColumn < 0 || neighbourColumn >= fNumOfPixelsPerRow) { continue; }
+            fAvalanches.push_back(sbAvalanche{ avalanche.time, avalanche.SiPMID,
+                neighbourRow * fNumOfPixelsPerRow + neighbourColumn, sbSiPMDigi::fCrosstalk });
+            std::push_heap(fAvalanches.begin(), fAvalanches.end(), std::greater<sbAvalanche>());
+        }
+    }
+    if (fAfterpulseProbability > 0.0 && sbAfterpulses(fAfterpulseProbability, charge, G4UniformRand())) {
+        const G4double delay = sbAfterpulseDelay(fAfterpulseTimeConstant, G4UniformRand());
+        fAvalanches.push_back(sbAvalanche{ avalanche.time + delay, avalanche.SiPMID, avalanche.pixel, sbSiPMDigi::fAfterpulse });
+        std::push_heap(fAvalanches.begin(), fAvalanches.end(), std::greater<sbAvalanche>());
+    }
+}
+
+void sbSiPMDigitizer::ResetPixels() {
+    for (G4int cell : fFiredPixels) { fFiredPixelBits[cell >> 6] = 0; }
+    fFiredPixels.clear();
+}
+
+G4int sbSiPMDigitizer::PixelAt(const G4ThreeVector& localPosition) const {
+    const G4int column = std::min(std::max(G4int((localPosition.x() + gSiPMHalfSize[0]) / gSiPMPixelPitch), 0), fNumOfPixelsPerRow - 1);
+    const G4int row = std::min(std::max(G4int((localPosition.y() + gSiPMHalfSize[1]) / gSiPMPixelPitch), 0), fNumOfPixelsPerRow - 1);
+    return row * fNumOfPixelsPerRow + column;
+}
+
+G4int sbSiPMDigitizer::RandomPixel() const {
+    return std::min(G4int(fNumOfPixels * G4UniformRand()), fNumOfPixels - 1);
+}
+
+G4double sbSiPMDigitizer::PDE(G4double photonEnergy) const {
+    if (fPDEEnergies.empty() || photonEnergy <= fPDEEnergies.front() || photonEnergy >= fPDEEnergies.back()) {
+        return 0.0;
+    }
+    size_t i = std::upper_bound(fPDEEnergies.begin(), fPDEEnergies.end(), photonEnergy) - fPDEEnergies.begin();
+    G4double fraction = (photonEnergy - fPDEEnergies[i - 1]) / (fPDEEnergies[i] - fPDEEnergies[i - 1]);
+    return fPDEValues[i - 1] + fraction * (fPDEValues[i] - fPDEValues[i - 1]);
+}
@@ -0,0 +1,97 @@
+#include "G4SystemOfUnits.hh"
+
+#include "sbSiPMDigitizerMessenger.hh"
+#include "sbSiPMDigitizer.hh"
+#include "sbGlobal.hh"
+#include "sbConfigs.hh"
+
+sbSiPMDigitizerMessenger::sbSiPMDigitizerMessenger(sbSiPMDigitizer* digitizer) :
+    G4UImessenger(),
+    fDigitizer(digitizer) {
+    fDigitizerDirectory = new G4UIdirectory("/smallbox/digitizer/");
+    fDigitizerDirectory->SetGuidance("SiPM microcell digitizer.");
+
+    fCrosstalkCmd = new G4UIcmdWithADouble("/smallbox/digitizer/crosstalk", this);
+    fCrosstalkCmd->SetGuidance("Probability of an avalanche to fire at least one neighbour microcell.");
+    fCrosstalkCmd->SetParameterName("probability", false);
+    fCrosstalkCmd->SetRange("probability >= 0. && probability < 1.");
+    fCrosstalkCmd->SetDefaultValue(gSiPMCrosstalkProbability);
+    fCrosstalkCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fAfterpulseCmd = new G4UIcmdWithADouble("/smallbox/digitizer/afterpulse", this);
+    fAfterpulseCmd->SetGuidance("Probability of an avalanche to be followed by an afterpulse.");
+    fAfterpulseCmd->SetParameterName("probability", false);
+    fAfterpulseCmd->SetRange("probability >= 0. && probability <= 1.");
+    fAfterpulseCmd->SetDefaultValue(gSiPMAfterpulseProbability);
+    fAfterpulseCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fAfterpulseTimeCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/digitizer/afterpulseTime", this);
+    fAfterpulseTimeCmd->SetGuidance("Mean delay of an afterpulse.");
+    fAfterpulseTimeCmd->SetParameterName("afterpulseTime", false);
+    fAfterpulseTimeCmd->SetRange("afterpulseTime > 0.");
+    fAfterpulseTimeCmd->SetDefaultValue(gSiPMAfterpulseTimeConstant / ns);
+    fAfterpulseTimeCmd->SetDefaultUnit("ns");
+    fAfterpulseTimeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fRecoveryTimeCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/digitizer/recoveryTime", this);
+    fRecoveryTimeCmd->SetGuidance("Microcell recovery time constant, zero for instant recovery.");
+    fRecoveryTimeCmd->SetParameterName("recoveryTime", false);
+    fRecoveryTimeCmd->SetRange("recoveryTime >= 0.");
+    fRecoveryTimeCmd->SetDefaultValue(gSiPMRecoveryTime / ns);
+    fRecoveryTimeCmd->SetDefaultUnit("ns");
+    fRecoveryTimeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fDarkCountRateCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/digitizer/darkCountRate", this);
+    fDarkCountRateCmd->SetGuidance("Dark count rate of one SiPM, zero for none.");
+    fDarkCountRateCmd->SetParameterName("rate", false);
+    fDarkCountRateCmd->SetRange("rate >= 0.");
+    fDarkCountRateCmd->SetDefaultValue(gSiPMDarkCountRate / megahertz);
+    fDarkCountRateCmd->SetUnitCategory("Frequency");
+    fDarkCountRateCmd->SetDefaultUnit("MHz");
+    fDarkCountRateCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fReadoutWindowCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/digitizer/readoutWindow", this);
+    fReadoutWindowCmd->SetGuidance("Dark counts are sampled over this time after the event T0.");
+    fReadoutWindowCmd->SetParameterName("window", false);
+    fReadoutWindowCmd->SetRange("window > 0.");
+    fReadoutWindowCmd->SetDefaultValue(gSiPMReadoutWindow / ns);
+    fReadoutWindowCmd->SetDefaultUnit("ns");
+    fReadoutWindowCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fApplyPDECmd = new G4UIcmdWithABool("/smallbox/digitizer/applyPDE", this);
+    fApplyPDECmd->SetGuidance("Convert photons to photoelectrons with the PDE at their energy.");
+    fApplyPDECmd->SetGuidance("Off by default with SB_SIPM_SURFACE_DETECTION, the surface applies it,");
+    fApplyPDECmd->SetGuidance("turn it off as well with /smallbox/photonKill/PDEFilter.");
+    fApplyPDECmd->SetParameterName("apply", true);
+    fApplyPDECmd->SetDefaultValue(!SB_SIPM_SURFACE_DETECTION);
+    fApplyPDECmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+sbSiPMDigitizerMessenger::~sbSiPMDigitizerMessenger() {
+    delete fApplyPDECmd;
+    delete fReadoutWindowCmd;
+    delete fDarkCountRateCmd;
+    delete fRecoveryTimeCmd;
+    delete fAfterpulseTimeCmd;
+    delete fAfterpulseCmd;
+    delete fCrosstalkCmd;
+    delete fDigitizerDirectory;
+}
+
+void sbSiPMDigitizerMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fCrosstalkCmd) {
+        fDigitizer->SetCrosstalkProbability(fCrosstalkCmd->GetNewDoubleValue(newValue));
+    } else if (command == fAfterpulseCmd) {
+        fDigitizer->SetAfterpulseProbability(fAfterpulseCmd->GetNewDoubleValue(newValue));
+    } else if (command == fAfterpulseTimeCmd) {
+        fDigitizer->SetAfterpulseTimeConstant(fAfterpulseTimeCmd->GetNewDoubleValue(newValue));
+    } else if (command == fRecoveryTimeCmd) {
+        fDigitizer->SetRecoveryTime(fRecoveryTimeCmd->GetNewDoubleValue(newValue));
+    } else if (command == fDarkCountRateCmd) {
+        fDigitizer->SetDarkCountRate(fDarkCountRateCmd->GetNewDoubleValue(newValue));
+    } else if (command == fReadoutWindowCmd) {
+        fDigitizer->SetReadoutWindow(fReadoutWindowCmd->GetNewDoubleValue(newValue));
+    } else if (command == fApplyPDECmd) {
+        fDigitizer->SetApplyPDE(fApplyPDECmd->GetNewBoolValue(newValue));
+    }
+}
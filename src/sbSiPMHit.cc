@@ -6,12 +6,18 @@ G4ThreadLocal G4Allocator<sbSiPMHit>* sbSiPMHitAllocator = nullptr;
 sbSiPMHit::sbSiPMHit() :
     G4VHit(),
     fTime(0.0),
-    fEnergy(0.0) {}
+    fEnergy(0.0),
+    fWeight(1.0),
+    fLocalPosition(),
+    fLocated(false) {}
 
 sbSiPMHit::sbSiPMHit(const sbSiPMHit& rhs) :
     G4VHit(),
     fTime(rhs.fTime),
-    fEnergy(rhs.fEnergy){}
+    fEnergy(rhs.fEnergy),
+    fWeight(rhs.fWeight),
+    fLocalPosition(rhs.fLocalPosition),
+    fLocated(rhs.fLocated) {}
 
 sbSiPMHit::~sbSiPMHit() {}
 
@@ -19,6 +25,9 @@ const sbSiPMHit& sbSiPMHit::operator=(const sbSiPMHit& rhs) {
     if (&rhs != this) {
         this->fTime = rhs.fTime;
         this->fEnergy = rhs.fEnergy;
+        this->fWeight = rhs.fWeight;
+        this->fLocalPosition = rhs.fLocalPosition;
+        this->fLocated = rhs.fLocated;
     }
     return *this;
 }
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "sbSiPMPhotonBuffer.hh"
+
+namespace {
+    // Unsigned key in the order of the float, negative floats have all bits flipped.
+    inline uint32_t SortKey(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits ^ ((bits >> 31) ? 0xffffffffu : 0x80000000u);
+    }
+}
+
+sbSiPMPhotonBuffer::sbSiPMPhotonBuffer() :
+    fT0(0.0),
+    fTimes(),
+    fEnergies(),
+    fWeights(),
+    fLocalX(),
+    fLocalY(),
+    fKeys(),
+    fOrder(),
+    fScratchKeys(),
+    fScratchOrder(),
+    fScratchValues() {}
+
+void sbSiPMPhotonBuffer::Clear(G4double T0) {
+    fT0 = T0;
+    fTimes.clear();
+    fEnergies.clear();
+    fWeights.clear();
+    fLocalX.clear();
+    fLocalY.clear();
+}
+
+void sbSiPMPhotonBuffer::Add(G4double time, G4double energy, G4double weight, const G4ThreeVector* localPosition) {
+    fTimes.push_back(static_cast<float>((time - fT0) / ns));
+    fEnergies.push_back(static_cast<float>(energy / eV));
+    fWeights.push_back(static_cast<float>(weight));
+    if (localPosition) {
+        fLocalX.push_back(static_cast<float>(localPosition->x() / mm));
+        fLocalY.push_back(static_cast<float>(localPosition->y() / mm));
+    } else {
+        fLocalX.push_back(std::numeric_limits<float>::quiet_NaN());
+        fLocalY.push_back(std::numeric_limits<float>::quiet_NaN());
+    }
+}
+
+void sbSiPMPhotonBuffer::Sort() {
+    const size_t n = fTimes.size();
+    if (std::is_sorted(fTimes.begin(), fTimes.end())) { return; }
+
+    fKeys.resize(n);
+    fOrder.resize(n);
+    fScratchKeys.resize(n);
+    fScratchOrder.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        fKeys[i] = SortKey(fTimes[i]);
+        fOrder[i] = static_cast<uint32_t>(i);
+    }
+    for (G4int shift = 0; shift < 32; shift += 8) {
+        size_t counts[257] = {};
+        for (size_t i = 0; i < n; ++i) { ++counts[((fKeys[i] >> shift) & 0xff) + 1]; }
+        // All keys share this digit, nothing to move.
+        if (counts[((fKeys[0] >> shift) & 0xff) + 1] == n) { continue; }
+        for (G4int digit = 0; digit < 256; ++digit) { counts[digit + 1] += counts[digit]; }
+        for (size_t i = 0; i < n; ++i) {
+            const size_t position = counts[(fKeys[i] >> shift) & 0xff]++;
+            fScratchKeys[position] = fKeys[i];
+            fScratchOrder[position] = fOrder[i];
+        }
+        fKeys.swap(fScratchKeys);
+        fOrder.swap(fScratchOrder);
+    }
+
+    Gather(fTimes);
+    Gather(fEnergies);
+    Gather(fWeights);
+    Gather(fLocalX);
+    Gather(fLocalY);
+}
+
+void sbSiPMPhotonBuffer::Gather(std::vector<float>& values) {
+    fScratchValues.resize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) { fScratchValues[i] = values[fOrder[i]]; }
+    values.swap(fScratchValues);
+}
@@ -1,25 +1,37 @@
 #include <sstream>
-#include <mutex>
 #include <algorithm>
-#include <fstream>
-#include <sstream>
+#include <limits>
+#include <string>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "Randomize.hh"
+#include "G4DigiManager.hh"
 
 #include "sbSiPMSD.hh"
 #include "sbRunAction.hh"
 #include "sbDetectorConstruction.hh"
-
-G4int sbSiPMSD::fHitEventCount = -1;
-std::mutex sbSiPMSD::fMutex;
+#include "sbOpticalMapBuilder.hh"
+#include "sbWaveformSynthesizer.hh"
+#include "sbFeatureExtractor.hh"
+#include "sbElectronicNoise.hh"
+#include "sbTriggerEmulator.hh"
+#include "sbAsyncFileWriter.hh"
+#include "sbWaveformFormat.hh"
+#include "sbSiPMResponseCore.hh"
+#include "sbSiPMDigi.hh"
 
 sbSiPMSD::sbSiPMSD(const G4String& SiPMSDName) :
     G4VSensitiveDetector(SiPMSDName),
     fSiPMPhotonHC(nullptr, nullptr),
+    fPhotonBuffers(),
     fAnalysisManager(nullptr) {
     if (gRunningInBatch) {
         fAnalysisManager = G4AnalysisManager::Instance();
     }
-    collectionName.push_back("upper_optical_photon_hits_collection");
-    collectionName.push_back("lower_optical_photon_hits_collection");
+    collectionName.push_back(gSiPMHCsName.first);
+    collectionName.push_back(gSiPMHCsName.second);
 }
 
 sbSiPMSD::~sbSiPMSD() {}
@@ -29,6 +41,11 @@ void sbSiPMSD::Initialize(G4HCofThisEvent* hitCollectionOfThisEvent) {
     hitCollectionOfThisEvent->AddHitsCollection(GetCollectionID(0), fSiPMPhotonHC.first);
     fSiPMPhotonHC.second = new sbSiPMHitsCollection(SensitiveDetectorName, collectionName[1]);
     hitCollectionOfThisEvent->AddHitsCollection(GetCollectionID(1), fSiPMPhotonHC.second);
+    // Photon times are kept relative to the primary vertex time.
+    auto event = G4RunManager::GetRunManager()->GetCurrentEvent();
+    const G4double T0 = event && event->GetNumberOfPrimaryVertex() > 0 ? event->GetPrimaryVertex(0)->GetT0() : 0.0;
+    fPhotonBuffers.first.Clear(T0);
+    fPhotonBuffers.second.Clear(T0);
 }
 
 G4bool sbSiPMSD::ProcessHits(G4Step* step, G4TouchableHistory*) {
@@ -36,18 +53,20 @@ G4bool sbSiPMSD::ProcessHits(G4Step* step, G4TouchableHistory*) {
     if (presentParticle != G4OpticalPhoton::Definition()) {
         return false;
     }
+#if SB_SIPM_SURFACE_DETECTION
+    // Invoked by G4OpBoundaryProcess on detection, the photon stops on the SiPM surface.
+    auto hitPoint = step->GetPostStepPoint();
+#else
     // Present step point.
-    auto preStepPoint = step->GetPreStepPoint();
-    // A new hit.
-    auto hit = new sbSiPMHit();
-    hit->SetTime(preStepPoint->GetGlobalTime());
-    hit->SetEnergy(preStepPoint->GetTotalEnergy());
-    if (preStepPoint->GetPhysicalVolume() ==
+    auto hitPoint = step->GetPreStepPoint();
+#endif
+    G4int SiPMID;
+    if (hitPoint->GetPhysicalVolume() ==
         sbDetectorConstruction::GetsbDCInstance()->GetPhysicalSiPMs().first) {
-        fSiPMPhotonHC.first->insert(hit);
-    } else if (preStepPoint->GetPhysicalVolume() ==
+        SiPMID = sbSiPMHit::fUpperSiPM;
+    } else if (hitPoint->GetPhysicalVolume() ==
         sbDetectorConstruction::GetsbDCInstance()->GetPhysicalSiPMs().second) {
-        fSiPMPhotonHC.second->insert(hit);
+        SiPMID = sbSiPMHit::fLowerSiPM;
     } else {
         G4ExceptionDescription exceptout;
         exceptout << "The SiPM physical volume not found." << G4endl;
@@ -60,9 +79,31 @@ G4bool sbSiPMSD::ProcessHits(G4Step* step, G4TouchableHistory*) {
         );
         return false;
     }
+    // A new hit.
+    const G4ThreeVector localPosition = LocalPosition(hitPoint);
+    AddHit(SiPMID, hitPoint->GetGlobalTime(), hitPoint->GetTotalEnergy(), PhotonWeight(step->GetTrack()), &localPosition);
     return true;
 }
 
+void sbSiPMSD::AddHit(G4int SiPMID, G4double time, G4double energy, G4double weight,
+    const G4ThreeVector* localPosition) {
+#if SB_BUFFER_SIPM_PHOTONS
+    auto& photonBuffer = SiPMID == sbSiPMHit::fUpperSiPM ? fPhotonBuffers.first : fPhotonBuffers.second;
+    photonBuffer.Add(time, energy, weight, localPosition);
+#else
+    auto hit = new sbSiPMHit();
+    hit->SetTime(time);
+    hit->SetEnergy(energy);
+    hit->SetWeight(weight);
+    if (localPosition) { hit->SetLocalPosition(*localPosition); }
+    if (SiPMID == sbSiPMHit::fUpperSiPM) {
+        fSiPMPhotonHC.first->insert(hit);
+    } else {
+        fSiPMPhotonHC.second->insert(hit);
+    }
+#endif
+}
+
 void sbSiPMSD::EndOfEvent(G4HCofThisEvent*) {
     if (!fSiPMPhotonHC.first || !fSiPMPhotonHC.second) {
         G4ExceptionDescription eout;
@@ -76,79 +117,104 @@ void sbSiPMSD::EndOfEvent(G4HCofThisEvent*) {
         );
         return;
     }
-    if (gRunningInBatch) {
+#if !SB_BUFFER_SIPM_PHOTONS
+    CopyHitsToPhotonBuffers();
+#endif
+    fPhotonBuffers.first.Sort();
+    fPhotonBuffers.second.Sort();
+    if (gRunningInBatch && !sbOpticalMapBuilder::GetInstance().IsEnabled()) {
+#if SB_ROUND_PHOTON_HIT_WEIGHTS
+        RoundHitWeights();
+#endif
+#if SB_DIGITIZE_SIPM_HITS
+        G4DigiManager::GetDMpointer()->Digitize(gSiPMDigitizerName);
+#endif
         FillNtuple();
     }
 }
 
-void sbSiPMSD::FillNtuple() const {
-    G4bool emptyUpperHC = fSiPMPhotonHC.first->entries() == 0;
-    G4bool emptyLowerHC = fSiPMPhotonHC.second->entries() == 0;
-    if (emptyUpperHC && emptyLowerHC) {
-        return;
-    }
-
-    // Prevent multiple threads from getting the same ntupleID.
-    fMutex.lock();
-    ++fHitEventCount;
-    G4int localHitEventCount = fHitEventCount;
-    fMutex.unlock();
+G4ThreeVector sbSiPMSD::LocalPosition(const G4StepPoint* point) {
+    return point->GetTouchable()->GetHistory()->GetTopTransform().TransformPoint(point->GetPosition());
+}
 
-    G4cout << "sbSiPMSD::FillNtuple is processing "
-        << fHitEventCount << "-th SiPM activated event ... ";
+#if !SB_BUFFER_SIPM_PHOTONS
+void sbSiPMSD::CopyHitsToPhotonBuffers() {
+    for (auto HC : { fSiPMPhotonHC.first, fSiPMPhotonHC.second }) {
+        auto& photonBuffer = HC == fSiPMPhotonHC.first ? fPhotonBuffers.first : fPhotonBuffers.second;
+        for (size_t i = 0; i < HC->entries(); ++i) {
+            auto hit = static_cast<const sbSiPMHit*>(HC->GetHit(i));
+            photonBuffer.Add(hit->GetTime(), hit->GetEnergy(), hit->GetWeight(),
+                hit->IsLocated() ? &hit->GetLocalPosition() : nullptr);
+        }
+    }
+}
+#endif
 
-    constexpr G4int numOfNtuples = 3;
-    G4int localCurrentFirstNtupleID = numOfNtuples * fHitEventCount;
-    G4int upperSiPMHitNtupleID = localCurrentFirstNtupleID;
-    G4int lowerSiPMHitNtupleID = upperSiPMHitNtupleID + 1;
-    G4int SiPMPhotoelectricResponseNtupleID = lowerSiPMHitNtupleID + 1;
+#if SB_ROUND_PHOTON_HIT_WEIGHTS
+void sbSiPMSD::RoundHitWeights() {
+    // Rounded up with the probability of the fraction: unbiased, and the least variance an
+    // integer count adds (at most 1/4 per hit, none for integer weights). Poisson(w) per hit
+    // would add w per hit, mu(1 + w) in all instead of mu * w.
+    for (auto photonBuffer : { &fPhotonBuffers.first, &fPhotonBuffers.second }) {
+        for (size_t i = 0; i < photonBuffer->Size(); ++i) {
+            photonBuffer->SetWeight(i, sbNumOfPhotons(photonBuffer->GetWeight(i), G4UniformRand()));
+        }
+    }
+}
+#endif
 
-    std::vector<sbSiPMHit*> upperSiPMPhotonHitVec(fSiPMPhotonHC.first->entries());
-    for (size_t i = 0; i < upperSiPMPhotonHitVec.size(); ++i) {
-        upperSiPMPhotonHitVec[i] = static_cast<sbSiPMHit*>(fSiPMPhotonHC.first->GetHit(i));
+G4double sbSiPMSD::GetEventWeight() {
+    auto event = G4RunManager::GetRunManager()->GetCurrentEvent();
+    if (!event) { return 1.0; }
+    // Independently sampled primaries, their weights multiply. Optical photon primaries
+    // (replay) carry the number of photons they stand for, not an importance weight.
+    G4double weight = 1.0;
+    for (G4int i = 0; i < event->GetNumberOfPrimaryVertex(); ++i) {
+        auto vertex = event->GetPrimaryVertex(i);
+        weight *= vertex->GetWeight();
+        for (auto primary = vertex->GetPrimary(); primary; primary = primary->GetNext()) {
+            if (primary->GetParticleDefinition() != G4OpticalPhoton::Definition()) {
+                weight *= primary->GetWeight();
+            }
+        }
     }
-    std::sort(upperSiPMPhotonHitVec.begin(), upperSiPMPhotonHitVec.end(), compareHit);
+    return weight;
+}
 
-    std::vector<sbSiPMHit*> lowerSiPMPhotonHitVec(fSiPMPhotonHC.second->entries());
-    for (size_t i = 0; i < lowerSiPMPhotonHitVec.size(); ++i) {
-        lowerSiPMPhotonHitVec[i] = static_cast<sbSiPMHit*>(fSiPMPhotonHC.second->GetHit(i));
+void sbSiPMSD::FillNtuple() const {
+    // Sorted by time in EndOfEvent.
+    const auto& upperPhotons = fPhotonBuffers.first;
+    const auto& lowerPhotons = fPhotonBuffers.second;
+    G4bool emptyUpperHC = upperPhotons.Empty();
+    G4bool emptyLowerHC = lowerPhotons.Empty();
+    if (emptyUpperHC && emptyLowerHC) {
+        return;
     }
-    std::sort(lowerSiPMPhotonHitVec.begin(), lowerSiPMPhotonHitVec.end(), compareHit);
+
+    const G4int eventID = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
+    G4cout << "sbSiPMSD::FillNtuple is processing SiPM activated event " << eventID << " ... ";
+
+    const G4double eventWeight = GetEventWeight();
 
     G4double upperFirstHitTime = 0.0;
     G4double upperHitTimeAvg = 0.0;
     if (!emptyUpperHC) {
-        upperFirstHitTime = upperSiPMPhotonHitVec[0]->GetTime() / ns;
-        // Fill upper hit ntuple, need units.
-        // time in ns, energy in eV.
-        for (const auto& hit : upperSiPMPhotonHitVec) {
-            fAnalysisManager->FillNtupleDColumn(upperSiPMHitNtupleID, 0, hit->GetTime() / ns);
-            fAnalysisManager->FillNtupleDColumn(upperSiPMHitNtupleID, 1, hit->GetEnergy() / eV);
-            fAnalysisManager->AddNtupleRow(upperSiPMHitNtupleID);
-            upperHitTimeAvg += hit->GetTime();
-        }
-        upperHitTimeAvg /= ns * fSiPMPhotonHC.first->entries();
+        upperFirstHitTime = upperPhotons.GetTime(0) / ns;
+        for (float time : upperPhotons.GetRelativeTimes()) { upperHitTimeAvg += time; }
+        upperHitTimeAvg = upperHitTimeAvg / upperPhotons.Size() + upperPhotons.GetT0() / ns;
     }
 
     G4double lowerFirstHitTime = 0.0;
     G4double lowerHitTimeAvg = 0.0;
     if (!emptyLowerHC) {
-        lowerFirstHitTime = lowerSiPMPhotonHitVec[0]->GetTime() / ns;
-        // Fill lower hit ntuple.
-        for (const auto& hit : lowerSiPMPhotonHitVec) {
-            fAnalysisManager->FillNtupleDColumn(lowerSiPMHitNtupleID, 0, hit->GetTime() / ns);
-            fAnalysisManager->FillNtupleDColumn(lowerSiPMHitNtupleID, 1, hit->GetEnergy() / eV);
-            fAnalysisManager->AddNtupleRow(lowerSiPMHitNtupleID);
-            lowerHitTimeAvg += hit->GetTime();
-        }
-        lowerHitTimeAvg /= ns * fSiPMPhotonHC.second->entries();
+        lowerFirstHitTime = lowerPhotons.GetTime(0) / ns;
+        for (float time : lowerPhotons.GetRelativeTimes()) { lowerHitTimeAvg += time; }
+        lowerHitTimeAvg = lowerHitTimeAvg / lowerPhotons.Size() + lowerPhotons.GetT0() / ns;
     }
-
     // Fill photoelectric response ntuple.
     constexpr size_t samplePoints = 1024;
     constexpr G4double bufferTime = 1.0;
     constexpr G4double cutCoefficient = 6.0;
-    constexpr G4double timeWindow = 5.0;   // SiPM single photoelectric response time window.
     G4double startTime, endTime;
     if (emptyUpperHC) {
         startTime = std::max(0.0, lowerFirstHitTime - bufferTime);
@@ -160,85 +226,171 @@ void sbSiPMSD::FillNtuple() const {
         startTime = std::max(0.0, std::min(upperFirstHitTime, lowerFirstHitTime) - bufferTime);
         endTime = 5.0 * std::max(upperHitTimeAvg, lowerHitTimeAvg);
     }
-    G4double timeStep = (endTime - startTime) / (samplePoints - 1);
 
-    auto upperStartHit = upperSiPMPhotonHitVec.begin();
-    auto upperEndHit = upperSiPMPhotonHitVec.begin();;
-    auto lowerStartHit = lowerSiPMPhotonHitVec.begin();
-    auto lowerEndHit = lowerSiPMPhotonHitVec.begin();;
+    // Per thread buffers, reused by every event.
+    static G4ThreadLocal std::vector<sbPulse>* upperPulses = nullptr;
+    static G4ThreadLocal std::vector<sbPulse>* lowerPulses = nullptr;
+    static G4ThreadLocal std::vector<sbWaveformRegion>* regions = nullptr;
+    static G4ThreadLocal std::vector<G4double>* triggerTimes = nullptr;
+    static G4ThreadLocal std::vector<float>* upperPhotoelectricResponse = nullptr;
+    static G4ThreadLocal std::vector<float>* lowerPhotoelectricResponse = nullptr;
+    if (!upperPhotoelectricResponse) {
+        upperPulses = new std::vector<sbPulse>();
+        lowerPulses = new std::vector<sbPulse>();
+        regions = new std::vector<sbWaveformRegion>();
+        triggerTimes = new std::vector<G4double>();
+        upperPhotoelectricResponse = new std::vector<float>();
+        lowerPhotoelectricResponse = new std::vector<float>();
+    }
+    CollectPulses(upperPhotons, lowerPhotons, *upperPulses, *lowerPulses);
+    const auto& waveformSynthesizer = sbWaveformSynthesizer::GetInstance();
+    const G4bool sparse = waveformSynthesizer.IsSparse();
+    // Noise of each SiPM drawn once, shared by the discriminator and the readout.
+    const auto& electronicNoise = sbElectronicNoise::GetInstance();
+    sbElectronicNoise::sbNoiseRealization upperNoise{ 0.0, 0.0, 0.0 };
+    sbElectronicNoise::sbNoiseRealization lowerNoise{ 0.0, 0.0, 0.0 };
+    if (electronicNoise.IsEnabled()) {
+        upperNoise = electronicNoise.DrawRealization();
+        lowerNoise = electronicNoise.DrawRealization();
+    }
+    const auto& triggerEmulator = sbTriggerEmulator::GetInstance();
+    if (triggerEmulator.IsEnabled()) {
+        // Sampled in the readout gates only, events the DAQ would not record end here.
+        if (!triggerEmulator.Trigger(*upperPulses, *lowerPulses, upperNoise, lowerNoise, *triggerTimes, *regions)) {
+            G4cout << "not triggered." << G4endl;
+            return;
+        }
+    } else if (sparse) {
+        waveformSynthesizer.BuildSparseGrid(*upperPulses, *lowerPulses, startTime * ns, endTime * ns, *regions);
+    } else {
+        regions->assign(1, sbWaveformRegion{ startTime, (endTime - startTime) / (samplePoints - 1), 0, samplePoints });
+    }
+    waveformSynthesizer.Synthesize(*upperPulses, *regions, *upperPhotoelectricResponse);
+    waveformSynthesizer.Synthesize(*lowerPulses, *regions, *lowerPhotoelectricResponse);
+    if (electronicNoise.IsEnabled()) {
+        electronicNoise.AddNoise(upperNoise, *regions, *upperPhotoelectricResponse);
+        electronicNoise.AddNoise(lowerNoise, *regions, *lowerPhotoelectricResponse);
+    }
 
-    G4double currentTime = startTime;
+    // Features of every event, the full record of prescaled or selected ones only.
+    const auto& featureExtractor = sbFeatureExtractor::GetInstance();
+    sbPulseFeatures upperFeatures, lowerFeatures;
+    featureExtractor.Extract(upperPhotons, *upperPulses, *regions, *upperPhotoelectricResponse, upperFeatures);
+    featureExtractor.Extract(lowerPhotons, *lowerPulses, *regions, *lowerPhotoelectricResponse, lowerFeatures);
+    const G4bool fullRecord = featureExtractor.KeepFullRecord(eventID, upperFeatures, lowerFeatures);
+    G4int column = 0;
+    fAnalysisManager->FillNtupleIColumn(fFeatureNtupleID, column++, eventID);
+    for (const auto features : { &upperFeatures, &lowerFeatures }) {
+        fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, features->firstPhotonTime);
+        fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, features->CFDTime);
+        fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, features->amplitude);
+        fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, features->charge);
+        fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, features->numOfPhotoelectrons);
+    }
+    fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, upperFeatures.CFDTime - lowerFeatures.CFDTime);
+    fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, triggerEmulator.IsEnabled() ?
+        triggerTimes->front() / ns : std::numeric_limits<G4double>::quiet_NaN());
+    fAnalysisManager->FillNtupleIColumn(fFeatureNtupleID, column++, fullRecord);
+    fAnalysisManager->FillNtupleDColumn(fFeatureNtupleID, column++, eventWeight);
+    fAnalysisManager->AddNtupleRow(fFeatureNtupleID);
+    if (!fullRecord) {
+        G4cout << "features only." << G4endl;
+        return;
+    }
 
-    std::stringstream ss;
-    std::string prCSVName;
-    ss << gSiPMResultCSVDestDir << "/pr" << localHitEventCount << ".csv";
-    ss >> prCSVName;
-    std::ofstream prcsvout(prCSVName);
+    // Fill hit ntuple, upper hits first, need units.
+    // time in ns, energy in eV.
+    G4int hitIndex = 0;
+    for (G4int SiPMID : { sbSiPMHit::fUpperSiPM, sbSiPMHit::fLowerSiPM }) {
+        const auto& photons = SiPMID == sbSiPMHit::fUpperSiPM ? upperPhotons : lowerPhotons;
+        for (size_t i = 0; i < photons.Size(); ++i) {
+            fAnalysisManager->FillNtupleIColumn(fHitNtupleID, 0, eventID);
+            fAnalysisManager->FillNtupleIColumn(fHitNtupleID, 1, hitIndex++);
+            fAnalysisManager->FillNtupleIColumn(fHitNtupleID, 2, SiPMID);
+            fAnalysisManager->FillNtupleDColumn(fHitNtupleID, 3, photons.GetTime(i) / ns);
+            fAnalysisManager->FillNtupleDColumn(fHitNtupleID, 4, photons.GetEnergy(i) / eV);
+            fAnalysisManager->FillNtupleDColumn(fHitNtupleID, 5, eventWeight * photons.GetWeight(i));
+            fAnalysisManager->AddNtupleRow(fHitNtupleID);
+        }
+    }
 
-    if (!prcsvout.is_open()) {
-        G4ExceptionDescription eout;
-        eout << "Cannot open " + prCSVName << G4endl;
-        G4Exception(
-            "sbSiPMSD::FillNtuple()",
-            "CannotOpenCSVFile",
-            FatalException,
-            eout
-        );
-        // Aborted.
+    // Sparse waveforms have rows only where a SiPM is above the threshold (in magnitude,
+    // as in the container).
+    const G4double threshold = waveformSynthesizer.GetThreshold();
+    for (const auto& region : *regions) {
+        for (size_t k = 0; k < region.numOfSamples; ++k) {
+            const size_t i = region.firstSample + k;
+            if (sparse && !sbAboveThreshold((*upperPhotoelectricResponse)[i], threshold) &&
+                !sbAboveThreshold((*lowerPhotoelectricResponse)[i], threshold)) {
+                continue;
+            }
+            // write event ID, sample index and time stamp.
+            fAnalysisManager->FillNtupleIColumn(fResponseNtupleID, 0, eventID);
+            fAnalysisManager->FillNtupleIColumn(fResponseNtupleID, 1, static_cast<G4int>(i));
+            fAnalysisManager->FillNtupleDColumn(fResponseNtupleID, 2, region.startTime_ns + k * region.timeStep_ns);
+            // write upper and lower SiPM photoelectric response.
+            fAnalysisManager->FillNtupleDColumn(fResponseNtupleID, 3, (*upperPhotoelectricResponse)[i]);
+            fAnalysisManager->FillNtupleDColumn(fResponseNtupleID, 4, (*lowerPhotoelectricResponse)[i]);
+            fAnalysisManager->FillNtupleDColumn(fResponseNtupleID, 5, eventWeight);
+            // Add a new row.
+            fAnalysisManager->AddNtupleRow(fResponseNtupleID);
+        }
     }
 
-    // write csv column title
-    prcsvout << "time(ns),UpperSiPMPhotoelectricResponse,LowerSiPMPhotoelectricResponse" << G4endl;
+    // Serialized here, appended to the waveform container by the writer thread.
+    sbAsyncFileWriter::GetInstance().Write(eventID, WaveformRecord(eventID, upperPhotons, lowerPhotons, *regions,
+        *upperPhotoelectricResponse, *lowerPhotoelectricResponse, sparse ? threshold : -1.0, eventWeight));
 
-    for (size_t i = 0; i < samplePoints; ++i) {
-        // write time stamp.
-        fAnalysisManager->FillNtupleDColumn(SiPMPhotoelectricResponseNtupleID, 0, currentTime);
-        prcsvout << currentTime;
+    // Fill event index ntuple, one row per event with rows in the other ntuples.
+    fAnalysisManager->FillNtupleIColumn(fEventIndexNtupleID, 0, eventID);
+    fAnalysisManager->FillNtupleIColumn(fEventIndexNtupleID, 1, static_cast<G4int>(upperPhotons.Size()));
+    fAnalysisManager->FillNtupleIColumn(fEventIndexNtupleID, 2, static_cast<G4int>(lowerPhotons.Size()));
+    fAnalysisManager->FillNtupleIColumn(fEventIndexNtupleID, 3, static_cast<G4int>(upperPhotoelectricResponse->size()));
+    fAnalysisManager->FillNtupleDColumn(fEventIndexNtupleID, 4, eventWeight);
+    fAnalysisManager->AddNtupleRow(fEventIndexNtupleID);
 
-        G4double windowBeginTime = std::max(startTime, currentTime - timeWindow);
+    G4cout << "done." << G4endl;
+}
 
-        if (!emptyUpperHC) {
-            while (upperStartHit != upperSiPMPhotonHitVec.end()) {
-                if ((*upperStartHit)->GetTime() / ns > windowBeginTime) { break; }
-                ++upperStartHit;
-            }
-            while (upperEndHit != upperSiPMPhotonHitVec.end()) {
-                if ((*upperEndHit)->GetTime() / ns > currentTime) { break; }
-                ++upperEndHit;
-            }
-            G4double upperPhotoelectricResponse = 0.0;
-            for (auto hit = upperStartHit; hit != upperEndHit; ++hit) {
-                upperPhotoelectricResponse += SiPMSinglePhotoelectricResponse(currentTime - (*hit)->GetTime() / ns);
-            }
-            // write upper SiPM photoelectric response.
-            fAnalysisManager->FillNtupleDColumn(SiPMPhotoelectricResponseNtupleID, 1, upperPhotoelectricResponse);
-            prcsvout << ',' << upperPhotoelectricResponse;
+void sbSiPMSD::CollectPulses(const sbSiPMPhotonBuffer& upperPhotons, const sbSiPMPhotonBuffer& lowerPhotons,
+    std::vector<sbPulse>& upperPulses, std::vector<sbPulse>& lowerPulses) {
+    upperPulses.clear();
+    lowerPulses.clear();
+#if SB_DIGITIZE_SIPM_HITS
+    // Avalanches of sbSiPMDigitizer, already in time order.
+    auto digiManager = G4DigiManager::GetDMpointer();
+    auto digits = static_cast<const sbSiPMDigitsCollection*>(digiManager->GetDigiCollection(
+        digiManager->GetDigiCollectionID(gSiPMDigitizerName + "/" + gSiPMDigitsCollectionName)));
+    if (digits) {
+        for (size_t i = 0; i < digits->entries(); ++i) {
+            auto digi = static_cast<const sbSiPMDigi*>(digits->GetDigi(i));
+            auto& pulses = digi->GetSiPMID() == sbSiPMHit::fUpperSiPM ? upperPulses : lowerPulses;
+            pulses.push_back(sbPulse{ digi->GetTime(), digi->GetCharge() });
         }
+        return;
+    }
+#endif
+    // One photoelectron per photon.
+    for (auto photons : { &upperPhotons, &lowerPhotons }) {
+        auto& pulses = photons == &upperPhotons ? upperPulses : lowerPulses;
+        for (size_t i = 0; i < photons->Size(); ++i) { pulses.push_back(sbPulse{ photons->GetTime(i), photons->GetWeight(i) }); }
+    }
+}
 
-        if (!emptyLowerHC) {
-            while (lowerStartHit != lowerSiPMPhotonHitVec.end()) {
-                if ((*lowerStartHit)->GetTime() / ns > windowBeginTime) { break; }
-                ++lowerStartHit;
-            }
-            while (lowerEndHit != lowerSiPMPhotonHitVec.end()) {
-                if ((*lowerEndHit)->GetTime() / ns > currentTime) { break; }
-                ++lowerEndHit;
-            }
-            G4double lowerPhotoelectricResponse = 0.0;
-            for (auto hit = lowerStartHit; hit != lowerEndHit; ++hit) {
-                lowerPhotoelectricResponse += SiPMSinglePhotoelectricResponse(currentTime - (*hit)->GetTime() / ns);
-            }
-            // write lower SiPM photoelectric response.
-            fAnalysisManager->FillNtupleDColumn(SiPMPhotoelectricResponseNtupleID, 2, lowerPhotoelectricResponse);
-            prcsvout << ',' << lowerPhotoelectricResponse;
+std::string sbSiPMSD::WaveformRecord(G4int eventID,
+    const sbSiPMPhotonBuffer& upperPhotons, const sbSiPMPhotonBuffer& lowerPhotons,
+    const std::vector<sbWaveformRegion>& regions,
+    const std::vector<float>& upperWaveform, const std::vector<float>& lowerWaveform,
+    G4double threshold, G4double eventWeight) {
+    std::vector<double> hitTimes[2];
+    std::vector<float> hitWeights;
+    for (const auto photons : { &upperPhotons, &lowerPhotons }) {
+        auto& times = hitTimes[photons == &upperPhotons ? 0 : 1];
+        for (size_t i = 0; i < photons->Size(); ++i) {
+            times.push_back(photons->GetTime(i) / ns);
+            hitWeights.push_back(photons->GetWeight(i));
         }
-        // Add a new row.
-        fAnalysisManager->AddNtupleRow(SiPMPhotoelectricResponseNtupleID);
-        prcsvout << G4endl;
-
-        currentTime += timeStep;
     }
-
-    G4cout << "done." << G4endl;
+    return sbEncodeEventRecord(eventID, eventWeight, hitTimes[0], hitTimes[1], hitWeights, regions,
+        upperWaveform, lowerWaveform, threshold);
 }
-
@@ -0,0 +1,101 @@
+#include "G4Track.hh"
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4SDManager.hh"
+#include "G4RunManager.hh"
+
+#include "sbStackingAction.hh"
+#include "sbStackingMessenger.hh"
+#include "sbSteppingAction.hh"
+#include "sbScintillatorHit.hh"
+#include "sbOpticalMapBuilder.hh"
+#include "sbDepositRecorder.hh"
+#include "sbPrimaryGeneratorAction.hh"
+#include "sbGlobal.hh"
+#include "sbConfigs.hh"
+
+sbStackingAction::sbStackingAction(sbSteppingAction* steppingAction) :
+    G4UserStackingAction(),
+    fMessenger(nullptr),
+    fSteppingAction(steppingAction),
+    fTriggerCondition(fUpperAndLower),
+    fStage(0),
+    fReClassifying(false),
+    fMuonHitsCollectionID(-1) {
+    fMessenger = new sbStackingMessenger(this);
+}
+
+sbStackingAction::~sbStackingAction() {
+    delete fMessenger;
+}
+
+G4ClassificationOfNewTrack sbStackingAction::ClassifyNewTrack(const G4Track* track) {
+    if (track->GetParticleDefinition() != G4OpticalPhoton::Definition()) { return fUrgent; }
+    if (!fReClassifying && fSteppingAction->RejectedByPDEFilter(track)) { return fKill; }
+    if (sbOpticalMapBuilder::GetInstance().IsEnabled()) { return fUrgent; }
+#if !SB_DEFER_OPTICAL_PHOTONS
+    // Recording deposits, the optical stage is replayed later.
+    if (track->GetParentID() > 0 && sbDepositRecorder::GetInstance().IsEnabled()) { return fKill; }
+    return fUrgent;
+#else
+    // Until the trigger decision in NewStage(), also when recording deposits.
+    if (fStage == 0) { return fWaiting; }
+    return fUrgent;
+#endif
+}
+
+void sbStackingAction::NewStage() {
+    // Only the stage after the charged particles matters.
+    if (fStage++ > 0) { return; }
+    if (!TriggerConditionHolds()) {
+        stackManager->clear();
+        sbDepositRecorder::GetInstance().DiscardEvent();
+        return;
+    }
+    if (sbDepositRecorder::GetInstance().IsEnabled()) {
+        // Deposits of this event are recorded, the optical stage is replayed later.
+        stackManager->clear();
+        return;
+    }
+    fReClassifying = true;
+    stackManager->ReClassify();
+    fReClassifying = false;
+}
+
+void sbStackingAction::PrepareNewEvent() {
+    fStage = 0;
+}
+
+G4bool sbStackingAction::TriggerConditionHolds() {
+    // Replayed events have only photons, the muon hits were recorded with the deposits.
+    auto primaryGenerator = static_cast<const sbPrimaryGeneratorAction*>(
+        G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+    const G4int replayedMuonHitMask = primaryGenerator ? primaryGenerator->GetReplayedMuonHitMask() : -1;
+    if (replayedMuonHitMask >= 0) {
+        const G4bool upperHit = replayedMuonHitMask & 1;
+        const G4bool lowerHit = replayedMuonHitMask & 2;
+        return fTriggerCondition == fUpperAndLower ? upperHit && lowerHit : upperHit || lowerHit;
+    }
+    if (fMuonHitsCollectionID < 0) {
+        fMuonHitsCollectionID = G4SDManager::GetSDMpointer()->GetCollectionID(gScintillatorSDName + "/muon_hits_collection");
+    }
+    auto hitsCollectionOfThisEvent = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetHCofThisEvent();
+    if (fMuonHitsCollectionID < 0 || !hitsCollectionOfThisEvent) {
+        // No muon hits to decide on, keep everything.
+        return true;
+    }
+    auto muonHitsCollection =
+        static_cast<const sbScintillatorHitsCollection*>(hitsCollectionOfThisEvent->GetHC(fMuonHitsCollectionID));
+    G4bool upperHit = false;
+    G4bool lowerHit = false;
+    for (size_t i = 0; i < muonHitsCollection->entries(); ++i) {
+        auto hit = static_cast<const sbScintillatorHit*>(muonHitsCollection->GetHit(i));
+        if (hit->GetScintillatorID() == sbScintillatorHit::fUpperScintillator) {
+            upperHit = true;
+        } else {
+            lowerHit = true;
+        }
+    }
+    return fTriggerCondition == fUpperAndLower ? upperHit && lowerHit : upperHit || lowerHit;
+}
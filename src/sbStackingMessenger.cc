@@ -0,0 +1,32 @@
+#include "sbStackingMessenger.hh"
+#include "sbStackingAction.hh"
+
+sbStackingMessenger::sbStackingMessenger(sbStackingAction* stackingAction) :
+    G4UImessenger(),
+    fStackingAction(stackingAction) {
+    fStackingDirectory = new G4UIdirectory("/smallbox/stacking/");
+    fStackingDirectory->SetGuidance("Optical photon stacking control.");
+
+    fTriggerCmd = new G4UIcmdWithAString("/smallbox/stacking/trigger", this);
+    fTriggerCmd->SetGuidance("Muon hit condition for tracking the optical photons of an event.");
+    fTriggerCmd->SetGuidance("  and : both scintillators are hit (default).");
+    fTriggerCmd->SetGuidance("  or  : any scintillator is hit.");
+    fTriggerCmd->SetParameterName("condition", false);
+    fTriggerCmd->SetCandidates("and or");
+    fTriggerCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+sbStackingMessenger::~sbStackingMessenger() {
+    delete fTriggerCmd;
+    delete fStackingDirectory;
+}
+
+void sbStackingMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fTriggerCmd) {
+        if (newValue == "or") {
+            fStackingAction->SetTriggerCondition(sbStackingAction::fUpperOrLower);
+        } else {
+            fStackingAction->SetTriggerCondition(sbStackingAction::fUpperAndLower);
+        }
+    }
+}
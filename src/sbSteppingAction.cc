@@ -1,17 +1,201 @@
+#include <algorithm>
+#include <sstream>
+
 #include "G4Step.hh"
 #include "G4Event.hh"
 #include "G4RunManager.hh"
 #include "G4LogicalVolume.hh"
 #include "G4OpticalPhoton.hh"
+#include "G4Threading.hh"
+#include "G4SteppingManager.hh"
+#include "G4VProcess.hh"
+#include "G4OpProcessSubType.hh"
+#include "G4DigiManager.hh"
+#include "Randomize.hh"
 
 #include "sbSteppingAction.hh"
+#include "sbSteppingMessenger.hh"
 #include "sbEventAction.hh"
 #include "sbDetectorConstruction.hh"
+#include "sbSiPMDigitizer.hh"
+#include "CreateMapFromCSV.hh"
 
 sbSteppingAction::sbSteppingAction(sbEventAction* eventAction) :
-    G4UserSteppingAction(), fEventAction(eventAction) {}
+    G4UserSteppingAction(),
+    fEventAction(eventAction),
+    fMessenger(nullptr),
+    fKillOnLeavingSystem(false),
+    fPhotonTimeCut(0.0),
+    fMaxBoundaryInteractions(0),
+    fPDEFilter(false),
+    fPDEEnergies(),
+    fPDEValues(),
+    fNumOfBoundaryInteractions(0) {
+    fMessenger = new sbSteppingMessenger(this);
+    auto SiPMProperties(CreateMapFromCSV<G4double>(gSiPMPropertiesFileName));
+    fPDEEnergies = SiPMProperties["PDE_energy"];
+    fPDEValues = SiPMProperties["PDE"];
+    ResetPhotonKillCounters();
+}
+
+sbSteppingAction::~sbSteppingAction() {
+    delete fMessenger;
+}
+
+void sbSteppingAction::UserSteppingAction(const G4Step* step) {
+    G4Track* track = step->GetTrack();
+    if (track->GetParticleDefinition() != G4OpticalPhoton::Definition()) {
+#if SB_ENABLE_OPTICAL_PHYSICS
+        WeighNewPhotons(step);
+#endif
+        return;
+    }
+
+    const G4int stepNumber = track->GetCurrentStepNumber();
+    if (stepNumber == 1) { fNumOfBoundaryInteractions = 0; }
+    if (track->GetTrackStatus() != fAlive) {
+        ++fNumOfEndedPhotons;
+        fNumOfEndedPhotonSteps += stepNumber;
+        return;
+    }
+
+    const G4StepPoint* postStepPoint = step->GetPostStepPoint();
+    if (fPhotonTimeCut > 0.0 && postStepPoint->GetGlobalTime() > fPhotonTimeCut) {
+        KillPhoton(track, fTimeCutPolicy);
+        return;
+    }
+    if (postStepPoint->GetStepStatus() == fGeomBoundary) {
+        ++fNumOfBoundaryInteractions;
+        if (fMaxBoundaryInteractions > 0 && fNumOfBoundaryInteractions > fMaxBoundaryInteractions) {
+            KillPhoton(track, fBoundaryInteractionPolicy);
+            return;
+        }
+        // Entered the world (history depth 0) away from the foil-wrapped scintillators.
+        if (fKillOnLeavingSystem && postStepPoint->GetTouchableHandle()->GetHistoryDepth() == 0 &&
+            OutsideSystem(postStepPoint->GetPosition())) {
+            KillPhoton(track, fLeaveSystemPolicy);
+            return;
+        }
+    }
+}
+
+#if SB_ENABLE_OPTICAL_PHYSICS
+void sbSteppingAction::WeighNewPhotons(const G4Step* step) {
+    const size_t numOfNewSecondaries = step->GetNumberOfSecondariesInCurrentStep();
+    if (numOfNewSecondaries == 0) { return; }
+    // The secondaries of this step are the last ones, not stacked yet.
+    G4TrackVector& secondaries = *fpSteppingManager->GetfSecondary();
+    for (size_t i = secondaries.size() - numOfNewSecondaries; i < secondaries.size(); ++i) {
+        G4Track* secondary = secondaries[i];
+        if (secondary->GetParticleDefinition() != G4OpticalPhoton::Definition()) { continue; }
+        G4double weight = 1.0;
+#if SB_REDUCE_SCINTILLATION_YIELD
+        // Only the scintillation yield is reduced, Cerenkov photons keep weight 1.
+        auto creatorProcess = secondary->GetCreatorProcess();
+        if (creatorProcess && creatorProcess->GetProcessSubType() == fScintillation) {
+            weight = gScintillationYieldReduction;
+        }
+#endif
+        secondary->SetWeight(weight);
+    }
+}
+#endif
+
+void sbSteppingAction::KillPhoton(G4Track* track, sbPhotonKillPolicy policy) {
+    track->SetTrackStatus(fStopAndKill);
+    ++fNumOfKilledPhotons[policy];
+    fNumOfKilledPhotonSteps[policy] += track->GetCurrentStepNumber();
+}
+
+G4bool sbSteppingAction::RejectedByPDEFilter(const G4Track* track) {
+    if (!fPDEFilter || G4UniformRand() < PDE(track->GetTotalEnergy())) { return false; }
+    // Killed before its first step.
+    ++fNumOfKilledPhotons[fPDEFilterPolicy];
+    return true;
+}
+
+G4double sbSteppingAction::PDE(G4double photonEnergy) const {
+    if (fPDEEnergies.empty() || photonEnergy <= fPDEEnergies.front() || photonEnergy >= fPDEEnergies.back()) {
+        return 0.0;
+    }
+    size_t i = std::upper_bound(fPDEEnergies.begin(), fPDEEnergies.end(), photonEnergy) - fPDEEnergies.begin();
+    G4double fraction = (photonEnergy - fPDEEnergies[i - 1]) / (fPDEEnergies[i] - fPDEEnergies[i - 1]);
+    return fPDEValues[i - 1] + fraction * (fPDEValues[i] - fPDEValues[i - 1]);
+}
+
+G4bool sbSteppingAction::OutsideSystem(const G4ThreeVector& position) {
+    // Outer boxes of the aluminum foils, the light guides are inside them.
+    constexpr G4double margin = gAlFoilScintillatorGap + gAlFoilThickness;
+    for (const auto& scintillatorPosition : { gScintillatorsPosition.first, gScintillatorsPosition.second }) {
+        G4ThreeVector relativePosition = position - scintillatorPosition;
+        if (std::abs(relativePosition.x()) <= gScintillatorHalfSize[0] + margin &&
+            std::abs(relativePosition.y()) <= gScintillatorHalfSize[1] + margin &&
+            std::abs(relativePosition.z()) <= gScintillatorHalfSize[2] + margin) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void sbSteppingAction::SetPDEFilter(G4bool filter) {
+    fPDEFilter = filter;
+#if SB_ENABLE_OPTICAL_PHYSICS && SB_SIPM_SURFACE_DETECTION
+    // The filter applies the PDE, the SiPM surface must not apply it again.
+    sbDetectorConstruction::GetsbDCInstance()->SetSiPMSurfacePDE(!filter);
+#endif
+}
+
+void sbSteppingAction::BeginOfRun() {
+    ResetPhotonKillCounters();
+    CheckPhotonTimeCut();
+}
 
-sbSteppingAction::~sbSteppingAction() {}
+void sbSteppingAction::CheckPhotonTimeCut() const {
+    // Once, all threads have the same settings.
+    if (fPhotonTimeCut <= 0.0 || G4Threading::G4GetThreadId() > 0) { return; }
+    G4double readoutWindow = gSiPMReadoutWindow;
+#if SB_PROCESS_SIPM_HIT && SB_DIGITIZE_SIPM_HITS
+    auto digitizer = static_cast<const sbSiPMDigitizer*>(
+        G4DigiManager::GetDMpointer()->FindDigitizerModule(gSiPMDigitizerName));
+    if (digitizer) { readoutWindow = digitizer->GetReadoutWindow(); }
+#endif
+    if (fPhotonTimeCut >= readoutWindow) { return; }
+    G4ExceptionDescription exceptout;
+    exceptout << "The photon time cut (" << fPhotonTimeCut / ns << " ns) is shorter than the SiPM readout window ("
+        << readoutWindow / ns << " ns)." << G4endl;
+    exceptout << "Photons inside the recorded window are killed, see /smallbox/photonKill/timeCut." << G4endl;
+    G4Exception(
+        "sbSteppingAction::CheckPhotonTimeCut()",
+        "PhotonTimeCutInsideReadoutWindow",
+        JustWarning,
+        exceptout
+    );
+}
 
-void sbSteppingAction::UserSteppingAction(const G4Step* /* step */) {}
+void sbSteppingAction::ResetPhotonKillCounters() {
+    std::fill(fNumOfKilledPhotons, fNumOfKilledPhotons + fNumOfPhotonKillPolicies, 0.0);
+    std::fill(fNumOfKilledPhotonSteps, fNumOfKilledPhotonSteps + fNumOfPhotonKillPolicies, 0.0);
+    fNumOfEndedPhotons = 0.0;
+    fNumOfEndedPhotonSteps = 0.0;
+}
 
+void sbSteppingAction::PrintPhotonKillCounters() const {
+    G4double totalKilled = 0.0;
+    for (auto killed : fNumOfKilledPhotons) { totalKilled += killed; }
+    if (totalKilled == 0.0) { return; }
+    // Steps saved are estimated by the mean length (in steps) of photons that ended by themselves.
+    const G4double meanSteps = fNumOfEndedPhotons > 0.0 ? fNumOfEndedPhotonSteps / fNumOfEndedPhotons : 0.0;
+    static const char* const policyNames[fNumOfPhotonKillPolicies] = {
+        "leave system", "time cut", "max boundary interactions", "PDE filter"
+    };
+    std::ostringstream out;
+    out << "Optical photon kill policies (thread " << G4Threading::G4GetThreadId() << "), "
+        << fNumOfEndedPhotons << " photons ended by themselves, " << meanSteps << " steps on average:\n";
+    for (G4int i = 0; i < fNumOfPhotonKillPolicies; ++i) {
+        if (fNumOfKilledPhotons[i] == 0.0) { continue; }
+        G4double stepsSaved = std::max(0.0, fNumOfKilledPhotons[i] * meanSteps - fNumOfKilledPhotonSteps[i]);
+        out << "    " << policyNames[i] << ": " << fNumOfKilledPhotons[i] << " photons killed, ~"
+            << stepsSaved << " steps saved\n";
+    }
+    G4cout << out.str() << G4endl;
+}
@@ -0,0 +1,60 @@
+#include "sbSteppingMessenger.hh"
+#include "sbSteppingAction.hh"
+
+sbSteppingMessenger::sbSteppingMessenger(sbSteppingAction* steppingAction) :
+    G4UImessenger(),
+    fSteppingAction(steppingAction) {
+    fPhotonKillDirectory = new G4UIdirectory("/smallbox/photonKill/");
+    fPhotonKillDirectory->SetGuidance("Optical photon kill policies, all disabled by default.");
+    fPhotonKillDirectory->SetGuidance("Kill counts and saved steps are printed at the end of run.");
+
+    fLeaveSystemCmd = new G4UIcmdWithABool("/smallbox/photonKill/leaveSystem", this);
+    fLeaveSystemCmd->SetGuidance("Kill photons entering the world outside the foil-wrapped scintillators.");
+    fLeaveSystemCmd->SetParameterName("kill", true);
+    fLeaveSystemCmd->SetDefaultValue(true);
+    fLeaveSystemCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fTimeCutCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/photonKill/timeCut", this);
+    fTimeCutCmd->SetGuidance("Kill photons beyond this global time, e.g. the SiPM readout window.");
+    fTimeCutCmd->SetGuidance("A cut shorter than /smallbox/digitizer/readoutWindow is warned at the start of run.");
+    fTimeCutCmd->SetGuidance("Zero disables the cut.");
+    fTimeCutCmd->SetParameterName("timeCut", false);
+    fTimeCutCmd->SetRange("timeCut >= 0.");
+    fTimeCutCmd->SetDefaultUnit("ns");
+    fTimeCutCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMaxBoundaryInteractionsCmd = new G4UIcmdWithAnInteger("/smallbox/photonKill/maxBoundaryInteractions", this);
+    fMaxBoundaryInteractionsCmd->SetGuidance("Kill photons after this number of boundary interactions.");
+    fMaxBoundaryInteractionsCmd->SetGuidance("Zero disables the limit.");
+    fMaxBoundaryInteractionsCmd->SetParameterName("maxBoundaryInteractions", false);
+    fMaxBoundaryInteractionsCmd->SetRange("maxBoundaryInteractions >= 0");
+    fMaxBoundaryInteractionsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fPDEFilterCmd = new G4UIcmdWithABool("/smallbox/photonKill/PDEFilter", this);
+    fPDEFilterCmd->SetGuidance("Keep a new photon with the SiPM PDE at its energy when it is stacked, kill it otherwise.");
+    fPDEFilterCmd->SetGuidance("Surviving photons already passed the PDE, do not apply it again at the SiPM.");
+    fPDEFilterCmd->SetGuidance("With SiPM surface detection, the surface efficiency is set to 1 while it is on.");
+    fPDEFilterCmd->SetParameterName("filter", true);
+    fPDEFilterCmd->SetDefaultValue(true);
+    fPDEFilterCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+sbSteppingMessenger::~sbSteppingMessenger() {
+    delete fPDEFilterCmd;
+    delete fMaxBoundaryInteractionsCmd;
+    delete fTimeCutCmd;
+    delete fLeaveSystemCmd;
+    delete fPhotonKillDirectory;
+}
+
+void sbSteppingMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    if (command == fLeaveSystemCmd) {
+        fSteppingAction->SetKillOnLeavingSystem(fLeaveSystemCmd->GetNewBoolValue(newValue));
+    } else if (command == fTimeCutCmd) {
+        fSteppingAction->SetPhotonTimeCut(fTimeCutCmd->GetNewDoubleValue(newValue));
+    } else if (command == fMaxBoundaryInteractionsCmd) {
+        fSteppingAction->SetMaxBoundaryInteractions(fMaxBoundaryInteractionsCmd->GetNewIntValue(newValue));
+    } else if (command == fPDEFilterCmd) {
+        fSteppingAction->SetPDEFilter(fPDEFilterCmd->GetNewBoolValue(newValue));
+    }
+}
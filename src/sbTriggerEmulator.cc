@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "G4SystemOfUnits.hh"
+
+#include "sbTriggerEmulator.hh"
+#include "sbElectronicNoise.hh"
+#include "sbGlobal.hh"
+
+sbTriggerEmulator& sbTriggerEmulator::GetInstance() {
+    static sbTriggerEmulator instance;
+    return instance;
+}
+
+sbTriggerEmulator::sbTriggerEmulator() :
+    fEnabled(false),
+    fDiscriminator(fLeadingEdge),
+    fThreshold(gTriggerThreshold),
+    fCFDFraction(gTriggerCFDFraction),
+    fDiscriminatorStep(gDiscriminatorStep),
+    fCoincidenceWindow(gCoincidenceWindow),
+    fDeadTime(gTriggerDeadTime),
+    fPreTrigger(gReadoutPreTrigger),
+    fGateLength(gReadoutGateLength),
+    fGateStep(gReadoutGateStep) {}
+
+G4bool sbTriggerEmulator::Trigger(const std::vector<sbPulse>& upperPulses, const std::vector<sbPulse>& lowerPulses,
+    const sbElectronicNoise::sbNoiseRealization& upperNoise, const sbElectronicNoise::sbNoiseRealization& lowerNoise,
+    std::vector<G4double>& triggerTimes, std::vector<sbWaveformRegion>& gates) const {
+    triggerTimes.clear();
+    gates.clear();
+    if (upperPulses.empty() || lowerPulses.empty()) { return false; }
+
+    // Per thread buffers, reused by every event.
+    static G4ThreadLocal std::vector<G4double>* upperFireTimes = nullptr;
+    static G4ThreadLocal std::vector<G4double>* lowerFireTimes = nullptr;
+    if (!upperFireTimes) {
+        upperFireTimes = new std::vector<G4double>();
+        lowerFireTimes = new std::vector<G4double>();
+    }
+    Discriminate(upperPulses, upperNoise, *upperFireTimes);
+    if (upperFireTimes->empty()) { return false; }
+    Discriminate(lowerPulses, lowerNoise, *lowerFireTimes);
+
+    // Every firing closes a coincidence with a firing of the other SiPM in the window before it.
+    auto upper = upperFireTimes->begin();
+    auto lower = lowerFireTimes->begin();
+    G4double lastUpperTime = -DBL_MAX;
+    G4double lastLowerTime = -DBL_MAX;
+    while (upper != upperFireTimes->end() || lower != lowerFireTimes->end()) {
+        G4double time;
+        G4double otherTime;
+        if (lower == lowerFireTimes->end() || (upper != upperFireTimes->end() && *upper <= *lower)) {
+            time = lastUpperTime = *upper++;
+            otherTime = lastLowerTime;
+        } else {
+            time = lastLowerTime = *lower++;
+            otherTime = lastUpperTime;
+        }
+        if (time - otherTime > fCoincidenceWindow) { continue; }
+        if (!triggerTimes.empty() && time - triggerTimes.back() < fDeadTime) { continue; }
+        triggerTimes.push_back(time);
+    }
+    if (triggerTimes.empty()) { return false; }
+
+    // Gates in ns, merged where they overlap.
+    uint32_t firstSample = 0;
+    G4double gateEnd = -DBL_MAX;
+    for (G4double triggerTime : triggerTimes) {
+        G4double begin = triggerTime - fPreTrigger;
+        const G4double end = begin + fGateLength;
+        if (begin < gateEnd) {
+            // Extends the last gate on its grid.
+            auto& gate = gates.back();
+            const uint32_t numOfSamples = std::ceil((end - gate.startTime_ns * ns) / fGateStep);
+            firstSample += numOfSamples - gate.numOfSamples;
+            gate.numOfSamples = numOfSamples;
+        } else {
+            const uint32_t numOfSamples = std::ceil(fGateLength / fGateStep);
+            gates.push_back(sbWaveformRegion{ begin / ns, fGateStep / ns, firstSample, numOfSamples });
+            firstSample += numOfSamples;
+        }
+        gateEnd = end;
+    }
+    return true;
+}
+
+void sbTriggerEmulator::Discriminate(const std::vector<sbPulse>& pulses,
+    const sbElectronicNoise::sbNoiseRealization& noise, std::vector<G4double>& fireTimes) const {
+    fireTimes.clear();
+    if (pulses.empty()) { return; }
+
+    // Discriminator input in the windows of the pulses only.
+    static G4ThreadLocal std::vector<sbWaveformRegion>* regions = nullptr;
+    static G4ThreadLocal std::vector<float>* waveform = nullptr;
+    if (!waveform) {
+        regions = new std::vector<sbWaveformRegion>();
+        waveform = new std::vector<float>();
+    }
+    BuildWindows(pulses, *regions);
+    sbWaveformSynthesizer::GetInstance().Synthesize(pulses, *regions, *waveform);
+    const auto& electronicNoise = sbElectronicNoise::GetInstance();
+    if (electronicNoise.IsEnabled()) { electronicNoise.AddNoise(noise, *regions, *waveform); }
+
+    const std::vector<float>& samples = *waveform;
+    // Fractional position where the samples rise through the level between i - 1 and i.
+    auto crossing = [&](size_t i, G4double level) {
+        return i - 1 + (level - samples[i - 1]) / (samples[i] - samples[i - 1]);
+    };
+    for (const auto& region : *regions) {
+        // Every window starts armed if it starts below the threshold.
+        const size_t first = region.firstSample;
+        const size_t end = first + region.numOfSamples;
+        auto sampleTime = [&](G4double position) { return region.startTime_ns * ns + (position - first) * fDiscriminatorStep; };
+        // First sample below the threshold after the last firing, where the discriminator re-armed.
+        size_t armed = first;
+        for (size_t i = first + 1; i < end; ++i) {
+            if (!(samples[i - 1] < fThreshold && samples[i] >= fThreshold)) { continue; }
+            if (fDiscriminator == fLeadingEdge) {
+                fireTimes.push_back(sampleTime(crossing(i, fThreshold)));
+            } else {
+                // The following peak, then back down the rising edge to its fraction, not past the
+                // re-arm point: below the threshold a piled-up pulse would lead back into the tail
+                // of the previous one, before its firing.
+                size_t peak = i;
+                while (peak + 1 < end && samples[peak + 1] >= samples[peak]) { ++peak; }
+                const G4double level = fCFDFraction * samples[peak];
+                size_t j = i;
+                while (j > armed + 1 && samples[j - 1] >= level) { --j; }
+                while (samples[j] < level) { ++j; }
+                fireTimes.push_back(sampleTime(samples[j - 1] < level ? crossing(j, level) : j - 1));
+                i = peak;
+            }
+            // Re-armed below the threshold.
+            while (i + 1 < end && samples[i + 1] >= fThreshold) { ++i; }
+            armed = i + 1;
+        }
+    }
+}
+
+void sbTriggerEmulator::BuildWindows(const std::vector<sbPulse>& pulses, std::vector<sbWaveformRegion>& regions) const {
+    // From a step before every pulse to the tail after it, merged where they overlap, on one
+    // grid of the discriminator step from the first window.
+    regions.clear();
+    const G4double gridStart = pulses.front().time - fDiscriminatorStep;
+    G4double begin = gridStart;
+    G4double end = gridStart;
+    uint32_t firstSample = 0;
+    auto addWindow = [&]() {
+        const uint32_t numOfSamples = std::ceil((end - begin) / fDiscriminatorStep) + 1;
+        regions.push_back(sbWaveformRegion{ begin / ns, fDiscriminatorStep / ns, firstSample, numOfSamples });
+        firstSample += numOfSamples;
+    };
+    for (const auto& pulse : pulses) {
+        const G4double pulseBegin = pulse.time - fDiscriminatorStep;
+        if (pulseBegin > end) {
+            if (end > begin) { addWindow(); }
+            begin = gridStart + std::floor((pulseBegin - gridStart) / fDiscriminatorStep) * fDiscriminatorStep;
+        }
+        end = std::max(end, pulse.time + gDiscriminatorTail);
+    }
+    addWindow();
+}
@@ -0,0 +1,140 @@
+#include "G4SystemOfUnits.hh"
+
+#include "sbTriggerMessenger.hh"
+#include "sbTriggerEmulator.hh"
+#include "sbGlobal.hh"
+
+sbTriggerMessenger::sbTriggerMessenger() :
+    G4UImessenger() {
+    fTriggerDirectory = new G4UIdirectory("/smallbox/trigger/");
+    fTriggerDirectory->SetGuidance("Trigger and DAQ emulation, waveforms only in the readout gates.");
+
+    fEnableCmd = new G4UIcmdWithABool("/smallbox/trigger/enable", this);
+    fEnableCmd->SetGuidance("Keep events with an upper and lower coincidence only, sampled in the readout gates.");
+    fEnableCmd->SetParameterName("enable", true);
+    fEnableCmd->SetDefaultValue(true);
+    fEnableCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fEnableCmd->SetToBeBroadcasted(false);
+
+    fDiscriminatorCmd = new G4UIcmdWithAString("/smallbox/trigger/discriminator", this);
+    fDiscriminatorCmd->SetGuidance("Discriminator of every SiPM.");
+    fDiscriminatorCmd->SetGuidance("  leadingEdge : fires at the threshold crossing.");
+    fDiscriminatorCmd->SetGuidance("  CFD         : armed by the threshold, fires at the CFD fraction of the peak.");
+    fDiscriminatorCmd->SetParameterName("discriminator", false);
+    fDiscriminatorCmd->SetCandidates("leadingEdge CFD");
+    fDiscriminatorCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fDiscriminatorCmd->SetToBeBroadcasted(false);
+
+    fThresholdCmd = new G4UIcmdWithADouble("/smallbox/trigger/threshold", this);
+    fThresholdCmd->SetGuidance("Discriminator threshold in single photoelectron peaks.");
+    fThresholdCmd->SetParameterName("threshold", false);
+    fThresholdCmd->SetRange("threshold > 0.");
+    fThresholdCmd->SetDefaultValue(gTriggerThreshold);
+    fThresholdCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fThresholdCmd->SetToBeBroadcasted(false);
+
+    fCFDFractionCmd = new G4UIcmdWithADouble("/smallbox/trigger/cfdFraction", this);
+    fCFDFractionCmd->SetGuidance("Fraction of the peak the CFD fires at.");
+    fCFDFractionCmd->SetParameterName("fraction", false);
+    fCFDFractionCmd->SetRange("fraction > 0. && fraction <= 1.");
+    fCFDFractionCmd->SetDefaultValue(gTriggerCFDFraction);
+    fCFDFractionCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fCFDFractionCmd->SetToBeBroadcasted(false);
+
+    fDiscriminatorStepCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/trigger/discriminatorStep", this);
+    fDiscriminatorStepCmd->SetGuidance("Sampling step of the discriminator input.");
+    fDiscriminatorStepCmd->SetParameterName("step", false);
+    fDiscriminatorStepCmd->SetRange("step > 0.");
+    fDiscriminatorStepCmd->SetDefaultValue(gDiscriminatorStep / ns);
+    fDiscriminatorStepCmd->SetDefaultUnit("ns");
+    fDiscriminatorStepCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fDiscriminatorStepCmd->SetToBeBroadcasted(false);
+
+    fCoincidenceWindowCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/trigger/coincidenceWindow", this);
+    fCoincidenceWindowCmd->SetGuidance("Upper and lower firings within this window trigger.");
+    fCoincidenceWindowCmd->SetParameterName("window", false);
+    fCoincidenceWindowCmd->SetRange("window >= 0.");
+    fCoincidenceWindowCmd->SetDefaultValue(gCoincidenceWindow / ns);
+    fCoincidenceWindowCmd->SetDefaultUnit("ns");
+    fCoincidenceWindowCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fCoincidenceWindowCmd->SetToBeBroadcasted(false);
+
+    fDeadTimeCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/trigger/deadTime", this);
+    fDeadTimeCmd->SetGuidance("Triggers within this time after an accepted one are lost.");
+    fDeadTimeCmd->SetParameterName("deadTime", false);
+    fDeadTimeCmd->SetRange("deadTime >= 0.");
+    fDeadTimeCmd->SetDefaultValue(gTriggerDeadTime / ns);
+    fDeadTimeCmd->SetDefaultUnit("ns");
+    fDeadTimeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fDeadTimeCmd->SetToBeBroadcasted(false);
+
+    fPreTriggerCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/trigger/preTrigger", this);
+    fPreTriggerCmd->SetGuidance("Readout gate start before the trigger.");
+    fPreTriggerCmd->SetParameterName("preTrigger", false);
+    fPreTriggerCmd->SetRange("preTrigger >= 0.");
+    fPreTriggerCmd->SetDefaultValue(gReadoutPreTrigger / ns);
+    fPreTriggerCmd->SetDefaultUnit("ns");
+    fPreTriggerCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fPreTriggerCmd->SetToBeBroadcasted(false);
+
+    fGateLengthCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/trigger/gateLength", this);
+    fGateLengthCmd->SetGuidance("Length of the readout gate of every trigger.");
+    fGateLengthCmd->SetParameterName("gateLength", false);
+    fGateLengthCmd->SetRange("gateLength > 0.");
+    fGateLengthCmd->SetDefaultValue(gReadoutGateLength / ns);
+    fGateLengthCmd->SetDefaultUnit("ns");
+    fGateLengthCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fGateLengthCmd->SetToBeBroadcasted(false);
+
+    fGateStepCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/trigger/gateStep", this);
+    fGateStepCmd->SetGuidance("Sampling step of the waveforms in the readout gates.");
+    fGateStepCmd->SetParameterName("gateStep", false);
+    fGateStepCmd->SetRange("gateStep > 0.");
+    fGateStepCmd->SetDefaultValue(gReadoutGateStep / ns);
+    fGateStepCmd->SetDefaultUnit("ns");
+    fGateStepCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fGateStepCmd->SetToBeBroadcasted(false);
+}
+
+sbTriggerMessenger::~sbTriggerMessenger() {
+    delete fGateStepCmd;
+    delete fGateLengthCmd;
+    delete fPreTriggerCmd;
+    delete fDeadTimeCmd;
+    delete fCoincidenceWindowCmd;
+    delete fDiscriminatorStepCmd;
+    delete fCFDFractionCmd;
+    delete fThresholdCmd;
+    delete fDiscriminatorCmd;
+    delete fEnableCmd;
+    delete fTriggerDirectory;
+}
+
+void sbTriggerMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    auto& triggerEmulator = sbTriggerEmulator::GetInstance();
+    if (command == fEnableCmd) {
+        triggerEmulator.SetEnabled(fEnableCmd->GetNewBoolValue(newValue));
+    } else if (command == fDiscriminatorCmd) {
+        if (newValue == "CFD") {
+            triggerEmulator.SetDiscriminator(sbTriggerEmulator::fConstantFraction);
+        } else {
+            triggerEmulator.SetDiscriminator(sbTriggerEmulator::fLeadingEdge);
+        }
+    } else if (command == fThresholdCmd) {
+        triggerEmulator.SetThreshold(fThresholdCmd->GetNewDoubleValue(newValue));
+    } else if (command == fCFDFractionCmd) {
+        triggerEmulator.SetCFDFraction(fCFDFractionCmd->GetNewDoubleValue(newValue));
+    } else if (command == fDiscriminatorStepCmd) {
+        triggerEmulator.SetDiscriminatorStep(fDiscriminatorStepCmd->GetNewDoubleValue(newValue));
+    } else if (command == fCoincidenceWindowCmd) {
+        triggerEmulator.SetCoincidenceWindow(fCoincidenceWindowCmd->GetNewDoubleValue(newValue));
+    } else if (command == fDeadTimeCmd) {
+        triggerEmulator.SetDeadTime(fDeadTimeCmd->GetNewDoubleValue(newValue));
+    } else if (command == fPreTriggerCmd) {
+        triggerEmulator.SetPreTrigger(fPreTriggerCmd->GetNewDoubleValue(newValue));
+    } else if (command == fGateLengthCmd) {
+        triggerEmulator.SetGateLength(fGateLengthCmd->GetNewDoubleValue(newValue));
+    } else if (command == fGateStepCmd) {
+        triggerEmulator.SetGateStep(fGateStepCmd->GetNewDoubleValue(newValue));
+    }
+}
@@ -0,0 +1,129 @@
+#include "G4SystemOfUnits.hh"
+
+#include "sbWaveformMessenger.hh"
+#include "sbWaveformSynthesizer.hh"
+#include "sbGlobal.hh"
+
+sbWaveformMessenger::sbWaveformMessenger() :
+    G4UImessenger() {
+    fWaveformDirectory = new G4UIdirectory("/smallbox/waveform/");
+    fWaveformDirectory->SetGuidance("SiPM waveform synthesis.");
+
+    fShapeCmd = new G4UIcmdWithAString("/smallbox/waveform/shape", this);
+    fShapeCmd->SetGuidance("Single photoelectron pulse shape.");
+    fShapeCmd->SetGuidance("  exponential : exp(-t/fall) - exp(-t/rise), normalized to a peak of 1.");
+    fShapeCmd->SetGuidance("  tabulated   : SPE_time, SPE_amplitude of /smallbox/waveform/pulseFile.");
+    fShapeCmd->SetParameterName("shape", false);
+    fShapeCmd->SetCandidates("exponential tabulated");
+    fShapeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fShapeCmd->SetToBeBroadcasted(false);
+
+    fRiseTimeCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/waveform/riseTime", this);
+    fRiseTimeCmd->SetGuidance("Rise time of the exponential pulse, zero for an instant rise.");
+    fRiseTimeCmd->SetParameterName("riseTime", false);
+    fRiseTimeCmd->SetRange("riseTime >= 0.");
+    fRiseTimeCmd->SetDefaultValue(gSiPMPulseRiseTime / ns);
+    fRiseTimeCmd->SetDefaultUnit("ns");
+    fRiseTimeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fRiseTimeCmd->SetToBeBroadcasted(false);
+
+    fFallTimeCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/waveform/fallTime", this);
+    fFallTimeCmd->SetGuidance("Fall time of the exponential pulse, longer than the rise time.");
+    fFallTimeCmd->SetParameterName("fallTime", false);
+    fFallTimeCmd->SetRange("fallTime > 0.");
+    fFallTimeCmd->SetDefaultValue(gSiPMPulseFallTime / ns);
+    fFallTimeCmd->SetDefaultUnit("ns");
+    fFallTimeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fFallTimeCmd->SetToBeBroadcasted(false);
+
+    fPulseFileCmd = new G4UIcmdWithAString("/smallbox/waveform/pulseFile", this);
+    fPulseFileCmd->SetGuidance("csv file of the tabulated pulse, SPE_time in ns and SPE_amplitude.");
+    fPulseFileCmd->SetParameterName("fileName", false);
+    fPulseFileCmd->SetDefaultValue(gSiPMPropertiesFileName);
+    fPulseFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fPulseFileCmd->SetToBeBroadcasted(false);
+
+    fSparseCmd = new G4UIcmdWithABool("/smallbox/waveform/sparse", this);
+    fSparseCmd->SetGuidance("Zero-suppressed waveforms, fine steps at leading edges and coarse in tails,");
+    fSparseCmd->SetGuidance("instead of 1024 uniform samples.");
+    fSparseCmd->SetParameterName("sparse", true);
+    fSparseCmd->SetDefaultValue(true);
+    fSparseCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fSparseCmd->SetToBeBroadcasted(false);
+
+    fThresholdCmd = new G4UIcmdWithADouble("/smallbox/waveform/threshold", this);
+    fThresholdCmd->SetGuidance("Sparse waveforms keep the samples above this in magnitude, in single photoelectron peaks.");
+    fThresholdCmd->SetParameterName("threshold", false);
+    fThresholdCmd->SetRange("threshold >= 0.");
+    fThresholdCmd->SetDefaultValue(gWaveformSparseThreshold);
+    fThresholdCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fThresholdCmd->SetToBeBroadcasted(false);
+
+    fFineStepCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/waveform/fineStep", this);
+    fFineStepCmd->SetGuidance("Time step of sparse waveforms at leading edges.");
+    fFineStepCmd->SetParameterName("fineStep", false);
+    fFineStepCmd->SetRange("fineStep > 0.");
+    fFineStepCmd->SetDefaultValue(gWaveformFineStep / ns);
+    fFineStepCmd->SetDefaultUnit("ns");
+    fFineStepCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fFineStepCmd->SetToBeBroadcasted(false);
+
+    fFineWindowCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/waveform/fineWindow", this);
+    fFineWindowCmd->SetGuidance("Sparse waveforms take fine steps for this time after a leading edge,");
+    fFineWindowCmd->SetGuidance("a pulse after this time without pulses in its SiPM is a new leading edge.");
+    fFineWindowCmd->SetParameterName("fineWindow", false);
+    fFineWindowCmd->SetRange("fineWindow > 0.");
+    fFineWindowCmd->SetDefaultValue(gWaveformFineWindow / ns);
+    fFineWindowCmd->SetDefaultUnit("ns");
+    fFineWindowCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fFineWindowCmd->SetToBeBroadcasted(false);
+
+    fCoarseStepCmd = new G4UIcmdWithADoubleAndUnit("/smallbox/waveform/coarseStep", this);
+    fCoarseStepCmd->SetGuidance("Time step of sparse waveforms in the tails.");
+    fCoarseStepCmd->SetParameterName("coarseStep", false);
+    fCoarseStepCmd->SetRange("coarseStep > 0.");
+    fCoarseStepCmd->SetDefaultValue(gWaveformCoarseStep / ns);
+    fCoarseStepCmd->SetDefaultUnit("ns");
+    fCoarseStepCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fCoarseStepCmd->SetToBeBroadcasted(false);
+}
+
+sbWaveformMessenger::~sbWaveformMessenger() {
+    delete fCoarseStepCmd;
+    delete fFineWindowCmd;
+    delete fFineStepCmd;
+    delete fThresholdCmd;
+    delete fSparseCmd;
+    delete fPulseFileCmd;
+    delete fFallTimeCmd;
+    delete fRiseTimeCmd;
+    delete fShapeCmd;
+    delete fWaveformDirectory;
+}
+
+void sbWaveformMessenger::SetNewValue(G4UIcommand* command, G4String newValue) {
+    auto& waveformSynthesizer = sbWaveformSynthesizer::GetInstance();
+    if (command == fShapeCmd) {
+        if (newValue == "tabulated") {
+            waveformSynthesizer.SetPulseShape(sbWaveformSynthesizer::fTabulatedPulse);
+        } else {
+            waveformSynthesizer.SetPulseShape(sbWaveformSynthesizer::fExponentialPulse);
+        }
+    } else if (command == fRiseTimeCmd) {
+        waveformSynthesizer.SetRiseTime(fRiseTimeCmd->GetNewDoubleValue(newValue));
+    } else if (command == fFallTimeCmd) {
+        waveformSynthesizer.SetFallTime(fFallTimeCmd->GetNewDoubleValue(newValue));
+    } else if (command == fPulseFileCmd) {
+        waveformSynthesizer.SetPulseFileName(newValue);
+    } else if (command == fSparseCmd) {
+        waveformSynthesizer.SetSparse(fSparseCmd->GetNewBoolValue(newValue));
+    } else if (command == fThresholdCmd) {
+        waveformSynthesizer.SetThreshold(fThresholdCmd->GetNewDoubleValue(newValue));
+    } else if (command == fFineStepCmd) {
+        waveformSynthesizer.SetFineStep(fFineStepCmd->GetNewDoubleValue(newValue));
+    } else if (command == fFineWindowCmd) {
+        waveformSynthesizer.SetFineWindow(fFineWindowCmd->GetNewDoubleValue(newValue));
+    } else if (command == fCoarseStepCmd) {
+        waveformSynthesizer.SetCoarseStep(fCoarseStepCmd->GetNewDoubleValue(newValue));
+    }
+}
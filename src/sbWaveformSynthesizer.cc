@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "G4SystemOfUnits.hh"
+
+#include "sbWaveformSynthesizer.hh"
+#include "CreateMapFromCSV.hh"
+#include "sbGlobal.hh"
+
+G4ThreadLocal sbPulseKernelCache* sbWaveformSynthesizer::fKernelCache = nullptr;
+
+sbWaveformSynthesizer& sbWaveformSynthesizer::GetInstance() {
+    static sbWaveformSynthesizer instance;
+    return instance;
+}
+
+sbWaveformSynthesizer::sbWaveformSynthesizer() :
+    fPulseShape(fExponentialPulse),
+    fRiseTime(gSiPMPulseRiseTime),
+    fFallTime(gSiPMPulseFallTime),
+    fPulseFileName(gSiPMPropertiesFileName),
+    fPulseTable(),
+    fSparse(false),
+    fThreshold(gWaveformSparseThreshold),
+    fFineStep(gWaveformFineStep),
+    fFineWindow(gWaveformFineWindow),
+    fCoarseStep(gWaveformCoarseStep) {}
+
+void sbWaveformSynthesizer::SetPulseShape(sbPulseShape pulseShape) {
+    if (pulseShape == fTabulatedPulse && fPulseTable.Empty() && !LoadPulseFile()) { return; }
+    fPulseShape = pulseShape;
+}
+
+void sbWaveformSynthesizer::SetRiseTime(G4double riseTime) {
+    if (riseTime >= fFallTime) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Rise time (" << riseTime / ns << " ns) must be shorter than the fall time ("
+            << fFallTime / ns << " ns), unchanged." << G4endl;
+        G4Exception(
+            "sbWaveformSynthesizer::SetRiseTime(G4double riseTime)",
+            "InvalidPulseShape",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    fRiseTime = riseTime;
+}
+
+void sbWaveformSynthesizer::SetFallTime(G4double fallTime) {
+    if (fallTime <= fRiseTime) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Fall time (" << fallTime / ns << " ns) must be longer than the rise time ("
+            << fRiseTime / ns << " ns), unchanged." << G4endl;
+        G4Exception(
+            "sbWaveformSynthesizer::SetFallTime(G4double fallTime)",
+            "InvalidPulseShape",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    fFallTime = fallTime;
+}
+
+void sbWaveformSynthesizer::SetPulseFileName(const G4String& fileName) {
+    fPulseFileName = fileName;
+    fPulseTable = sbPulseTable();
+    if (fPulseShape == fTabulatedPulse && !LoadPulseFile()) {
+        fPulseShape = fExponentialPulse;
+    }
+}
+
+G4bool sbWaveformSynthesizer::LoadPulseFile() {
+    auto pulseProperties(CreateMapFromCSV<G4double>(fPulseFileName));
+    const auto& times = pulseProperties["SPE_time"];
+    const auto& amplitudes = pulseProperties["SPE_amplitude"];
+    G4bool valid = times.size() >= 2 && times.size() == amplitudes.size();
+    for (size_t i = 1; valid && i < times.size(); ++i) {
+        valid = times[i] > times[i - 1];
+    }
+    if (!valid) {
+        G4ExceptionDescription exceptout;
+        exceptout << fPulseFileName + " has no valid SPE_time and SPE_amplitude." << G4endl;
+        exceptout << "The exponential pulse is used." << G4endl;
+        G4Exception(
+            "sbWaveformSynthesizer::LoadPulseFile()",
+            "InvalidPulseFile",
+            JustWarning,
+            exceptout
+        );
+        return false;
+    }
+    std::vector<G4double> pulseTimes(times.size());
+    std::transform(times.begin(), times.end(), pulseTimes.begin(), [](G4double t) { return t * ns; });
+    // A new table, the kernels of all threads are rebuilt at their next event.
+    fPulseTable = sbPulseTable(pulseTimes, amplitudes);
+    G4cout << "sbWaveformSynthesizer: " << pulseTimes.size() << " pulse points loaded from "
+        << fPulseFileName << ", " << fPulseTable.GetLength() / ns << " ns long." << G4endl;
+    return true;
+}
+
+void sbWaveformSynthesizer::BuildSparseGrid(const std::vector<sbPulse>& upperPulses, const std::vector<sbPulse>& lowerPulses,
+    G4double startTime, G4double endTime, std::vector<sbWaveformRegion>& regions) const {
+    // Leading edges, the pulses after a quiet fine window in their SiPM.
+    std::vector<G4double> edges;
+    for (auto pulses : { &upperPulses, &lowerPulses }) {
+        G4double lastTime = -DBL_MAX;
+        for (const auto& pulse : *pulses) {
+            if (pulse.time - lastTime > fFineWindow) { edges.push_back(pulse.time); }
+            lastTime = pulse.time;
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    // Intervals [begin, end) of one step, consecutive intervals of the same step merged.
+    struct sbInterval { G4double begin, end, step; };
+    std::vector<sbInterval> intervals;
+    auto addInterval = [&intervals](G4double begin, G4double end, G4double step) {
+        if (end <= begin) { return; }
+        if (!intervals.empty() && intervals.back().step == step) {
+            intervals.back().end = end;
+        } else {
+            intervals.push_back(sbInterval{ begin, end, step });
+        }
+    };
+    G4double time = startTime;
+    for (G4double edge : edges) {
+        const G4double fineBegin = std::max(edge - gWaveformPreTrigger, time);
+        const G4double fineEnd = std::min(edge + fFineWindow, endTime);
+        if (fineEnd <= fineBegin) { continue; }
+        addInterval(time, fineBegin, fCoarseStep);
+        addInterval(fineBegin, fineEnd, fFineStep);
+        time = fineEnd;
+    }
+    addInterval(time, endTime, fCoarseStep);
+
+    regions.clear();
+    uint32_t firstSample = 0;
+    for (const auto& interval : intervals) {
+        const uint32_t numOfSamples = std::ceil((interval.end - interval.begin) / interval.step);
+        regions.push_back(sbWaveformRegion{ interval.begin / ns, interval.step / ns, firstSample, numOfSamples });
+        firstSample += numOfSamples;
+    }
+    // Empty window, one empty region keeps the start time.
+    if (regions.empty()) { regions.push_back(sbWaveformRegion{ startTime / ns, fCoarseStep / ns, 0, 0 }); }
+}
+
+void sbWaveformSynthesizer::Synthesize(const std::vector<sbPulse>& pulses, const std::vector<sbWaveformRegion>& regions,
+    std::vector<float>& waveform) const {
+    const size_t numOfSamples = regions.empty() ? 0 : regions.back().firstSample + regions.back().numOfSamples;
+    waveform.assign(numOfSamples, 0.0f);
+    if (pulses.empty()) { return; }
+    for (const auto& region : regions) {
+        if (region.numOfSamples == 0) { continue; }
+        const G4double startTime = region.startTime_ns * ns;
+        const G4double timeStep = region.timeStep_ns * ns;
+        float* samples = waveform.data() + region.firstSample;
+        if (fPulseShape == fTabulatedPulse) {
+            if (!fKernelCache) { fKernelCache = new sbPulseKernelCache(); }
+            sbAddTabulatedPulses(pulses, startTime, timeStep, fKernelCache->Get(fPulseTable, timeStep),
+                samples, region.numOfSamples);
+        } else if (fRiseTime <= 0.0) {
+            sbAddExponentialPulses(pulses, startTime, timeStep, fFallTime, 1.0, samples, region.numOfSamples);
+        } else {
+            const G4double amplitude = sbBiexponentialNorm(fRiseTime, fFallTime);
+            sbAddExponentialPulses(pulses, startTime, timeStep, fFallTime, amplitude, samples, region.numOfSamples);
+            sbAddExponentialPulses(pulses, startTime, timeStep, fRiseTime, -amplitude, samples, region.numOfSamples);
+        }
+    }
+}
@@ -0,0 +1,14 @@
+#include "Randomize.hh"
+
+#include "sbWorkerThreadInitialization.hh"
+#include "sbXoshiroEngine.hh"
+
+void sbWorkerThreadInitialization::SetupRNGEngine(const CLHEP::HepRandomEngine* masterEngine) const {
+    if (dynamic_cast<const sbXoshiroEngine*>(masterEngine)) {
+        // Owned by the worker thread until the end of the program, as Geant4 does.
+        // The seed does not matter, the worker is reseeded for every event.
+        G4Random::setTheEngine(new sbXoshiroEngine());
+    } else {
+        G4UserWorkerThreadInitialization::SetupRNGEngine(masterEngine);
+    }
+}
@@ -0,0 +1,176 @@
+#include <fstream>
+
+#include "CLHEP/Random/engineIDulong.h"
+
+#include "globals.hh"
+
+#include "sbXoshiroEngine.hh"
+
+// splitmix64 step, used to expand seeds into the xoshiro state.
+static inline uint64_t SplitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+sbXoshiroEngine::sbXoshiroEngine() :
+    CLHEP::HepRandomEngine() {
+    setSeed(19780503L, 0);
+}
+
+sbXoshiroEngine::sbXoshiroEngine(long seed) :
+    CLHEP::HepRandomEngine() {
+    setSeed(seed, 0);
+}
+
+void sbXoshiroEngine::flatArray(const int size, double* vect) {
+    // Local copy of the state, so that it stays in registers.
+    uint64_t s0 = fState[0], s1 = fState[1], s2 = fState[2], s3 = fState[3];
+    for (int i = 0; i < size; ++i) {
+        const uint64_t result = RotateLeft(s1 * 5, 7) * 9;
+        const uint64_t t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = RotateLeft(s3, 45);
+        vect[i] = ToDouble(result);
+    }
+    fState[0] = s0;
+    fState[1] = s1;
+    fState[2] = s2;
+    fState[3] = s3;
+}
+
+void sbXoshiroEngine::setSeed(long seed, int) {
+    const long seeds[2] = { seed, 0 };
+    setSeeds(seeds, 1);
+    theSeed = seed;
+}
+
+void sbXoshiroEngine::setSeeds(const long* seeds, int numOfSeeds) {
+    // numOfSeeds <= 0 means a zero-terminated array.
+    uint64_t x = 0x5b6f78697368726fULL;
+    G4int i = 0;
+    for (; numOfSeeds > 0 ? i < numOfSeeds : seeds[i] != 0; ++i) {
+        x ^= static_cast<uint64_t>(seeds[i]);
+        x = SplitMix64(x);
+    }
+    for (auto& s : fState) { s = SplitMix64(x); }
+    // The all-zero state is a fixed point.
+    if ((fState[0] | fState[1] | fState[2] | fState[3]) == 0) { fState[0] = 1; }
+
+    fSeeds[0] = i > 0 ? seeds[0] : 0;
+    fSeeds[1] = i > 1 ? seeds[1] : 0;
+    fSeeds[2] = 0;
+    theSeed = fSeeds[0];
+    theSeeds = fSeeds;
+}
+
+void sbXoshiroEngine::Jump() {
+    static const uint64_t jump[4] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+    uint64_t s[4] = { 0, 0, 0, 0 };
+    for (G4int i = 0; i < 4; ++i) {
+        for (G4int b = 0; b < 64; ++b) {
+            if (jump[i] & (1ULL << b)) {
+                s[0] ^= fState[0];
+                s[1] ^= fState[1];
+                s[2] ^= fState[2];
+                s[3] ^= fState[3];
+            }
+            Next();
+        }
+    }
+    for (G4int i = 0; i < 4; ++i) { fState[i] = s[i]; }
+}
+
+void sbXoshiroEngine::saveStatus(const char filename[]) const {
+    std::ofstream os(filename, std::ios::out);
+    if (!os.bad()) { put(os); }
+}
+
+void sbXoshiroEngine::restoreStatus(const char filename[]) {
+    std::ifstream is(filename, std::ios::in);
+    if (!is) {
+        G4ExceptionDescription exceptout;
+        exceptout << "Cannot open " << filename << ", engine status is not restored." << G4endl;
+        G4Exception(
+            "sbXoshiroEngine::restoreStatus(const char filename[])",
+            "CannotOpenFile",
+            JustWarning,
+            exceptout
+        );
+        return;
+    }
+    get(is);
+}
+
+void sbXoshiroEngine::showStatus() const {
+    G4cout << "----- " << name() << " engine status -----\n"
+        << " Initial seeds = " << fSeeds[0] << ' ' << fSeeds[1] << '\n'
+        << " State = " << std::hex << fState[0] << ' ' << fState[1] << ' '
+        << fState[2] << ' ' << fState[3] << std::dec << '\n'
+        << "----------------------------------------" << G4endl;
+}
+
+std::ostream& sbXoshiroEngine::put(std::ostream& os) const {
+    os << beginTag() << '\n';
+    for (auto v : put()) { os << v << '\n'; }
+    return os;
+}
+
+std::istream& sbXoshiroEngine::get(std::istream& is) {
+    std::string tag;
+    is >> tag;
+    if (tag != beginTag()) {
+        is.clear(std::ios::badbit | is.rdstate());
+        G4cerr << "sbXoshiroEngine::get: no " << beginTag() << " found in the stream." << G4endl;
+        return is;
+    }
+    return getState(is);
+}
+
+std::istream& sbXoshiroEngine::getState(std::istream& is) {
+    std::vector<unsigned long> v(11);
+    for (auto& x : v) { is >> x; }
+    if (!is || !getState(v)) {
+        is.clear(std::ios::badbit | is.rdstate());
+        G4cerr << "sbXoshiroEngine::getState: bad engine state in the stream." << G4endl;
+    }
+    return is;
+}
+
+std::vector<unsigned long> sbXoshiroEngine::put() const {
+    // Engine ID, 4 x 64-bit state and 2 seeds, as 32-bit words.
+    std::vector<unsigned long> v;
+    v.push_back(CLHEP::engineIDulong<sbXoshiroEngine>());
+    for (auto s : fState) {
+        v.push_back(static_cast<unsigned long>(s & 0xffffffffULL));
+        v.push_back(static_cast<unsigned long>(s >> 32));
+    }
+    v.push_back(static_cast<unsigned long>(fSeeds[0]));
+    v.push_back(static_cast<unsigned long>(fSeeds[1]));
+    return v;
+}
+
+bool sbXoshiroEngine::get(const std::vector<unsigned long>& v) {
+    if (v.empty() || v[0] != CLHEP::engineIDulong<sbXoshiroEngine>()) { return false; }
+    return getState(v);
+}
+
+bool sbXoshiroEngine::getState(const std::vector<unsigned long>& v) {
+    if (v.size() != 11) { return false; }
+    for (G4int i = 0; i < 4; ++i) {
+        fState[i] = (static_cast<uint64_t>(v[2 * i + 2] & 0xffffffffUL) << 32) | (v[2 * i + 1] & 0xffffffffUL);
+    }
+    fSeeds[0] = static_cast<long>(v[9]);
+    fSeeds[1] = static_cast<long>(v[10]);
+    fSeeds[2] = 0;
+    theSeed = fSeeds[0];
+    theSeeds = fSeeds;
+    return true;
+}
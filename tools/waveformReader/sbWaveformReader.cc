@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sbWaveformReader.hh"
+
+sbWaveformReader::sbWaveformReader(const std::string& fileName) :
+    fFileName(fileName),
+    fData(nullptr),
+    fSize(0),
+    fIndex(nullptr),
+    fNumOfEvents(0),
+    fSortedIndex() {
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) { throw std::runtime_error("Cannot open " + fileName); }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot stat " + fileName);
+    }
+    fSize = fileStat.st_size;
+    if (fSize >= sizeof(sbWaveformFileHeader) + sizeof(sbWaveformFileTrailer)) {
+        void* data = mmap(nullptr, fSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) { fData = static_cast<const unsigned char*>(data); }
+    }
+    close(fd);
+    if (!fData) { throw std::runtime_error(fileName + " is too short or cannot be mapped."); }
+
+    sbWaveformFileHeader header;
+    sbWaveformFileTrailer trailer;
+    std::memcpy(&header, fData, sizeof(header));
+    std::memcpy(&trailer, fData + fSize - sizeof(trailer), sizeof(trailer));
+    if (std::memcmp(header.magic, "SBWAVEFM", 8) != 0 || header.version < 1 || header.version > gWaveformFileVersion) {
+        munmap(const_cast<unsigned char*>(fData), fSize);
+        throw std::runtime_error(fileName + " is not a waveform container (version 1 to "
+            + std::to_string(gWaveformFileVersion) + ").");
+    }
+    if (std::memcmp(trailer.magic, "SBWFINDX", 8) != 0 ||
+        trailer.indexOffset + trailer.numOfEvents * sizeof(sbWaveformIndexEntry) + sizeof(trailer) != fSize) {
+        munmap(const_cast<unsigned char*>(fData), fSize);
+        throw std::runtime_error(fileName + " has no index, the run did not end.");
+    }
+    fIndex = reinterpret_cast<const sbWaveformIndexEntry*>(fData + trailer.indexOffset);
+    fNumOfEvents = trailer.numOfEvents;
+    fSortedIndex.resize(fNumOfEvents);
+    for (size_t i = 0; i < fNumOfEvents; ++i) { fSortedIndex[i] = i; }
+    std::sort(fSortedIndex.begin(), fSortedIndex.end(),
+        [this](uint32_t lhs, uint32_t rhs) { return fIndex[lhs].eventID < fIndex[rhs].eventID; });
+}
+
+sbWaveformReader::~sbWaveformReader() {
+    munmap(const_cast<unsigned char*>(fData), fSize);
+}
+
+const sbWaveformIndexEntry* sbWaveformReader::Find(int32_t eventID) const {
+    auto position = std::lower_bound(fSortedIndex.begin(), fSortedIndex.end(), eventID,
+        [this](uint32_t i, int32_t id) { return fIndex[i].eventID < id; });
+    if (position == fSortedIndex.end() || fIndex[*position].eventID != eventID) { return nullptr; }
+    return &fIndex[*position];
+}
+
+sbWaveformEvent sbWaveformReader::ReadEvent(const sbWaveformIndexEntry& entry) const {
+    sbWaveformEvent event;
+    const unsigned char* data = fData + entry.offset;
+    const unsigned char* end = data + entry.size;
+    if (entry.offset + entry.size > fSize || entry.size < sizeof(sbWaveformEventHeader)) {
+        throw std::runtime_error("Event record out of " + fFileName);
+    }
+    std::memcpy(&event.header, data, sizeof(event.header));
+    data += sizeof(event.header);
+    const sbWaveformEventHeader& header = event.header;
+    const std::runtime_error corrupted("Corrupted record of event " + std::to_string(header.eventID));
+    size_t waveformBytes;
+    if (header.flags & fSparseWaveforms) {
+        sbSparseWaveformHeader sparseHeader;
+        if (size_t(end - data) < sizeof(sparseHeader)) { throw corrupted; }
+        std::memcpy(&sparseHeader, data, sizeof(sparseHeader));
+        data += sizeof(sparseHeader);
+        const size_t regionBytes = size_t(sparseHeader.numOfRegions) * sizeof(sbWaveformRegion);
+        const size_t runBytes = (size_t(sparseHeader.numOfUpperRuns) + sparseHeader.numOfLowerRuns) * sizeof(sbWaveformRun);
+        if (size_t(end - data) < regionBytes + runBytes) { throw corrupted; }
+        event.regions.resize(sparseHeader.numOfRegions);
+        std::memcpy(event.regions.data(), data, regionBytes);
+        event.upperRuns = reinterpret_cast<const sbWaveformRun*>(data + regionBytes);
+        event.lowerRuns = event.upperRuns + sparseHeader.numOfUpperRuns;
+        event.numOfUpperRuns = sparseHeader.numOfUpperRuns;
+        event.numOfLowerRuns = sparseHeader.numOfLowerRuns;
+        data += regionBytes + runBytes;
+        size_t numOfUpperStored = 0;
+        size_t numOfLowerStored = 0;
+        for (size_t r = 0; r < event.numOfUpperRuns + event.numOfLowerRuns; ++r) {
+            const sbWaveformRun& run = event.upperRuns[r];
+            if (size_t(run.firstSample) + run.numOfSamples > header.numOfSamples) { throw corrupted; }
+            (r < event.numOfUpperRuns ? numOfUpperStored : numOfLowerStored) += run.numOfSamples;
+        }
+        event.upperWaveform = reinterpret_cast<const float*>(data);
+        event.lowerWaveform = event.upperWaveform + numOfUpperStored;
+        waveformBytes = (numOfUpperStored + numOfLowerStored) * sizeof(float);
+    } else {
+        event.regions.assign(1, sbWaveformRegion{ header.startTime_ns, header.timeStep_ns, 0, header.numOfSamples });
+        event.upperRuns = event.lowerRuns = nullptr;
+        event.numOfUpperRuns = event.numOfLowerRuns = 0;
+        event.upperWaveform = reinterpret_cast<const float*>(data);
+        event.lowerWaveform = event.upperWaveform + header.numOfSamples;
+        waveformBytes = 2 * header.numOfSamples * sizeof(float);
+    }
+    // Consecutive regions over the dense samples.
+    uint32_t numOfSamples = 0;
+    for (const auto& region : event.regions) {
+        if (region.firstSample != numOfSamples) { throw corrupted; }
+        numOfSamples += region.numOfSamples;
+    }
+    if (numOfSamples != header.numOfSamples) { throw corrupted; }
+
+    const size_t numOfHits = size_t(header.numOfUpperHits) + header.numOfLowerHits;
+    const size_t weightBytes = header.flags & fHitWeights ? numOfHits * sizeof(float) : 0;
+    const size_t payloadBytes = waveformBytes + header.hitBytes + weightBytes;
+    if (size_t(end - data) < payloadBytes || size_t(end - data) >= payloadBytes + gWaveformRecordAlignment) {
+        throw corrupted;
+    }
+    data += waveformBytes;
+    const unsigned char* hitsEnd = data + header.hitBytes;
+    if (!sbReadHitTimes(data, hitsEnd, header.numOfUpperHits, header.firstHitTime_ns, event.upperHitTimes_ns) ||
+        !sbReadHitTimes(data, hitsEnd, header.numOfLowerHits, header.firstHitTime_ns, event.lowerHitTimes_ns)) {
+        throw std::runtime_error("Corrupted hits of event " + std::to_string(header.eventID));
+    }
+    event.hitWeights.assign(numOfHits, 1.0f);
+    if (weightBytes) { std::memcpy(event.hitWeights.data(), hitsEnd, weightBytes); }
+    return event;
+}
+
+void sbWaveformReader::ExpandWaveforms(const sbWaveformEvent& event, std::vector<double>& times_ns,
+    std::vector<float>& upperWaveform, std::vector<float>& lowerWaveform) {
+    const size_t numOfSamples = event.header.numOfSamples;
+    times_ns.resize(numOfSamples);
+    for (const auto& region : event.regions) {
+        for (uint32_t k = 0; k < region.numOfSamples; ++k) {
+            times_ns[region.firstSample + k] = region.startTime_ns + k * region.timeStep_ns;
+        }
+    }
+    if (event.header.flags & fSparseWaveforms) {
+        // Runs are checked by ReadEvent.
+        sbExpandRuns(event.upperRuns, event.numOfUpperRuns, event.upperWaveform, numOfSamples, upperWaveform);
+        sbExpandRuns(event.lowerRuns, event.numOfLowerRuns, event.lowerWaveform, numOfSamples, lowerWaveform);
+    } else {
+        upperWaveform.assign(event.upperWaveform, event.upperWaveform + numOfSamples);
+        lowerWaveform.assign(event.lowerWaveform, event.lowerWaveform + numOfSamples);
+    }
+}
+
+void sbWaveformReader::WriteWaveformCSV(const sbWaveformEvent& event, std::ostream& out) {
+    std::vector<double> times_ns;
+    std::vector<float> upperWaveform, lowerWaveform;
+    ExpandWaveforms(event, times_ns, upperWaveform, lowerWaveform);
+    out << "time(ns),UpperSiPMPhotoelectricResponse,LowerSiPMPhotoelectricResponse\n";
+    for (size_t i = 0; i < times_ns.size(); ++i) {
+        out << times_ns[i] << ',' << upperWaveform[i] << ',' << lowerWaveform[i] << '\n';
+    }
+}
+
+void sbWaveformReader::WriteHitsCSV(const sbWaveformEvent& event, std::ostream& out) {
+    out << "SiPMID,HitTime(ns),Weight\n";
+    size_t hitIndex = 0;
+    for (const double time : event.upperHitTimes_ns) { out << 0 << ',' << time << ',' << event.hitWeights[hitIndex++] << '\n'; }
+    for (const double time : event.lowerHitTimes_ns) { out << 1 << ',' << time << ',' << event.hitWeights[hitIndex++] << '\n'; }
+}
@@ -0,0 +1,65 @@
+#ifndef SB_WAVEFORM_READER_H
+#define SB_WAVEFORM_READER_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "sbWaveformFormat.hh"
+
+// One event of a waveform container. The waveforms point into the mapped file,
+// the hits are decoded. Sparse waveforms (fSparseWaveforms) point to the samples of
+// their runs, ExpandWaveforms gives the dense form of both kinds.
+struct sbWaveformEvent {
+    sbWaveformEventHeader header;
+    std::vector<sbWaveformRegion> regions;  // One for dense waveforms.
+    const float* upperWaveform;
+    const float* lowerWaveform;
+    const sbWaveformRun* upperRuns;         // Sparse only.
+    const sbWaveformRun* lowerRuns;
+    size_t numOfUpperRuns;
+    size_t numOfLowerRuns;
+    std::vector<double> upperHitTimes_ns;
+    std::vector<double> lowerHitTimes_ns;
+    std::vector<float> hitWeights;      // Upper hits, then lower, 1 without fHitWeights.
+};
+
+// Read-only memory-mapped waveform container (see sbWaveformFormat.hh), no Geant4
+// needed. Throws std::runtime_error on files it cannot use.
+class sbWaveformReader {
+public:
+    explicit sbWaveformReader(const std::string& fileName);
+    ~sbWaveformReader();
+    sbWaveformReader(const sbWaveformReader&) = delete;
+    sbWaveformReader& operator=(const sbWaveformReader&) = delete;
+
+    size_t GetNumOfEvents() const { return fNumOfEvents; }
+    // Index entries in file order.
+    const sbWaveformIndexEntry& GetIndexEntry(size_t i) const { return fIndex[i]; }
+    // Index entry of an event, nullptr if it has no record.
+    const sbWaveformIndexEntry* Find(int32_t eventID) const;
+
+    sbWaveformEvent ReadEvent(const sbWaveformIndexEntry& entry) const;
+
+    // Dense samples and their times, exactly the synthesized samples (zero below the
+    // threshold in magnitude for sparse waveforms).
+    static void ExpandWaveforms(const sbWaveformEvent& event, std::vector<double>& times_ns,
+        std::vector<float>& upperWaveform, std::vector<float>& lowerWaveform);
+
+    // Same columns as the former SiPMresponse/pr<N>.csv.
+    static void WriteWaveformCSV(const sbWaveformEvent& event, std::ostream& out);
+    static void WriteHitsCSV(const sbWaveformEvent& event, std::ostream& out);
+
+private:
+    std::string fFileName;
+    const unsigned char* fData;
+    size_t fSize;
+    const sbWaveformIndexEntry* fIndex;
+    size_t fNumOfEvents;
+    // Positions in fIndex sorted by event ID.
+    std::vector<uint32_t> fSortedIndex;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "sbWaveformResynthesizer.hh"
+
+namespace {
+    // Seed of the event, neighbouring event IDs give unrelated streams.
+    inline uint64_t EventSeed(uint64_t seed, int32_t eventID) {
+        uint64_t z = seed + (uint64_t(uint32_t(eventID)) + 1) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    std::vector<double> ParseRow(const std::string& line) {
+        std::vector<double> values;
+        std::istringstream in(line);
+        std::string cell;
+        std::getline(in, cell, ',');    // Key
+        while (std::getline(in, cell, ',')) {
+            if (cell.empty() || cell[0] == '#') { break; }
+            values.push_back(std::stod(cell));
+        }
+        return values;
+    }
+}
+
+void sbResynthesisSettings::LoadPulseFile(const std::string& fileName) {
+    std::ifstream in(fileName);
+    if (!in) { throw std::runtime_error("Cannot open " + fileName); }
+    std::vector<double> times, amplitudes;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 9, "SPE_time,") == 0 && times.empty()) { times = ParseRow(line); }
+        if (line.compare(0, 14, "SPE_amplitude,") == 0 && amplitudes.empty()) { amplitudes = ParseRow(line); }
+    }
+    bool valid = times.size() >= 2 && times.size() == amplitudes.size();
+    for (size_t i = 1; valid && i < times.size(); ++i) { valid = times[i] > times[i - 1]; }
+    if (!valid) { throw std::runtime_error(fileName + " has no valid SPE_time and SPE_amplitude."); }
+    pulseTimes = times;
+    pulseAmplitudes = amplitudes;
+    tabulatedPulse = true;
+}
+
+sbWaveformResynthesizer::sbWaveformResynthesizer(const sbResynthesisSettings& settings) :
+    fSettings(settings),
+    fPulseTable(settings.tabulatedPulse ? sbPulseTable(settings.pulseTimes, settings.pulseAmplitudes) : sbPulseTable()) {
+    if (fSettings.tabulatedPulse && fPulseTable.Empty()) {
+        throw std::invalid_argument("Tabulated pulse without a pulse file.");
+    }
+    if (!fSettings.tabulatedPulse && !(fSettings.riseTime < fSettings.fallTime)) {
+        throw std::invalid_argument("Rise time must be shorter than the fall time.");
+    }
+    if (fSettings.numOfSamples < 2) { throw std::invalid_argument("At least 2 samples."); }
+}
+
+void sbWaveformResynthesizer::Resynthesize(const sbWaveformEvent& event, sbResynthesizedEvent& result) const {
+    const auto& upperHitTimes = event.upperHitTimes_ns;
+    const auto& lowerHitTimes = event.lowerHitTimes_ns;
+    result.eventID = event.header.eventID;
+    result.weight = event.header.weight;
+
+    // Window of sbSiPMSD::FillNtuple unless a fixed one is set.
+    auto meanTime = [](const std::vector<double>& times) {
+        double sum = 0.0;
+        for (double time : times) { sum += time; }
+        return times.empty() ? 0.0 : sum / times.size();
+    };
+    const double upperFirstHitTime = upperHitTimes.empty() ? 0.0 : upperHitTimes.front();
+    const double lowerFirstHitTime = lowerHitTimes.empty() ? 0.0 : lowerHitTimes.front();
+    double startTime, endTime;
+    if (upperHitTimes.empty()) {
+        startTime = std::max(0.0, lowerFirstHitTime - fSettings.preTrigger);
+        endTime = 6.0 * meanTime(lowerHitTimes);
+    } else if (lowerHitTimes.empty()) {
+        startTime = std::max(0.0, upperFirstHitTime - fSettings.preTrigger);
+        endTime = 6.0 * meanTime(upperHitTimes);
+    } else {
+        startTime = std::max(0.0, std::min(upperFirstHitTime, lowerFirstHitTime) - fSettings.preTrigger);
+        endTime = 5.0 * std::max(meanTime(upperHitTimes), meanTime(lowerHitTimes));
+    }
+    if (fSettings.window > 0.0) { endTime = startTime + fSettings.window; }
+    result.startTime = startTime;
+    result.timeStep = (endTime - startTime) / (fSettings.numOfSamples - 1);
+
+    // Per thread buffers, reused by every event.
+    static thread_local std::vector<sbPulse> upperPulses;
+    static thread_local std::vector<sbPulse> lowerPulses;
+    std::mt19937_64 engine(EventSeed(fSettings.seed, event.header.eventID));
+    const float* weights = event.hitWeights.data();
+    CollectPulses(upperHitTimes, weights, startTime, engine, upperPulses);
+    CollectPulses(lowerHitTimes, weights + upperHitTimes.size(), startTime, engine, lowerPulses);
+    Synthesize(upperPulses, result.startTime, result.timeStep, result.upperWaveform);
+    Synthesize(lowerPulses, result.startTime, result.timeStep, result.lowerWaveform);
+    ExtractFeatures(upperHitTimes, upperPulses, result.startTime, result.timeStep, result.upperWaveform, result.upperFeatures);
+    ExtractFeatures(lowerHitTimes, lowerPulses, result.startTime, result.timeStep, result.lowerWaveform, result.lowerFeatures);
+}
+
+void sbWaveformResynthesizer::CollectPulses(const std::vector<double>& hitTimes, const float* hitWeights,
+    double startTime, std::mt19937_64& engine, std::vector<sbPulse>& pulses) const {
+    pulses.clear();
+    if (!fSettings.Noisy()) {
+        // One photoelectron per photon, as without the digitizer.
+        for (size_t i = 0; i < hitTimes.size(); ++i) { pulses.push_back(sbPulse{ hitTimes[i], hitWeights[i] }); }
+        return;
+    }
+
+    // Avalanches to process, any order: the photoelectrons and dark counts, then their
+    // crosstalk and afterpulses. Crosstalk is prompt, so the pulses are sorted at the end.
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    static thread_local std::vector<sbPulse> avalanches;
+    avalanches.clear();
+    for (size_t i = 0; i < hitTimes.size(); ++i) {
+        const int numOfPhotons = sbNumOfPhotons(hitWeights[i], uniform(engine));
+        for (int j = 0; j < numOfPhotons; ++j) {
+            if (fSettings.efficiency < 1.0 && uniform(engine) >= fSettings.efficiency) { continue; }
+            avalanches.push_back(sbPulse{ hitTimes[i], 1.0 });
+        }
+    }
+    if (fSettings.darkCountRate > 0.0) {
+        std::poisson_distribution<int> darkCounts(sbDarkCountMean(fSettings.darkCountRate, fSettings.readoutWindow));
+        for (int n = darkCounts(engine); n > 0; --n) {
+            avalanches.push_back(sbPulse{ sbDarkCountTime(startTime, fSettings.readoutWindow, uniform(engine)), 1.0 });
+        }
+    }
+    while (!avalanches.empty()) {
+        const sbPulse avalanche = avalanches.back();
+        avalanches.pop_back();
+        pulses.push_back(avalanche);
+        if (fSettings.crosstalkProbability > 0.0) {
+            std::poisson_distribution<int> crosstalks(sbCrosstalkMean(fSettings.crosstalkProbability, avalanche.amplitude));
+            for (int n = crosstalks(engine); n > 0; --n) { avalanches.push_back(sbPulse{ avalanche.time, 1.0 }); }
+        }
+        if (fSettings.afterpulseProbability > 0.0 &&
+            sbAfterpulses(fSettings.afterpulseProbability, avalanche.amplitude, uniform(engine))) {
+            // The microcell has recovered for the delay only. uniform is in [0, 1), 1 - u in (0, 1].
+            const double delay = sbAfterpulseDelay(fSettings.afterpulseTimeConstant, 1.0 - uniform(engine));
+            const double charge = sbRecoveredCharge(delay, fSettings.recoveryTime);
+            if (charge > 0.0) { avalanches.push_back(sbPulse{ avalanche.time + delay, charge }); }
+        }
+    }
+    std::sort(pulses.begin(), pulses.end(), sbEarlierPulse);
+}
+
+void sbWaveformResynthesizer::Synthesize(const std::vector<sbPulse>& pulses, double startTime, double timeStep,
+    std::vector<float>& waveform) const {
+    waveform.assign(fSettings.numOfSamples, 0.0f);
+    if (pulses.empty()) { return; }
+    if (fSettings.tabulatedPulse) {
+        // The step changes with the window of every event, kernels are rebuilt when it does.
+        static thread_local sbPulseKernelCache kernelCache;
+        sbAddTabulatedPulses(pulses, startTime, timeStep, kernelCache.Get(fPulseTable, timeStep),
+            waveform.data(), waveform.size());
+    } else if (fSettings.riseTime <= 0.0) {
+        sbAddExponentialPulses(pulses, startTime, timeStep, fSettings.fallTime, 1.0, waveform.data(), waveform.size());
+    } else {
+        // Normalized to a peak of 1, as sbWaveformSynthesizer.
+        const double norm = sbBiexponentialNorm(fSettings.riseTime, fSettings.fallTime);
+        sbAddExponentialPulses(pulses, startTime, timeStep, fSettings.fallTime, norm, waveform.data(), waveform.size());
+        sbAddExponentialPulses(pulses, startTime, timeStep, fSettings.riseTime, -norm, waveform.data(), waveform.size());
+    }
+}
+
+void sbWaveformResynthesizer::ExtractFeatures(const std::vector<double>& hitTimes, const std::vector<sbPulse>& pulses,
+    double startTime, double timeStep, const std::vector<float>& waveform, sbResynthesizedFeatures& features) const {
+    const double noTime = std::numeric_limits<double>::quiet_NaN();
+    features.firstPhotonTime = hitTimes.empty() ? noTime : hitTimes.front();
+    features.numOfPhotoelectrons = 0.0;
+    for (const auto& pulse : pulses) { features.numOfPhotoelectrons += pulse.amplitude; }
+
+    // One uniform region, as a dense waveform of sbFeatureExtractor.
+    const std::vector<sbWaveformRegion> regions = { sbWaveformRegion{ startTime, timeStep, 0, uint32_t(waveform.size()) } };
+    const sbWaveformMeasures measures = sbMeasureWaveform(waveform.data(), regions, fSettings.CFDFraction);
+    features.amplitude = measures.amplitude;
+    features.charge = measures.charge;
+    features.CFDTime = measures.CFDTime;
+}
+
+void sbWaveformResynthesizer::WriteFeaturesCSVHeader(std::ostream& out) {
+    out << "EventID";
+    for (const char* SiPM : { "Upper", "Lower" }) {
+        out << ',' << SiPM << "FirstPhotonTime[ns]," << SiPM << "CFDTime[ns]," << SiPM << "Amplitude[a.u.],"
+            << SiPM << "Charge[a.u.*ns]," << SiPM << "NumOfPhotoelectrons";
+    }
+    out << ",TimeDifference[ns],Weight\n";
+}
+
+void sbWaveformResynthesizer::WriteFeaturesCSV(const sbResynthesizedEvent& result, std::ostream& out) {
+    out << result.eventID;
+    for (const auto features : { &result.upperFeatures, &result.lowerFeatures }) {
+        out << ',' << features->firstPhotonTime << ',' << features->CFDTime << ',' << features->amplitude
+            << ',' << features->charge << ',' << features->numOfPhotoelectrons;
+    }
+    out << ',' << result.upperFeatures.CFDTime - result.lowerFeatures.CFDTime << ',' << result.weight << '\n';
+}
+
+void sbWaveformResynthesizer::WriteWaveformCSV(const sbResynthesizedEvent& result, std::ostream& out) {
+    out << "time(ns),UpperSiPMPhotoelectricResponse,LowerSiPMPhotoelectricResponse\n";
+    for (size_t i = 0; i < result.upperWaveform.size(); ++i) {
+        out << result.startTime + i * result.timeStep << ','
+            << result.upperWaveform[i] << ',' << result.lowerWaveform[i] << '\n';
+    }
+}
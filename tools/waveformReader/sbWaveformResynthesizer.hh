@@ -0,0 +1,96 @@
+#ifndef SB_WAVEFORM_RESYNTHESIZER_H
+#define SB_WAVEFORM_RESYNTHESIZER_H 1
+
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sbWaveformReader.hh"
+#include "sbSiPMResponseCore.hh"
+
+// Settings of a re-synthesis, times in ns. The defaults are those of smallbox without
+// the digitizer, so the stored dense waveforms are reproduced.
+struct sbResynthesisSettings {
+    // Single photoelectron pulse, see sbWaveformSynthesizer.
+    bool tabulatedPulse = false;
+    double riseTime = 0.0;
+    double fallTime = 1.0;
+    std::vector<double> pulseTimes;         // Tabulated pulse, ascending.
+    std::vector<double> pulseAmplitudes;
+    // Uniform samples from the pre-trigger before the first hit, over the window, or the
+    // window of sbSiPMSD (a multiple of the mean hit time) if it is 0.
+    uint32_t numOfSamples = 1024;
+    double preTrigger = 1.0;
+    double window = 0.0;
+    // Noise of sbSiPMDigitizer without microcells, off by default: every hit weight is
+    // floor(w) photoelectrons plus one with the probability of the fraction, each kept
+    // with the efficiency.
+    double efficiency = 1.0;
+    double crosstalkProbability = 0.0;
+    double afterpulseProbability = 0.0;
+    double afterpulseTimeConstant = 50.0;
+    double recoveryTime = 40.0;
+    double darkCountRate = 0.0;             // per ns
+    double readoutWindow = 1000.0;          // Dark counts from the first sample.
+    uint64_t seed = 0;
+    // Feature extraction, see sbFeatureExtractor.
+    double CFDFraction = 0.2;
+
+    bool Noisy() const {
+        return efficiency < 1.0 || crosstalkProbability > 0.0 || afterpulseProbability > 0.0 || darkCountRate > 0.0;
+    }
+    // SPE_time and SPE_amplitude rows of a csv file like datafiles/SiPMProperties.csv.
+    void LoadPulseFile(const std::string& fileName);
+};
+
+// Same definitions as sbPulseFeatures, times in ns, NaN without photons.
+struct sbResynthesizedFeatures {
+    double firstPhotonTime;
+    double CFDTime;
+    double amplitude;
+    double charge;
+    double numOfPhotoelectrons;
+};
+
+// Waveforms and features of one event regenerated from its stored hits, buffers reused.
+struct sbResynthesizedEvent {
+    int32_t eventID;
+    double weight;
+    double startTime;
+    double timeStep;
+    std::vector<float> upperWaveform;
+    std::vector<float> lowerWaveform;
+    sbResynthesizedFeatures upperFeatures;
+    sbResynthesizedFeatures lowerFeatures;
+};
+
+// Regenerates the waveforms of a container from the photon hits with other pulse shapes,
+// sampling and noise, without Geant4, by the SiPM response core of smallbox
+// (sbSiPMResponseCore.hh). Const and stateless, one instance serves all threads. The noise of an event depends only on the seed and its event ID, so results
+// do not depend on the number of threads.
+class sbWaveformResynthesizer {
+public:
+    explicit sbWaveformResynthesizer(const sbResynthesisSettings& settings);
+
+    void Resynthesize(const sbWaveformEvent& event, sbResynthesizedEvent& result) const;
+
+    static void WriteFeaturesCSVHeader(std::ostream& out);
+    static void WriteFeaturesCSV(const sbResynthesizedEvent& result, std::ostream& out);
+    static void WriteWaveformCSV(const sbResynthesizedEvent& result, std::ostream& out);
+
+private:
+    void CollectPulses(const std::vector<double>& hitTimes, const float* hitWeights, double startTime,
+        std::mt19937_64& engine, std::vector<sbPulse>& pulses) const;
+    void Synthesize(const std::vector<sbPulse>& pulses, double startTime, double timeStep,
+        std::vector<float>& waveform) const;
+    void ExtractFeatures(const std::vector<double>& hitTimes, const std::vector<sbPulse>& pulses,
+        double startTime, double timeStep, const std::vector<float>& waveform,
+        sbResynthesizedFeatures& features) const;
+
+    const sbResynthesisSettings fSettings;
+    const sbPulseTable fPulseTable;
+};
+
+#endif
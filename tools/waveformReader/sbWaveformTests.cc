@@ -0,0 +1,246 @@
+// Tests of the waveform container, the writer queue and the shared pulse kernels, run by ctest.
+//
+//   sbWaveformTests <scratch file>   : Exit status 0 if all checks pass, failures to stderr.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sbBoundedQueue.hh"
+#include "sbSiPMResponseCore.hh"
+#include "sbWaveformReader.hh"
+
+namespace {
+    int numOfFailures = 0;
+
+    void Check(bool condition, const std::string& what) {
+        if (condition) { return; }
+        ++numOfFailures;
+        std::cerr << "FAILED: " << what << std::endl;
+    }
+
+    template<typename T>
+    void AppendBytes(std::string& buffer, const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    void AppendBytes(std::string& buffer, const std::vector<T>& values) {
+        buffer.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    void TestVarints() {
+        const uint64_t values[] = { 0, 1, 127, 128, 300, 16383, 16384, uint64_t(1) << 35, UINT64_MAX };
+        std::string buffer;
+        for (uint64_t value : values) { sbAppendVarint(buffer, value); }
+        Check(buffer.size() == 1 + 1 + 1 + 2 + 2 + 2 + 3 + 6 + 10, "varint lengths");
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(buffer.data());
+        const unsigned char* end = data + buffer.size();
+        for (uint64_t value : values) {
+            uint64_t decoded;
+            Check(sbReadVarint(data, end, decoded) && decoded == value, "varint " + std::to_string(value));
+        }
+        Check(data == end, "varints consume the buffer");
+        // A truncated varint is an error, not a short value.
+        std::string truncated;
+        sbAppendVarint(truncated, 300);
+        data = reinterpret_cast<const unsigned char*>(truncated.data());
+        uint64_t decoded;
+        Check(!sbReadVarint(data, data + 1, decoded), "truncated varint");
+    }
+
+    // One sparse record as smallbox encodes it: two regions, runs on both SiPMs, weighted hits.
+    std::string MakeSparseRecord(int32_t eventID, const std::vector<float>& upper, const std::vector<float>& lower,
+        const std::vector<double>& upperHits, const std::vector<double>& lowerHits, float threshold) {
+        const uint32_t numOfSamples = upper.size();
+        const std::vector<sbWaveformRegion> regions = {
+            { 10.0, 0.5, 0, 8 },
+            { 14.0, 2.0, 8, numOfSamples - 8 }
+        };
+        std::vector<float> weights(upperHits.size() + lowerHits.size());
+        for (size_t i = 0; i < weights.size(); ++i) { weights[i] = 1.0f + i; }
+        return sbEncodeEventRecord(eventID, 0.25, upperHits, lowerHits, weights, regions, upper, lower, threshold);
+    }
+
+    // One region and a negative threshold keep the dense layout, weights of 1 are not stored.
+    void TestDenseRecord() {
+        const std::vector<float> upper = { 0, 1, 2, 0 };
+        const std::vector<float> lower = { 3, 0, 0, 4 };
+        const std::vector<double> upperHits = { 5.0 };
+        const std::vector<double> lowerHits = { 4.5, 6.0 };
+        const std::vector<sbWaveformRegion> regions = { { 4.0, 1.0, 0, 4 } };
+        const std::string record = sbEncodeEventRecord(
+            9, 1.0, upperHits, lowerHits, std::vector<float>(3, 1.0f), regions, upper, lower, -1.0);
+        sbWaveformEventHeader header;
+        std::memcpy(&header, record.data(), sizeof(header));
+        Check(header.eventID == 9 && header.flags == 0 && header.numOfSamples == 4, "dense record header");
+        Check(header.firstHitTime_ns == 4.5 && header.startTime_ns == 4.0 && header.timeStep_ns == 1.0,
+            "dense record times");
+        Check(record.size() % gWaveformRecordAlignment == 0 &&
+            record.size() >= sizeof(header) + 8 * sizeof(float) + header.hitBytes &&
+            record.size() < sizeof(header) + 8 * sizeof(float) + header.hitBytes + gWaveformRecordAlignment,
+            "dense record size");
+        Check(std::memcmp(record.data() + sizeof(header), upper.data(), 4 * sizeof(float)) == 0 &&
+            std::memcmp(record.data() + sizeof(header) + 4 * sizeof(float), lower.data(), 4 * sizeof(float)) == 0,
+            "dense waveforms");
+    }
+
+    void TestRecordRoundTrip(const std::string& fileName) {
+        std::vector<float> upper = { 0, 0, 3, 4, 0, 0, 0, 5, 6, 0, 0, 7 };
+        // Negative samples (undershoot, noise) are kept as well.
+        std::vector<float> lower = { 1, -0.5f, 0, 0, 0, -1e-6f, 0, 0, 0, 0, 2, 2 };
+        const std::vector<double> upperHits = { 12.345, 12.346, 40.0 };
+        const std::vector<double> lowerHits = { 11.0, 300.125 };
+
+        sbWaveformFileHeader fileHeader;
+        std::memset(&fileHeader, 0, sizeof(fileHeader));
+        std::memcpy(fileHeader.magic, "SBWAVEFM", 8);
+        fileHeader.version = gWaveformFileVersion;
+        std::string file;
+        AppendBytes(file, fileHeader);
+        std::vector<sbWaveformIndexEntry> index;
+        for (int32_t eventID : { 7, 3 }) {
+            const std::string record = MakeSparseRecord(eventID, upper, lower, upperHits, lowerHits, 0.0f);
+            index.push_back(sbWaveformIndexEntry{ eventID, 0, file.size(), record.size() });
+            file += record;
+        }
+        sbWaveformFileTrailer trailer;
+        std::memset(&trailer, 0, sizeof(trailer));
+        trailer.indexOffset = file.size();
+        trailer.numOfEvents = index.size();
+        std::memcpy(trailer.magic, "SBWFINDX", 8);
+        AppendBytes(file, index);
+        AppendBytes(file, trailer);
+        std::FILE* out = std::fopen(fileName.c_str(), "wb");
+        Check(out && std::fwrite(file.data(), 1, file.size(), out) == file.size() && std::fclose(out) == 0,
+            "write " + fileName);
+
+        sbWaveformReader reader(fileName);
+        Check(reader.GetNumOfEvents() == 2, "number of events");
+        Check(!reader.Find(5), "no record of a missing event");
+        const sbWaveformIndexEntry* entry = reader.Find(3);
+        Check(entry && entry->offset == index[1].offset, "find by event ID");
+        if (!entry) { return; }
+        const sbWaveformEvent event = reader.ReadEvent(*entry);
+        Check(event.header.eventID == 3 && event.header.weight == 0.25, "event header");
+        Check(event.numOfUpperRuns == 3 && event.numOfLowerRuns == 3, "runs of both SiPMs");
+
+        std::vector<double> times;
+        std::vector<float> expandedUpper, expandedLower;
+        sbWaveformReader::ExpandWaveforms(event, times, expandedUpper, expandedLower);
+        Check(expandedUpper == upper && expandedLower == lower, "sparse waveforms expand to the dense ones");
+        Check(times.size() == upper.size() && times[7] == 13.5 && times[8] == 14.0 && times[11] == 20.0,
+            "sample times of the regions");
+
+        Check(event.upperHitTimes_ns.size() == upperHits.size() && event.lowerHitTimes_ns.size() == lowerHits.size(),
+            "numbers of hits");
+        for (size_t i = 0; i < upperHits.size() && i < event.upperHitTimes_ns.size(); ++i) {
+            Check(std::fabs(event.upperHitTimes_ns[i] - upperHits[i]) <= gWaveformHitTimeQuantum_ns / 2, "upper hit time");
+        }
+        for (size_t i = 0; i < lowerHits.size() && i < event.lowerHitTimes_ns.size(); ++i) {
+            Check(std::fabs(event.lowerHitTimes_ns[i] - lowerHits[i]) <= gWaveformHitTimeQuantum_ns / 2, "lower hit time");
+        }
+        Check(event.hitWeights.size() == 5 && event.hitWeights[0] == 1.0f && event.hitWeights[4] == 5.0f, "hit weights");
+        std::remove(fileName.c_str());
+    }
+
+    // Kernels of two tables at the same time step are told apart, a new table is resampled.
+    void TestPulseKernelCache() {
+        const sbPulseTable narrow({ 0.0, 1.0, 2.0 }, { 0.0, 1.0, 0.0 });
+        const sbPulseTable wide({ 0.0, 2.0, 4.0 }, { 0.0, 2.0, 0.0 });
+        Check(narrow.GetID() != wide.GetID(), "tables have their own IDs");
+        sbPulseKernelCache cache;
+        const double timeStep = 0.5;
+        const sbPulseKernel& narrowKernel = cache.Get(narrow, timeStep);
+        Check(narrowKernel.length == 5 && narrowKernel.table[2] == 1.0f, "kernel of the narrow table");
+        const sbPulseKernel& wideKernel = cache.Get(wide, timeStep);
+        Check(wideKernel.pulseID == wide.GetID() && wideKernel.length == 9 && wideKernel.table[4] == 2.0f,
+            "kernel of the wide table at the same step");
+
+        // A pulse on a sample adds the table there, its first sample at phase 0.
+        std::vector<float> waveform(12, 0.0f);
+        const std::vector<sbPulse> pulses = { { 1.0, 2.0 } };
+        sbAddTabulatedPulses(pulses, 0.0, timeStep, cache.Get(wide, timeStep), waveform.data(), waveform.size());
+        Check(waveform[1] == 0.0f && waveform[6] == 4.0f && waveform[10] == 0.0f, "tabulated pulse samples");
+    }
+
+    // Producers and consumers at once, every value comes out exactly once.
+    void TestBoundedQueue() {
+        constexpr int numOfProducers = 4;
+        constexpr int numOfConsumers = 4;
+        constexpr uint64_t numOfValuesPerProducer = 200000;
+        sbBoundedQueue<uint64_t> queue(64);
+        Check(queue.Capacity() == 64, "queue capacity");
+        std::vector<std::atomic<uint8_t>> seen(numOfProducers * numOfValuesPerProducer);
+        for (auto& flag : seen) { flag = 0; }
+        std::atomic<int> numOfProducersLeft(numOfProducers);
+        std::atomic<uint64_t> numOfPopped(0);
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < numOfProducers; ++p) {
+            threads.emplace_back([&queue, &numOfProducersLeft, p] {
+                for (uint64_t i = 0; i < numOfValuesPerProducer; ++i) {
+                    uint64_t value = p * numOfValuesPerProducer + i;
+                    while (!queue.TryPush(std::move(value))) { std::this_thread::yield(); }
+                }
+                --numOfProducersLeft;
+            });
+        }
+        for (int c = 0; c < numOfConsumers; ++c) {
+            threads.emplace_back([&queue, &numOfProducersLeft, &seen, &numOfPopped] {
+                uint64_t value;
+                for (;;) {
+                    // Seen before the pop, an empty queue afterwards is the end.
+                    const bool producersDone = numOfProducersLeft == 0;
+                    if (queue.TryPop(value)) {
+                        ++seen[value];
+                        ++numOfPopped;
+                        continue;
+                    }
+                    if (producersDone) { return; }
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& thread : threads) { thread.join(); }
+
+        Check(numOfPopped == seen.size(), "every pushed value is popped");
+        size_t numOfWrong = 0;
+        for (const auto& flag : seen) { numOfWrong += flag != 1; }
+        Check(numOfWrong == 0, "every value is popped once");
+        uint64_t value;
+        Check(!queue.TryPop(value) && queue.Size() == 0, "queue is empty at the end");
+        // Full queue refuses a push.
+        sbBoundedQueue<uint64_t> small(2);
+        uint64_t a = 1, b = 2, c = 3;
+        Check(small.TryPush(std::move(a)) && small.TryPush(std::move(b)) && !small.TryPush(std::move(c)),
+            "full queue");
+        Check(small.TryPop(value) && value == 1 && small.TryPop(value) && value == 2, "queue order");
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "usage: sbWaveformTests <scratch file>" << std::endl;
+        return 2;
+    }
+    try {
+        TestVarints();
+        TestDenseRecord();
+        TestRecordRoundTrip(argv[1]);
+        TestPulseKernelCache();
+        TestBoundedQueue();
+    } catch (const std::exception& error) {
+        std::cerr << "FAILED: " << error.what() << std::endl;
+        return 1;
+    }
+    if (numOfFailures > 0) { return 1; }
+    std::cout << "All waveform tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+#include "sbWorkStealingPool.hh"
+
+sbWorkStealingPool::sbWorkStealingPool(unsigned numOfThreads) :
+    fNumOfThreads(std::max(numOfThreads, 1u)),
+    fRanges() {
+    for (unsigned i = 0; i < fNumOfThreads; ++i) {
+        fRanges.emplace_back(new sbTaskRange());
+    }
+}
+
+void sbWorkStealingPool::Run(size_t numOfTasks, const std::function<void(size_t, unsigned)>& task) {
+    for (unsigned i = 0; i < fNumOfThreads; ++i) {
+        fRanges[i]->begin = numOfTasks * i / fNumOfThreads;
+        fRanges[i]->end = numOfTasks * (i + 1) / fNumOfThreads;
+    }
+
+    std::exception_ptr firstException;
+    std::mutex exceptionMutex;
+    std::atomic<bool> failed(false);
+    auto work = [&](unsigned worker) {
+        size_t taskIndex;
+        while (!failed.load(std::memory_order_relaxed) && Next(worker, taskIndex)) {
+            try {
+                task(taskIndex, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+                if (!firstException) { firstException = std::current_exception(); }
+                failed = true;
+            }
+        }
+    };
+
+    // The calling thread is worker 0.
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < fNumOfThreads; ++i) { threads.emplace_back(work, i); }
+    work(0);
+    for (auto& thread : threads) { thread.join(); }
+    if (firstException) { std::rethrow_exception(firstException); }
+}
+
+bool sbWorkStealingPool::Next(unsigned worker, size_t& taskIndex) {
+    do {
+        sbTaskRange& range = *fRanges[worker];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        if (range.begin < range.end) {
+            taskIndex = range.begin++;
+            return true;
+        }
+    } while (Steal(worker));
+    return false;
+}
+
+bool sbWorkStealingPool::Steal(unsigned worker) {
+    // Victims in turn from the next worker, so thieves spread over the victims.
+    for (unsigned i = 1; i < fNumOfThreads; ++i) {
+        sbTaskRange& victim = *fRanges[(worker + i) % fNumOfThreads];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end) { continue; }
+            end = victim.end;
+            begin = victim.end - (victim.end - victim.begin + 1) / 2;
+            victim.end = begin;
+        }
+        // Only its owner refills an empty range.
+        sbTaskRange& range = *fRanges[worker];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        range.begin = begin;
+        range.end = end;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,41 @@
+#ifndef SB_WORK_STEALING_POOL_H
+#define SB_WORK_STEALING_POOL_H 1
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs tasks 0 to numOfTasks - 1 on a fixed number of threads. Every worker starts with an
+// equal contiguous range and takes tasks from its front, an idle worker steals the back
+// half of the range of another, so a few slow tasks (bright events) do not leave the
+// other cores idle. Tasks are never added while running, the pool is done when no worker
+// has any left.
+class sbWorkStealingPool {
+public:
+    explicit sbWorkStealingPool(unsigned numOfThreads);
+    sbWorkStealingPool(const sbWorkStealingPool&) = delete;
+    sbWorkStealingPool& operator=(const sbWorkStealingPool&) = delete;
+
+    unsigned GetNumOfThreads() const { return fNumOfThreads; }
+
+    // Blocks until all tasks are done, task(taskIndex, workerIndex). The first exception
+    // of a task is rethrown here after all workers have stopped.
+    void Run(size_t numOfTasks, const std::function<void(size_t, unsigned)>& task);
+
+private:
+    struct sbTaskRange {
+        std::mutex mutex;
+        size_t begin;
+        size_t end;
+    };
+
+    bool Next(unsigned worker, size_t& taskIndex);
+    bool Steal(unsigned worker);
+
+    const unsigned fNumOfThreads;
+    std::vector<std::unique_ptr<sbTaskRange>> fRanges;
+};
+
+#endif
@@ -0,0 +1,67 @@
+// Command line access to a waveform container (SiPMresponse.sbwf).
+//
+//   sbwfdump <file> list                  : Event ID, numbers of hits and samples, weight.
+//   sbwfdump <file> waveform <eventID>    : Waveform csv of an event to stdout, sparse ones expanded.
+//   sbwfdump <file> hits <eventID>        : Hit csv of an event to stdout.
+//   sbwfdump <file> export <directory>    : pr<eventID>.csv and hits<eventID>.csv of all events.
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "sbWaveformReader.hh"
+
+namespace {
+    int Usage() {
+        std::cerr << "usage: sbwfdump <file> list\n"
+                  << "       sbwfdump <file> waveform <eventID>\n"
+                  << "       sbwfdump <file> hits <eventID>\n"
+                  << "       sbwfdump <file> export <directory>" << std::endl;
+        return 2;
+    }
+
+    const sbWaveformIndexEntry& FindOrThrow(const sbWaveformReader& reader, const std::string& eventID) {
+        const auto entry = reader.Find(std::stoi(eventID));
+        if (!entry) { throw std::runtime_error("No record of event " + eventID); }
+        return *entry;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) { return Usage(); }
+    const std::string command = argv[2];
+    try {
+        sbWaveformReader reader(argv[1]);
+        if (command == "list" && argc == 3) {
+            std::cout << "EventID,NumOfUpperHits,NumOfLowerHits,NumOfSamples,Weight\n";
+            for (size_t i = 0; i < reader.GetNumOfEvents(); ++i) {
+                const auto& header = reader.ReadEvent(reader.GetIndexEntry(i)).header;
+                std::cout << header.eventID << ',' << header.numOfUpperHits << ',' << header.numOfLowerHits << ','
+                          << header.numOfSamples << ',' << header.weight << '\n';
+            }
+        } else if (command == "waveform" && argc == 4) {
+            sbWaveformReader::WriteWaveformCSV(reader.ReadEvent(FindOrThrow(reader, argv[3])), std::cout);
+        } else if (command == "hits" && argc == 4) {
+            sbWaveformReader::WriteHitsCSV(reader.ReadEvent(FindOrThrow(reader, argv[3])), std::cout);
+        } else if (command == "export" && argc == 4) {
+            const std::string directory = argv[3];
+            for (size_t i = 0; i < reader.GetNumOfEvents(); ++i) {
+                const auto event = reader.ReadEvent(reader.GetIndexEntry(i));
+                const std::string eventID = std::to_string(event.header.eventID);
+                std::ofstream waveformOut(directory + "/pr" + eventID + ".csv");
+                std::ofstream hitsOut(directory + "/hits" + eventID + ".csv");
+                if (!waveformOut || !hitsOut) { throw std::runtime_error("Cannot write to " + directory); }
+                sbWaveformReader::WriteWaveformCSV(event, waveformOut);
+                sbWaveformReader::WriteHitsCSV(event, hitsOut);
+            }
+            std::cerr << reader.GetNumOfEvents() << " events exported to " << directory << std::endl;
+        } else {
+            return Usage();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "sbwfdump: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+// Re-synthesis of the waveforms in a container (SiPMresponse.sbwf) from its photon hits,
+// with another pulse shape, sampling or SiPM noise, without re-running the simulation.
+//
+//   sbwfresynth <file> [options] features             : Feature csv of all events to stdout.
+//   sbwfresynth <file> [options] waveform <eventID>   : Re-synthesized waveform csv of an event.
+//
+// Events are spread over the threads by a work-stealing pool, the container is mapped.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sbWaveformReader.hh"
+#include "sbWaveformResynthesizer.hh"
+#include "sbWorkStealingPool.hh"
+
+namespace {
+    int Usage() {
+        std::cerr << "usage: sbwfresynth <file> [options] features\n"
+                  << "       sbwfresynth <file> [options] waveform <eventID>\n"
+                  << "options (times in ns):\n"
+                  << "  --threads <n>             : Default all cores.\n"
+                  << "  --riseTime <t>            : Exponential pulse, default 0.\n"
+                  << "  --fallTime <t>            : Exponential pulse, default 1.\n"
+                  << "  --pulseFile <csv>         : Tabulated pulse, SPE_time and SPE_amplitude rows.\n"
+                  << "  --samples <n>             : Per SiPM, default 1024.\n"
+                  << "  --preTrigger <t>          : Before the first hit, default 1.\n"
+                  << "  --window <t>              : Default 0, the window of smallbox.\n"
+                  << "  --efficiency <p>          : Photoelectrons kept, default 1.\n"
+                  << "  --crosstalk <p>           : Default 0.\n"
+                  << "  --afterpulse <p>          : Default 0.\n"
+                  << "  --afterpulseTime <t>      : Default 50.\n"
+                  << "  --recoveryTime <t>        : Default 40.\n"
+                  << "  --darkCountRate <MHz>     : Default 0.\n"
+                  << "  --readoutWindow <t>       : Of dark counts, default 1000.\n"
+                  << "  --seed <n>                : Of the noise, default 0.\n"
+                  << "  --cfdFraction <f>         : Default 0.2." << std::endl;
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) { return Usage(); }
+    sbResynthesisSettings settings;
+    unsigned numOfThreads = std::thread::hardware_concurrency();
+    int arg = 2;
+    try {
+        for (; arg + 1 < argc && std::string(argv[arg]).compare(0, 2, "--") == 0; arg += 2) {
+            const std::string option = argv[arg];
+            const std::string value = argv[arg + 1];
+            if (option == "--threads") { numOfThreads = std::stoul(value); }
+            else if (option == "--riseTime") { settings.riseTime = std::stod(value); }
+            else if (option == "--fallTime") { settings.fallTime = std::stod(value); }
+            else if (option == "--pulseFile") { settings.LoadPulseFile(value); }
+            else if (option == "--samples") { settings.numOfSamples = std::stoul(value); }
+            else if (option == "--preTrigger") { settings.preTrigger = std::stod(value); }
+            else if (option == "--window") { settings.window = std::stod(value); }
+            else if (option == "--efficiency") { settings.efficiency = std::stod(value); }
+            else if (option == "--crosstalk") { settings.crosstalkProbability = std::stod(value); }
+            else if (option == "--afterpulse") { settings.afterpulseProbability = std::stod(value); }
+            else if (option == "--afterpulseTime") { settings.afterpulseTimeConstant = std::stod(value); }
+            else if (option == "--recoveryTime") { settings.recoveryTime = std::stod(value); }
+            else if (option == "--darkCountRate") { settings.darkCountRate = std::stod(value) * 1e-3; }
+            else if (option == "--readoutWindow") { settings.readoutWindow = std::stod(value); }
+            else if (option == "--seed") { settings.seed = std::stoull(value); }
+            else if (option == "--cfdFraction") { settings.CFDFraction = std::stod(value); }
+            else { return Usage(); }
+        }
+        if (arg >= argc) { return Usage(); }
+        const std::string command = argv[arg];
+
+        sbWaveformReader reader(argv[1]);
+        const sbWaveformResynthesizer resynthesizer(settings);
+        if (command == "features" && arg + 1 == argc) {
+            const auto begin = std::chrono::steady_clock::now();
+            sbWorkStealingPool pool(numOfThreads);
+            // Buffers per worker, only the features are kept per event.
+            std::vector<sbResynthesizedEvent> buffers(pool.GetNumOfThreads());
+            std::vector<sbResynthesizedEvent> results(reader.GetNumOfEvents());
+            pool.Run(reader.GetNumOfEvents(), [&](size_t i, unsigned worker) {
+                auto& buffer = buffers[worker];
+                resynthesizer.Resynthesize(reader.ReadEvent(reader.GetIndexEntry(i)), buffer);
+                auto& result = results[i];
+                result.eventID = buffer.eventID;
+                result.weight = buffer.weight;
+                result.upperFeatures = buffer.upperFeatures;
+                result.lowerFeatures = buffer.lowerFeatures;
+            });
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+            sbWaveformResynthesizer::WriteFeaturesCSVHeader(std::cout);
+            for (const auto& result : results) { sbWaveformResynthesizer::WriteFeaturesCSV(result, std::cout); }
+            std::cerr << results.size() << " events re-synthesized in " << elapsed.count() << " s on "
+                      << pool.GetNumOfThreads() << " threads" << std::endl;
+        } else if (command == "waveform" && arg + 2 == argc) {
+            const auto entry = reader.Find(std::stoi(argv[arg + 1]));
+            if (!entry) { throw std::runtime_error(std::string("No record of event ") + argv[arg + 1]); }
+            sbResynthesizedEvent result;
+            resynthesizer.Resynthesize(reader.ReadEvent(*entry), result);
+            sbWaveformResynthesizer::WriteWaveformCSV(result, std::cout);
+        } else {
+            return Usage();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "sbwfresynth: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}